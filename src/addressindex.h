@@ -68,6 +68,56 @@ struct CAddressUnspentKey {
     }
 };
 
+/** On-disk form of CAddressUnspentKey, with the asset name replaced by its id in the index database */
+struct CCompactAddressUnspentKey {
+    unsigned int type;
+    uint160 hashBytes;
+    uint32_t assetId;
+    uint256 txhash;
+    uint32_t index;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        s << VARINT(assetId);
+        txhash.Serialize(s);
+        s << VARINT(index);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        s >> VARINT(assetId);
+        txhash.Unserialize(s);
+        s >> VARINT(index);
+    }
+
+    CCompactAddressUnspentKey(const CAddressUnspentKey& key, uint32_t assetIdIn) {
+        type = key.type;
+        hashBytes = key.hashBytes;
+        assetId = assetIdIn;
+        txhash = key.txhash;
+        index = key.index;
+    }
+
+    CCompactAddressUnspentKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        assetId = 0;
+        txhash.SetNull();
+        index = 0;
+    }
+
+    CAddressUnspentKey ToAddressUnspentKey(const std::string& assetName) const {
+        return CAddressUnspentKey(type, hashBytes, assetName, txhash, index);
+    }
+};
+
 struct CAddressUnspentValue {
     CAmount satoshis;
     CScript script;
@@ -219,34 +269,25 @@ struct CAddressIndexIteratorKey {
 struct CAddressIndexIteratorAssetKey {
     unsigned int type;
     uint160 hashBytes;
-    std::string asset;
+    uint32_t assetId;
 
-    size_t GetSerializeSize() const {
-        return 21 + asset.size();
-    }
     template<typename Stream>
     void Serialize(Stream& s) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s);
-        ::Serialize(s, asset);
+        s << VARINT(assetId);
     }
     template<typename Stream>
     void Unserialize(Stream& s) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s);
-        ::Unserialize(s, asset);
+        s >> VARINT(assetId);
     }
 
-    CAddressIndexIteratorAssetKey(unsigned int addressType, uint160 addressHash) {
+    CAddressIndexIteratorAssetKey(unsigned int addressType, uint160 addressHash, uint32_t assetIdIn) {
         type = addressType;
         hashBytes = addressHash;
-        asset = RVN;
-    }
-
-    CAddressIndexIteratorAssetKey(unsigned int addressType, uint160 addressHash, std::string assetName) {
-        type = addressType;
-        hashBytes = addressHash;
-        asset = assetName;
+        assetId = assetIdIn;
     }
 
     CAddressIndexIteratorAssetKey() {
@@ -256,56 +297,226 @@ struct CAddressIndexIteratorAssetKey {
     void SetNull() {
         type = 0;
         hashBytes.SetNull();
-        asset.clear();
+        assetId = 0;
     }
 };
 
 struct CAddressIndexIteratorHeightKey {
     unsigned int type;
     uint160 hashBytes;
-    std::string asset;
+    uint32_t assetId;
     int blockHeight;
 
-    size_t GetSerializeSize() const {
-        return 25 + asset.size();
-    }
     template<typename Stream>
     void Serialize(Stream& s) const {
         ser_writedata8(s, type);
         hashBytes.Serialize(s);
-        ::Serialize(s, asset);
+        s << VARINT(assetId);
         ser_writedata32be(s, blockHeight);
     }
     template<typename Stream>
     void Unserialize(Stream& s) {
         type = ser_readdata8(s);
         hashBytes.Unserialize(s);
-        ::Unserialize(s, asset);
+        s >> VARINT(assetId);
         blockHeight = ser_readdata32be(s);
     }
 
-    CAddressIndexIteratorHeightKey(unsigned int addressType, uint160 addressHash, int height) {
+    CAddressIndexIteratorHeightKey(unsigned int addressType, uint160 addressHash, uint32_t assetIdIn, int height) {
         type = addressType;
         hashBytes = addressHash;
-        asset = RVN;
+        assetId = assetIdIn;
         blockHeight = height;
     }
 
-    CAddressIndexIteratorHeightKey(unsigned int addressType, uint160 addressHash, std::string assetName, int height) {
+    CAddressIndexIteratorHeightKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        assetId = 0;
+        blockHeight = 0;
+    }
+};
+
+/**
+ * On-disk form of CAddressIndexKey. The asset name is replaced by its numeric id
+ * in the index database (0 for RVN), and the output index is stored as a VARINT.
+ */
+struct CCompactAddressIndexKey {
+    unsigned int type;
+    uint160 hashBytes;
+    uint32_t assetId;
+    int blockHeight;
+    unsigned int txindex;
+    uint256 txhash;
+    uint32_t index;
+    bool spending;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        s << VARINT(assetId);
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        txhash.Serialize(s);
+        s << VARINT(index);
+        char f = spending;
+        ser_writedata8(s, f);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        s >> VARINT(assetId);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        txhash.Unserialize(s);
+        s >> VARINT(index);
+        char f = ser_readdata8(s);
+        spending = f;
+    }
+
+    CCompactAddressIndexKey(const CAddressIndexKey& key, uint32_t assetIdIn) {
+        type = key.type;
+        hashBytes = key.hashBytes;
+        assetId = assetIdIn;
+        blockHeight = key.blockHeight;
+        txindex = key.txindex;
+        txhash = key.txhash;
+        index = key.index;
+        spending = key.spending;
+    }
+
+    CCompactAddressIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        assetId = 0;
+        blockHeight = 0;
+        txindex = 0;
+        txhash.SetNull();
+        index = 0;
+        spending = false;
+    }
+
+    CAddressIndexKey ToAddressIndexKey(const std::string& assetName) const {
+        return CAddressIndexKey(type, hashBytes, assetName, blockHeight, txindex, txhash, index, spending);
+    }
+};
+
+/**
+ * The address history ordered by height across all assets, so that a range of
+ * blocks can be read with a single seek. Holds the same entries as CCompactAddressIndexKey.
+ */
+struct CCompactAddressHeightIndexKey {
+    unsigned int type;
+    uint160 hashBytes;
+    int blockHeight;
+    unsigned int txindex;
+    uint32_t assetId;
+    uint256 txhash;
+    uint32_t index;
+    bool spending;
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        // Heights are stored big-endian for key sorting in LevelDB
+        ser_writedata32be(s, blockHeight);
+        ser_writedata32be(s, txindex);
+        s << VARINT(assetId);
+        txhash.Serialize(s);
+        s << VARINT(index);
+        char f = spending;
+        ser_writedata8(s, f);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+        txindex = ser_readdata32be(s);
+        s >> VARINT(assetId);
+        txhash.Unserialize(s);
+        s >> VARINT(index);
+        char f = ser_readdata8(s);
+        spending = f;
+    }
+
+    CCompactAddressHeightIndexKey(const CAddressIndexKey& key, uint32_t assetIdIn) {
+        type = key.type;
+        hashBytes = key.hashBytes;
+        blockHeight = key.blockHeight;
+        txindex = key.txindex;
+        assetId = assetIdIn;
+        txhash = key.txhash;
+        index = key.index;
+        spending = key.spending;
+    }
+
+    CCompactAddressHeightIndexKey() {
+        SetNull();
+    }
+
+    void SetNull() {
+        type = 0;
+        hashBytes.SetNull();
+        blockHeight = 0;
+        txindex = 0;
+        assetId = 0;
+        txhash.SetNull();
+        index = 0;
+        spending = false;
+    }
+
+    CAddressIndexKey ToAddressIndexKey(const std::string& assetName) const {
+        return CAddressIndexKey(type, hashBytes, assetName, blockHeight, txindex, txhash, index, spending);
+    }
+};
+
+struct CAddressHeightIndexIteratorKey {
+    unsigned int type;
+    uint160 hashBytes;
+    int blockHeight;
+
+    size_t GetSerializeSize() const {
+        return 25;
+    }
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, type);
+        hashBytes.Serialize(s);
+        ser_writedata32be(s, blockHeight);
+    }
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        type = ser_readdata8(s);
+        hashBytes.Unserialize(s);
+        blockHeight = ser_readdata32be(s);
+    }
+
+    CAddressHeightIndexIteratorKey(unsigned int addressType, uint160 addressHash, int height) {
         type = addressType;
         hashBytes = addressHash;
-        asset = assetName;
         blockHeight = height;
     }
 
-    CAddressIndexIteratorHeightKey() {
+    CAddressHeightIndexIteratorKey() {
         SetNull();
     }
 
     void SetNull() {
         type = 0;
         hashBytes.SetNull();
-        asset.clear();
         blockHeight = 0;
     }
 };
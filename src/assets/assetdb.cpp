@@ -18,6 +18,7 @@ static const char ADDRESS_ASSET_QUANTITY_FLAG = 'C';
 static const char MY_ASSET_FLAG = 'M';
 static const char BLOCK_ASSET_UNDO_DATA = 'U';
 static const char MEMPOOL_REISSUED_TX = 'Z';
+static const char DB_FLAG = 'F';
 
 static size_t MAX_DATABASE_RESULTS = 50000;
 
@@ -83,37 +84,38 @@ bool CAssetsDB::EraseAddressAssetQuantity(const std::string &address, const std:
 
 bool EraseAddressAssetQuantity(const std::string &address, const std::string &assetName);
 
-bool CAssetsDB::WriteBlockUndoAssetData(const uint256& blockhash, const std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData)
+bool CAssetsDB::EraseReissuedMempoolState()
 {
-    return Write(std::make_pair(BLOCK_ASSET_UNDO_DATA, blockhash), assetUndoData);
+    return Erase(MEMPOOL_REISSUED_TX);
 }
 
-bool CAssetsDB::ReadBlockUndoAssetData(const uint256 &blockhash, std::vector<std::pair<std::string, CBlockAssetUndo> > &assetUndoData)
+bool CAssetsDB::WriteFlag(const std::string &name, bool fValue)
 {
-    // If it exists, return the read value.
-    if (Exists(std::make_pair(BLOCK_ASSET_UNDO_DATA, blockhash)))
-           return Read(std::make_pair(BLOCK_ASSET_UNDO_DATA, blockhash), assetUndoData);
+    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
+}
 
-    // If it doesn't exist, we just return true because we don't want to fail just because it didn't exist in the db
+bool CAssetsDB::ReadFlag(const std::string &name, bool &fValue)
+{
+    char ch;
+    if (!Read(std::make_pair(DB_FLAG, name), ch))
+        return false;
+    fValue = ch == '1';
     return true;
 }
 
-bool CAssetsDB::WriteReissuedMempoolState()
+bool CAssetsDB::WriteBlockUndoAssetData(const uint256& blockhash, const std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData)
 {
-    return Write(MEMPOOL_REISSUED_TX, mapReissuedAssets);
+    return Write(std::make_pair(BLOCK_ASSET_UNDO_DATA, blockhash), assetUndoData);
 }
 
-bool CAssetsDB::ReadReissuedMempoolState()
+bool CAssetsDB::ReadBlockUndoAssetData(const uint256 &blockhash, std::vector<std::pair<std::string, CBlockAssetUndo> > &assetUndoData)
 {
-    mapReissuedAssets.clear();
-    mapReissuedTx.clear();
     // If it exists, return the read value.
-    bool rv = Read(MEMPOOL_REISSUED_TX, mapReissuedAssets);
-    if (rv) {
-        for (auto pair : mapReissuedAssets)
-            mapReissuedTx.insert(std::make_pair(pair.second, pair.first));
-    }
-    return rv;
+    if (Exists(std::make_pair(BLOCK_ASSET_UNDO_DATA, blockhash)))
+           return Read(std::make_pair(BLOCK_ASSET_UNDO_DATA, blockhash), assetUndoData);
+
+    // If it doesn't exist, we just return true because we don't want to fail just because it didn't exist in the db
+    return true;
 }
 
 bool CAssetsDB::LoadAssets()
@@ -49,20 +49,23 @@ public:
     bool WriteAssetAddressQuantity(const std::string& assetName, const std::string& address, const CAmount& quantity);
     bool WriteAddressAssetQuantity( const std::string& address, const std::string& assetName, const CAmount& quantity);
     bool WriteBlockUndoAssetData(const uint256& blockhash, const std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData);
-    bool WriteReissuedMempoolState();
 
     // Read from database functions
     bool ReadAssetData(const std::string& strName, CNewAsset& asset, int& nHeight, uint256& blockHash);
     bool ReadAssetAddressQuantity(const std::string& assetName, const std::string& address, CAmount& quantity);
     bool ReadAddressAssetQuantity(const std::string& address, const std::string& assetName, CAmount& quantity);
     bool ReadBlockUndoAssetData(const uint256& blockhash, std::vector<std::pair<std::string, CBlockAssetUndo> >& assetUndoData);
-    bool ReadReissuedMempoolState();
 
     // Erase from database functions
     bool EraseAssetData(const std::string& assetName);
     bool EraseMyAssetData(const std::string& assetName);
     bool EraseAssetAddressQuantity(const std::string &assetName, const std::string &address);
     bool EraseAddressAssetQuantity(const std::string &address, const std::string &assetName);
+    bool EraseReissuedMempoolState();
+
+    // Whether the database holds the asset index, kept here as well as in the block tree so it survives -reindex-index
+    bool WriteFlag(const std::string& name, bool fValue);
+    bool ReadFlag(const std::string& name, bool& fValue);
 
     // Helper functions
     bool LoadAssets();
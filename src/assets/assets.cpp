@@ -29,8 +29,6 @@
 #include "coins.h"
 #include "wallet/wallet.h"
 
-std::map<uint256, std::string> mapReissuedTx;
-std::map<std::string, uint256> mapReissuedAssets;
 
 // excluding owner tag ('!')
 static const auto MAX_NAME_LENGTH = 31;
@@ -281,7 +279,7 @@ bool CNewAsset::IsValid(std::string& strError, CAssetsCache& assetCache, bool fC
     }
 
     if (fCheckMempool) {
-        if (mempool.mapAssetToHash.count(strName)) {
+        if (mempool.existsAssetOp(strName, MemPoolAssetOp::NEW_ASSET)) {
             strError = _("Asset with this name is already in the mempool");
             return false;
         }
@@ -57,10 +57,6 @@ class COutput;
 // 2500 * 82 Bytes == 205 KB (kilobytes) of memory
 #define MAX_CACHE_ASSETS_SIZE 2500
 
-// Create map that store that state of current reissued transaction that the mempool as accepted.
-// If an asset name is in this map, any other reissue transactions wont be accepted into the mempool
-extern std::map<uint256, std::string> mapReissuedTx;
-extern std::map<std::string, uint256> mapReissuedAssets;
 
 class CAssets {
 public:
@@ -0,0 +1,224 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "arith_uint256.h"
+#include "chainparams.h"
+#include "fs.h"
+#include "policy/policy.h"
+#include "random.h"
+#include "txdb.h"
+#include "txmempool.h"
+#include "univalue.h"
+#include "util.h"
+#include "validation.h"
+
+#include <set>
+
+// Measures reading the address index entries of many addresses at once, as done by the
+// address index RPCs, with a single thread and with several threads per query, and turning
+// the entries into the distinct txids returned by getaddresstxids. Also measures keeping
+// the mempool address index of -addressindex as transactions enter and leave the mempool,
+// alone and together with the mempool insertion done by AcceptToMemoryPool.
+
+static const int NUM_ADDRESSES = 100;
+static const int ENTRIES_PER_ADDRESS = 500;
+
+struct AddressIndexSetup
+{
+    fs::path pathTemp;
+    CIndexDB* pindexdbPrev;
+    bool fAddressIndexPrev;
+    int nAddressQueryThreadsPrev;
+    std::unique_ptr<CIndexDB> indexdb;
+    std::vector<std::pair<uint160, int> > addresses;
+
+    AddressIndexSetup() : pindexdbPrev(pindexdb), fAddressIndexPrev(fAddressIndex), nAddressQueryThreadsPrev(nAddressQueryThreads)
+    {
+        // The database is kept in memory, but its path is still taken from the data directory,
+        // which needs the chain to be selected
+        SelectParams(CBaseChainParams::MAIN);
+        pathTemp = fs::temp_directory_path() / strprintf("bench_raven_addressindex_%lu", (unsigned long)GetTime());
+        fs::create_directories(pathTemp);
+        gArgs.ForceSetArg("-datadir", pathTemp.string());
+        ClearDatadirCache();
+        indexdb.reset(new CIndexDB(1 << 20, true));
+
+        FastRandomContext rand(true);
+        for (int i = 0; i < NUM_ADDRESSES; i++) {
+            uint160 hashBytes;
+            for (unsigned char& c : hashBytes)
+                c = (unsigned char)rand.randbits(8);
+            addresses.push_back(std::make_pair(hashBytes, 1));
+
+            std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+            for (int j = 0; j < ENTRIES_PER_ADDRESS; j++) {
+                int nHeight = 1 + (int)rand.randrange(100000);
+                vEntries.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, RVN, nHeight, 1, rand.rand256(), 0, false), (CAmount)nHeight));
+            }
+            indexdb->WriteAddressIndex(vEntries);
+        }
+
+        pindexdb = indexdb.get();
+        fAddressIndex = true;
+    }
+
+    ~AddressIndexSetup()
+    {
+        pindexdb = pindexdbPrev;
+        fAddressIndex = fAddressIndexPrev;
+        nAddressQueryThreads = nAddressQueryThreadsPrev;
+        indexdb.reset();
+        fs::remove_all(pathTemp);
+        gArgs.ForceSetArg("-datadir", "");
+        ClearDatadirCache();
+    }
+};
+
+static void ReadAddressesIndex(benchmark::State& state, int nThreads)
+{
+    AddressIndexSetup setup;
+    nAddressQueryThreads = nThreads;
+
+    while (state.KeepRunning()) {
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        GetAddressesIndex(setup.addresses, RVN, addressIndex);
+        assert(addressIndex.size() == (size_t)NUM_ADDRESSES * ENTRIES_PER_ADDRESS);
+    }
+}
+
+static void AddressIndexQuerySingleThread(benchmark::State& state)
+{
+    ReadAddressesIndex(state, 1);
+}
+
+static void AddressIndexQueryFourThreads(benchmark::State& state)
+{
+    ReadAddressesIndex(state, 4);
+}
+
+static std::vector<std::pair<CAddressIndexKey, CAmount> > MakeTxidEntries()
+{
+    // Every transaction both spends from and pays to the address, in height order
+    FastRandomContext rand(true);
+    uint160 hashBytes;
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+    for (int i = 0; i < NUM_ADDRESSES * ENTRIES_PER_ADDRESS / 2; i++) {
+        uint256 txhash = rand.rand256();
+        vEntries.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, RVN, 1 + i / 10, i % 10, txhash, 0, true), (CAmount)-1));
+        vEntries.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, RVN, 1 + i / 10, i % 10, txhash, 1, false), (CAmount)1));
+    }
+    return vEntries;
+}
+
+static void AddressTxidsHexSet(benchmark::State& state)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries = MakeTxidEntries();
+
+    // As getaddresstxids used to, deduplicating on hex strings
+    while (state.KeepRunning()) {
+        std::set<std::pair<int, std::string> > txids;
+        for (const auto& entry : vEntries)
+            txids.insert(std::make_pair(entry.first.blockHeight, entry.first.txhash.GetHex()));
+        UniValue result(UniValue::VARR);
+        for (const auto& txid : txids)
+            result.push_back(txid.second);
+        assert(result.size() == vEntries.size() / 2);
+    }
+}
+
+static void AddressTxidsBinary(benchmark::State& state)
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries = MakeTxidEntries();
+
+    while (state.KeepRunning()) {
+        std::vector<uint256> txids;
+        GetAddressIndexTxids(vEntries, txids);
+        UniValue result(UniValue::VARR);
+        for (const uint256& txid : txids)
+            result.push_back(txid.GetHex());
+        assert(result.size() == vEntries.size() / 2);
+    }
+}
+
+static void MempoolAddressIndex(benchmark::State& state)
+{
+    // Transactions paying between a few busy addresses, each spending an output of the previous one
+    const int NUM_TXS = 2000;
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    std::vector<CScript> vScripts;
+    for (int i = 0; i < 10; i++) {
+        uint160 hashBytes(std::vector<unsigned char>(20, (unsigned char)i));
+        vScripts.push_back(CScript() << OP_DUP << OP_HASH160 << ToByteVector(hashBytes) << OP_EQUALVERIFY << OP_CHECKSIG);
+    }
+    std::vector<CTxMemPoolEntry> vEntries;
+    COutPoint prevout(uint256S("01"), 0);
+    view.AddCoin(prevout, Coin(CTxOut(NUM_TXS * COIN, vScripts[0]), 1, false), false);
+    LockPoints lp;
+    for (int i = 0; i < NUM_TXS; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vout.resize(2);
+        tx.vout[0] = CTxOut((NUM_TXS - i - 1) * COIN, vScripts[(i + 1) % vScripts.size()]);
+        tx.vout[1] = CTxOut(COIN, vScripts[(i + 2) % vScripts.size()]);
+        prevout = COutPoint(tx.GetHash(), 0);
+        view.AddCoin(prevout, Coin(tx.vout[0], 1, false), false);
+        vEntries.emplace_back(MakeTransactionRef(tx), 0, 0, 1, false, 4, lp);
+    }
+
+    CTxMemPool pool;
+    while (state.KeepRunning()) {
+        for (const CTxMemPoolEntry& entry : vEntries)
+            pool.addAddressIndex(entry, view);
+        for (const CTxMemPoolEntry& entry : vEntries)
+            pool.removeAddressIndex(entry.GetTx().GetHash());
+    }
+}
+
+static void MempoolAcceptAddressIndex(benchmark::State& state)
+{
+    // Independent transactions that all pay one busy address, such as an exchange's, entering the mempool
+    // as AcceptToMemoryPool adds them with -addressindex (without the checks) and leaving it with a block
+    const int NUM_TXS = 2000;
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    uint160 hashBytes(std::vector<unsigned char>(20, 1));
+    CScript script = CScript() << OP_DUP << OP_HASH160 << ToByteVector(hashBytes) << OP_EQUALVERIFY << OP_CHECKSIG;
+    std::vector<CTxMemPoolEntry> vEntries;
+    std::vector<CTransactionRef> vtx;
+    LockPoints lp;
+    for (int i = 0; i < NUM_TXS; i++) {
+        COutPoint prevout(ArithToUint256(arith_uint256(i + 1)), 0);
+        view.AddCoin(prevout, Coin(CTxOut(2 * COIN, script), 1, false), false);
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = prevout;
+        tx.vout.resize(2);
+        tx.vout[0] = CTxOut(COIN, script);
+        tx.vout[1] = CTxOut(COIN - 1000, script);
+        vtx.push_back(MakeTransactionRef(tx));
+        vEntries.emplace_back(vtx.back(), 1000, 0, 1, false, 4, lp);
+    }
+
+    CTxMemPool pool;
+    while (state.KeepRunning()) {
+        LOCK(pool.cs);
+        for (const CTxMemPoolEntry& entry : vEntries) {
+            pool.addUnchecked(entry.GetTx().GetHash(), entry);
+            pool.addAddressIndex(entry, view);
+        }
+        pool.removeForBlock(vtx, 1);
+        assert(pool.size() == 0);
+    }
+}
+
+BENCHMARK(AddressIndexQuerySingleThread);
+BENCHMARK(AddressIndexQueryFourThreads);
+BENCHMARK(AddressTxidsHexSet);
+BENCHMARK(AddressTxidsBinary);
+BENCHMARK(MempoolAddressIndex);
+BENCHMARK(MempoolAcceptAddressIndex);
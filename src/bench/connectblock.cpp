@@ -0,0 +1,113 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "chain.h"
+#include "checkqueue.h"
+#include "coins.h"
+#include "streams.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/thread/thread.hpp>
+
+namespace block_bench {
+#include "bench/data/block413567.raw.h"
+} // namespace block_bench
+
+// Measures the per transaction input checks of ConnectBlock (CheckTxInputs, sequence
+// locks and sigop counting) over the independent transactions of a real block, run
+// serially as before and through the check queue as done with -parallelconnect.
+
+static const int MIN_CORES = 2;
+static const int QUEUE_BATCH_SIZE = 128;
+
+struct ConnectBlockSetup
+{
+    CBlock block;
+    CCoinsView viewDummy;
+    CCoinsViewCache view;
+    CBlockIndex indexPrev;
+    CBlockIndex index;
+    std::vector<bool> vIndependent;
+
+    ConnectBlockSetup() : view(&viewDummy)
+    {
+        CDataStream stream((const char*)block_bench::block413567,
+                (const char*)&block_bench::block413567[sizeof(block_bench::block413567)],
+                SER_NETWORK, PROTOCOL_VERSION);
+        stream >> block;
+
+        indexPrev.nHeight = 413566;
+        index.nHeight = 413567;
+        index.pprev = &indexPrev;
+
+        // Fund every spent outpoint so that the fee checks pass
+        for (const auto& ptx : block.vtx) {
+            if (ptx->IsCoinBase())
+                continue;
+            for (size_t j = 0; j < ptx->vin.size(); j++) {
+                CTxOut out;
+                out.nValue = j == 0 ? ptx->GetValueOut() : 0;
+                view.AddCoin(ptx->vin[j].prevout, Coin(out, 1, false), true);
+            }
+        }
+        vIndependent = FindIndependentBlockTransactions(block);
+    }
+
+    void MakeChecks(std::vector<CTxInputsCheck>& vChecks, std::vector<CTxInputsCheckResult>& vResults)
+    {
+        vResults.assign(block.vtx.size(), CTxInputsCheckResult());
+        vChecks.clear();
+        vChecks.reserve(block.vtx.size());
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            if (!vIndependent[i])
+                continue;
+            const CTransaction& tx = *block.vtx[i];
+            std::vector<Coin> vCoins;
+            vCoins.reserve(tx.vin.size());
+            for (const CTxIn& txin : tx.vin)
+                vCoins.push_back(view.AccessCoin(txin.prevout));
+            vChecks.emplace_back(tx, std::move(vCoins), &index, 0, SCRIPT_VERIFY_P2SH | SCRIPT_VERIFY_WITNESS, false, &vResults[i]);
+        }
+    }
+};
+
+static void ConnectBlockInputChecksSerial(benchmark::State& state)
+{
+    ConnectBlockSetup setup;
+    std::vector<CTxInputsCheck> vChecks;
+    std::vector<CTxInputsCheckResult> vResults;
+
+    while (state.KeepRunning()) {
+        setup.MakeChecks(vChecks, vResults);
+        for (auto& check : vChecks)
+            check();
+    }
+}
+
+static void ConnectBlockInputChecksParallel(benchmark::State& state)
+{
+    ConnectBlockSetup setup;
+    std::vector<CTxInputsCheck> vChecks;
+    std::vector<CTxInputsCheckResult> vResults;
+
+    CCheckQueue<CTxInputsCheck> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        setup.MakeChecks(vChecks, vResults);
+        CCheckQueueControl<CTxInputsCheck> control(&queue);
+        control.Add(vChecks);
+        control.Wait();
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+BENCHMARK(ConnectBlockInputChecksSerial);
+BENCHMARK(ConnectBlockInputChecksParallel);
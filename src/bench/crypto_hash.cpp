@@ -8,6 +8,7 @@
 #include "bench.h"
 #include "bloom.h"
 #include "hash.h"
+#include "primitives/block.h"
 #include "random.h"
 #include "uint256.h"
 #include "utiltime.h"
@@ -71,6 +72,49 @@ static void SipHash_32b(benchmark::State& state)
     }
 }
 
+/* Number of nonces to try per header and iteration, as the miner does */
+static const uint32_t X16R_NONCES = 64;
+
+static std::vector<CBlockHeader> X16RHeaders()
+{
+    // Headers on different previous blocks, so that the rounds run different algorithms
+    FastRandomContext rand(true);
+    std::vector<CBlockHeader> headers(16);
+    for (CBlockHeader& header : headers) {
+        header.nVersion = 0x20000000;
+        header.hashPrevBlock = rand.rand256();
+        header.hashMerkleRoot = rand.rand256();
+        header.nTime = 1514764800;
+        header.nBits = 0x1e00ffff;
+    }
+    return headers;
+}
+
+static void X16R_Header(benchmark::State& state)
+{
+    std::vector<CBlockHeader> headers = X16RHeaders();
+    uint256 hash;
+    while (state.KeepRunning()) {
+        for (CBlockHeader& header : headers) {
+            for (header.nNonce = 0; header.nNonce < X16R_NONCES; header.nNonce++)
+                hash = header.GetHash();
+        }
+    }
+}
+
+static void X16R_HeaderMidstate(benchmark::State& state)
+{
+    std::vector<CBlockHeader> headers = X16RHeaders();
+    uint256 hash;
+    while (state.KeepRunning()) {
+        for (CBlockHeader& header : headers) {
+            CX16RMidstate midstate = header.GetX16RMidstate();
+            for (header.nNonce = 0; header.nNonce < X16R_NONCES; header.nNonce++)
+                hash = header.GetHash(midstate);
+        }
+    }
+}
+
 static void FastRandom_32bit(benchmark::State& state)
 {
     FastRandomContext rng(true);
@@ -100,5 +144,7 @@ BENCHMARK(SHA512);
 
 BENCHMARK(SHA256_32b);
 BENCHMARK(SipHash_32b);
+BENCHMARK(X16R_Header);
+BENCHMARK(X16R_HeaderMidstate);
 BENCHMARK(FastRandom_32bit);
 BENCHMARK(FastRandom_1bit);
@@ -0,0 +1,70 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+#include "policy/policy.h"
+#include "txmempool.h"
+
+#include <vector>
+
+static void AddTx(const CTransactionRef& tx, const CAmount& nFee, CTxMemPool& pool)
+{
+    int64_t nTime = 0;
+    unsigned int nHeight = 1;
+    bool spendsCoinbase = false;
+    unsigned int sigOpCost = 4;
+    LockPoints lp;
+    pool.addUnchecked(tx->GetHash(), CTxMemPoolEntry(tx, nFee, nTime, nHeight, spendsCoinbase, sigOpCost, lp));
+}
+
+// Chains of transactions that each spend the one before, so entries have parents and children to link
+static std::vector<CTransactionRef> CreateChains(int nChains, int nChainLength)
+{
+    std::vector<CTransactionRef> vtx;
+    for (int i = 0; i < nChains; i++) {
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << (int64_t)i;
+        for (int j = 0; j < nChainLength; j++) {
+            tx.vout.resize(1);
+            tx.vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            tx.vout[0].nValue = 10 * COIN;
+            vtx.push_back(MakeTransactionRef(tx));
+
+            tx.vin[0].prevout = COutPoint(vtx.back()->GetHash(), 0);
+            tx.vin[0].scriptSig = CScript() << OP_1;
+        }
+    }
+    return vtx;
+}
+
+// Fill the mempool with 1000 linked transactions and remove them again as if mined
+static void MempoolInsertRemove(benchmark::State& state)
+{
+    const std::vector<CTransactionRef> vtx = CreateChains(100, 10);
+    CTxMemPool pool;
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vtx.size(); i++)
+            AddTx(vtx[i], 1000 + (i * 7919) % 10000, pool);
+        pool.removeForBlock(vtx, 1);
+    }
+}
+
+// Fill the mempool with 1000 linked transactions and evict by fee until a quarter is left
+static void MempoolTrim(benchmark::State& state)
+{
+    const std::vector<CTransactionRef> vtx = CreateChains(100, 10);
+    CTxMemPool pool;
+
+    while (state.KeepRunning()) {
+        for (size_t i = 0; i < vtx.size(); i++)
+            AddTx(vtx[i], 1000 + (i * 7919) % 10000, pool);
+        pool.TrimToSize(pool.DynamicMemoryUsage() / 4);
+        pool.clear();
+    }
+}
+
+BENCHMARK(MempoolInsertRemove);
+BENCHMARK(MempoolTrim);
@@ -0,0 +1,111 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "bench.h"
+
+#include "checkqueue.h"
+#include "coins.h"
+#include "key.h"
+#include "keystore.h"
+#include "policy/policy.h"
+#include "script/sigcache.h"
+#include "script/sign.h"
+#include "util.h"
+#include "validation.h"
+
+#include <boost/thread/thread.hpp>
+
+// Measures the script checks of a batch of multi-input P2PKH transactions, as
+// done when transactions of disconnected blocks go back to the mempool, run
+// serially as before and through the script check queue. Signatures are not
+// stored in the signature cache so every run verifies them.
+
+static const int MIN_CORES = 2;
+static const int QUEUE_BATCH_SIZE = 128;
+static const int BATCH_TRANSACTIONS = 100;
+static const int TRANSACTION_INPUTS = 4;
+
+struct MempoolScriptsSetup
+{
+    CCoinsView viewDummy;
+    CCoinsViewCache view;
+    std::vector<CTransaction> vtx;
+    std::vector<PrecomputedTransactionData> vTxData;
+
+    MempoolScriptsSetup() : view(&viewDummy)
+    {
+        InitSignatureCache();
+
+        CBasicKeyStore keystore;
+        CKey key;
+        key.MakeNewKey(true);
+        keystore.AddKey(key);
+        CScript scriptPubKey = GetScriptForDestination(key.GetPubKey().GetID());
+
+        vtx.reserve(BATCH_TRANSACTIONS);
+        for (int i = 0; i < BATCH_TRANSACTIONS; i++) {
+            CMutableTransaction txFund;
+            txFund.vin.resize(1);
+            txFund.vin[0].prevout.n = i;
+            txFund.vout.resize(TRANSACTION_INPUTS, CTxOut(COIN, scriptPubKey));
+            AddCoins(view, txFund, 1, uint256());
+
+            CMutableTransaction tx;
+            for (int j = 0; j < TRANSACTION_INPUTS; j++)
+                tx.vin.emplace_back(COutPoint(txFund.GetHash(), j));
+            tx.vout.emplace_back(TRANSACTION_INPUTS * COIN - 1000, scriptPubKey);
+            for (int j = 0; j < TRANSACTION_INPUTS; j++)
+                SignSignature(keystore, txFund, tx, j, SIGHASH_ALL);
+            vtx.emplace_back(tx);
+        }
+        vTxData.reserve(vtx.size());
+        for (const CTransaction& tx : vtx)
+            vTxData.emplace_back(tx);
+    }
+
+    void MakeChecks(std::vector<CScriptCheck>& vChecks)
+    {
+        vChecks.clear();
+        vChecks.reserve(vtx.size() * TRANSACTION_INPUTS);
+        for (size_t i = 0; i < vtx.size(); i++) {
+            for (unsigned int j = 0; j < vtx[i].vin.size(); j++)
+                vChecks.emplace_back(view.AccessCoin(vtx[i].vin[j].prevout).out, vtx[i], j, STANDARD_SCRIPT_VERIFY_FLAGS, false, &vTxData[i]);
+        }
+    }
+};
+
+static void MempoolScriptChecksSerial(benchmark::State& state)
+{
+    MempoolScriptsSetup setup;
+    std::vector<CScriptCheck> vChecks;
+
+    while (state.KeepRunning()) {
+        setup.MakeChecks(vChecks);
+        for (auto& check : vChecks)
+            assert(check());
+    }
+}
+
+static void MempoolScriptChecksParallel(benchmark::State& state)
+{
+    MempoolScriptsSetup setup;
+    std::vector<CScriptCheck> vChecks;
+
+    CCheckQueue<CScriptCheck> queue {QUEUE_BATCH_SIZE};
+    boost::thread_group tg;
+    for (auto x = 0; x < std::max(MIN_CORES, GetNumCores()); ++x) {
+       tg.create_thread([&]{queue.Thread();});
+    }
+    while (state.KeepRunning()) {
+        setup.MakeChecks(vChecks);
+        CCheckQueueControl<CScriptCheck> control(&queue);
+        control.Add(vChecks);
+        assert(control.Wait());
+    }
+    tg.interrupt_all();
+    tg.join_all();
+}
+
+BENCHMARK(MempoolScriptChecksSerial);
+BENCHMARK(MempoolScriptChecksParallel);
@@ -0,0 +1,98 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockconnectstats.h"
+
+#include <algorithm>
+#include <assert.h>
+
+CBlockConnectStats blockConnectStats;
+
+const char* BlockConnectStageName(BlockConnectStage stage)
+{
+    switch (stage) {
+    case CONNECT_STAGE_LOAD_BLOCK: return "load_block";
+    case CONNECT_STAGE_PREFETCH_INPUTS: return "prefetch_inputs";
+    case CONNECT_STAGE_SANITY_CHECKS: return "sanity_checks";
+    case CONNECT_STAGE_FORK_CHECKS: return "fork_checks";
+    case CONNECT_STAGE_CONNECT_TXS: return "connect_txs";
+    case CONNECT_STAGE_ASSET_CHECKS: return "asset_checks";
+    case CONNECT_STAGE_VERIFY_SCRIPTS: return "verify_scripts";
+    case CONNECT_STAGE_UNDO_WRITE: return "undo_write";
+    case CONNECT_STAGE_ASSET_UNDO_WRITE: return "asset_undo_write";
+    case CONNECT_STAGE_TXINDEX_WRITE: return "txindex_write";
+    case CONNECT_STAGE_FLUSH_COINS: return "flush_coins";
+    case CONNECT_STAGE_FLUSH_ASSETS: return "flush_assets";
+    case CONNECT_STAGE_WRITE_CHAINSTATE: return "write_chainstate";
+    case CONNECT_STAGE_POSTPROCESS: return "postprocess";
+    case CONNECT_STAGE_TOTAL: return "total";
+    case CONNECT_STAGE_COUNT: break;
+    }
+    assert(false);
+    return "";
+}
+
+CBlockConnectStats::CBlockConnectStats(size_t nMaxBlocksIn) : nMaxBlocks(nMaxBlocksIn), vCurrent(CONNECT_STAGE_COUNT, 0)
+{
+}
+
+void CBlockConnectStats::SetMaxBlocks(size_t nMaxBlocksIn)
+{
+    LOCK(cs);
+    nMaxBlocks = nMaxBlocksIn;
+    while (vBlocks.size() > nMaxBlocks)
+        vBlocks.pop_front();
+}
+
+void CBlockConnectStats::BeginBlock()
+{
+    std::fill(vCurrent.begin(), vCurrent.end(), 0);
+}
+
+void CBlockConnectStats::Record(BlockConnectStage stage, int64_t nMicros)
+{
+    vCurrent[stage] += nMicros;
+}
+
+void CBlockConnectStats::CommitBlock()
+{
+    LOCK(cs);
+    if (nMaxBlocks == 0)
+        return;
+    if (vBlocks.size() >= nMaxBlocks)
+        vBlocks.pop_front();
+    vBlocks.push_back(vCurrent);
+}
+
+static int64_t NearestRank(const std::vector<int64_t>& vSorted, int nPercent)
+{
+    size_t nRank = (vSorted.size() * nPercent + 99) / 100;
+    return vSorted[std::max<size_t>(nRank, 1) - 1];
+}
+
+size_t CBlockConnectStats::Summarize(std::vector<CBlockConnectStageSummary>& vSummary) const
+{
+    LOCK(cs);
+    vSummary.assign(CONNECT_STAGE_COUNT, CBlockConnectStageSummary());
+    if (vBlocks.empty())
+        return 0;
+
+    std::vector<int64_t> vTimes(vBlocks.size());
+    for (int stage = 0; stage < CONNECT_STAGE_COUNT; stage++) {
+        int64_t nSum = 0;
+        for (size_t i = 0; i < vBlocks.size(); i++) {
+            vTimes[i] = vBlocks[i][stage];
+            nSum += vTimes[i];
+        }
+        std::sort(vTimes.begin(), vTimes.end());
+
+        CBlockConnectStageSummary& summary = vSummary[stage];
+        summary.nP50 = NearestRank(vTimes, 50);
+        summary.nP95 = NearestRank(vTimes, 95);
+        summary.nP99 = NearestRank(vTimes, 99);
+        summary.nMax = vTimes.back();
+        summary.nMean = nSum / (int64_t)vTimes.size();
+    }
+    return vBlocks.size();
+}
@@ -0,0 +1,83 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_BLOCKCONNECTSTATS_H
+#define RAVEN_BLOCKCONNECTSTATS_H
+
+#include "sync.h"
+
+#include <deque>
+#include <stdint.h>
+#include <vector>
+
+/** Default for -connectstatsblocks, the number of connected blocks kept for getblockconnectstats */
+static const unsigned int DEFAULT_CONNECT_STATS_BLOCKS = 1000;
+
+/** Stages of connecting a block to the tip, as timed by ConnectTip and ConnectBlock */
+enum BlockConnectStage
+{
+    CONNECT_STAGE_LOAD_BLOCK,
+    CONNECT_STAGE_PREFETCH_INPUTS,
+    CONNECT_STAGE_SANITY_CHECKS,
+    CONNECT_STAGE_FORK_CHECKS,
+    CONNECT_STAGE_CONNECT_TXS,
+    CONNECT_STAGE_ASSET_CHECKS,
+    CONNECT_STAGE_VERIFY_SCRIPTS,
+    CONNECT_STAGE_UNDO_WRITE,
+    CONNECT_STAGE_ASSET_UNDO_WRITE,
+    CONNECT_STAGE_TXINDEX_WRITE,
+    CONNECT_STAGE_FLUSH_COINS,
+    CONNECT_STAGE_FLUSH_ASSETS,
+    CONNECT_STAGE_WRITE_CHAINSTATE,
+    CONNECT_STAGE_POSTPROCESS,
+    CONNECT_STAGE_TOTAL,
+    CONNECT_STAGE_COUNT
+};
+
+/** Name of a stage as reported by getblockconnectstats */
+const char* BlockConnectStageName(BlockConnectStage stage);
+
+struct CBlockConnectStageSummary
+{
+    int64_t nP50;
+    int64_t nP95;
+    int64_t nP99;
+    int64_t nMax;
+    int64_t nMean;
+
+    CBlockConnectStageSummary() : nP50(0), nP95(0), nP99(0), nMax(0), nMean(0) {}
+};
+
+/**
+ * Per stage connect times, in microseconds, of the last connected blocks.
+ * The block being connected is accumulated by the validation thread (under cs_main)
+ * and only becomes visible to readers once it is committed.
+ */
+class CBlockConnectStats
+{
+private:
+    mutable CCriticalSection cs;
+    size_t nMaxBlocks;
+    std::deque<std::vector<int64_t> > vBlocks;
+    std::vector<int64_t> vCurrent;
+
+public:
+    explicit CBlockConnectStats(size_t nMaxBlocksIn = DEFAULT_CONNECT_STATS_BLOCKS);
+
+    void SetMaxBlocks(size_t nMaxBlocksIn);
+
+    /** Start timing a new block, dropping whatever was recorded for an unfinished one */
+    void BeginBlock();
+    /** Add to the time spent in a stage by the block being connected */
+    void Record(BlockConnectStage stage, int64_t nMicros);
+    /** Commit the block being connected to the window */
+    void CommitBlock();
+
+    /** Nearest-rank percentiles per stage over the blocks in the window, returns the number of blocks */
+    size_t Summarize(std::vector<CBlockConnectStageSummary>& vSummary) const;
+};
+
+extern CBlockConnectStats blockConnectStats;
+
+#endif // RAVEN_BLOCKCONNECTSTATS_H
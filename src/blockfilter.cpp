@@ -0,0 +1,268 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+
+#include "coins.h"
+#include "crypto/common.h"
+#include "hash.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "streams.h"
+#include "undo.h"
+#include "version.h"
+
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+namespace {
+
+/** Writes bits most significant first, padding the last byte with zero bits */
+class BitWriter
+{
+private:
+    std::vector<unsigned char>& vData;
+    unsigned char nBuffer;
+    int nBitsUsed;
+
+public:
+    explicit BitWriter(std::vector<unsigned char>& vDataIn) : vData(vDataIn), nBuffer(0), nBitsUsed(0) {}
+
+    /** Write the nBits (at most 64) least significant bits of data */
+    void Write(uint64_t data, int nBits)
+    {
+        while (nBits > 0) {
+            int nChunk = std::min(8 - nBitsUsed, nBits);
+            unsigned char bits = (data >> (nBits - nChunk)) & ((1 << nChunk) - 1);
+            nBuffer |= bits << (8 - nBitsUsed - nChunk);
+            nBitsUsed += nChunk;
+            nBits -= nChunk;
+            if (nBitsUsed == 8)
+                Flush();
+        }
+    }
+
+    void Flush()
+    {
+        if (nBitsUsed == 0)
+            return;
+        vData.push_back(nBuffer);
+        nBuffer = 0;
+        nBitsUsed = 0;
+    }
+};
+
+class BitReader
+{
+private:
+    const std::vector<unsigned char>& vData;
+    size_t nPos;
+    int nBitsUsed;
+
+public:
+    BitReader(const std::vector<unsigned char>& vDataIn, size_t nPosIn) : vData(vDataIn), nPos(nPosIn), nBitsUsed(0) {}
+
+    /** Read nBits (at most 64) bits. Throws std::ios_base::failure past the end of the data. */
+    uint64_t Read(int nBits)
+    {
+        uint64_t data = 0;
+        while (nBits > 0) {
+            if (nPos >= vData.size())
+                throw std::ios_base::failure("BitReader::Read(): end of data");
+            int nChunk = std::min(8 - nBitsUsed, nBits);
+            data = (data << nChunk) | ((vData[nPos] >> (8 - nBitsUsed - nChunk)) & ((1 << nChunk) - 1));
+            nBitsUsed += nChunk;
+            nBits -= nChunk;
+            if (nBitsUsed == 8) {
+                nPos++;
+                nBitsUsed = 0;
+            }
+        }
+        return data;
+    }
+};
+
+void GolombRiceEncode(BitWriter& writer, uint8_t P, uint64_t x)
+{
+    // The quotient in unary, terminated by a zero bit, followed by the remainder in P bits
+    uint64_t q = x >> P;
+    while (q > 0) {
+        int nBits = std::min<uint64_t>(q, 64);
+        writer.Write(~0ULL, nBits);
+        q -= nBits;
+    }
+    writer.Write(0, 1);
+    writer.Write(x, P);
+}
+
+uint64_t GolombRiceDecode(BitReader& reader, uint8_t P)
+{
+    uint64_t q = 0;
+    while (reader.Read(1) == 1)
+        q++;
+    uint64_t r = reader.Read(P);
+    return (q << P) + r;
+}
+
+/** Map x uniformly into [0, n), as (x * n) >> 64 */
+uint64_t MapIntoRange(uint64_t x, uint64_t n)
+{
+#ifdef __SIZEOF_INT128__
+    return (uint64_t)(((unsigned __int128)x * (unsigned __int128)n) >> 64);
+#else
+    uint64_t x_hi = x >> 32, x_lo = x & 0xFFFFFFFF;
+    uint64_t n_hi = n >> 32, n_lo = n & 0xFFFFFFFF;
+    uint64_t ac = x_hi * n_hi;
+    uint64_t ad = x_hi * n_lo;
+    uint64_t bc = x_lo * n_hi;
+    uint64_t bd = x_lo * n_lo;
+    uint64_t mid34 = (bd >> 32) + (bc & 0xFFFFFFFF) + (ad & 0xFFFFFFFF);
+    return ac + (bc >> 32) + (ad >> 32) + (mid34 >> 32);
+#endif
+}
+
+} // namespace
+
+GCSFilter::GCSFilter(uint64_t k0In, uint64_t k1In, uint8_t PIn, uint32_t MIn)
+    : k0(k0In), k1(k1In), P(PIn), M(MIn), N(0), F(0)
+{
+    vEncoded.push_back(0);
+}
+
+GCSFilter::GCSFilter(uint64_t k0In, uint64_t k1In, uint8_t PIn, uint32_t MIn, std::vector<unsigned char> vEncodedIn)
+    : k0(k0In), k1(k1In), P(PIn), M(MIn), vEncoded(std::move(vEncodedIn))
+{
+    const char* pbegin = (const char*)vEncoded.data();
+    CDataStream stream(pbegin, pbegin + std::min<size_t>(vEncoded.size(), 9), SER_NETWORK, PROTOCOL_VERSION);
+    uint64_t nElements = ReadCompactSize(stream);
+    if (nElements > std::numeric_limits<uint32_t>::max())
+        throw std::ios_base::failure("GCSFilter: N is too large");
+    N = nElements;
+    F = (uint64_t)N * M;
+
+    // Decode all elements once, to reject truncated filters
+    BitReader reader(vEncoded, GetSizeOfCompactSize(N));
+    for (uint32_t i = 0; i < N; i++)
+        GolombRiceDecode(reader, P);
+}
+
+GCSFilter::GCSFilter(uint64_t k0In, uint64_t k1In, uint8_t PIn, uint32_t MIn, const ElementSet& elements)
+    : k0(k0In), k1(k1In), P(PIn), M(MIn)
+{
+    if (elements.size() > std::numeric_limits<uint32_t>::max())
+        throw std::invalid_argument("GCSFilter: N is too large");
+    N = elements.size();
+    F = (uint64_t)N * M;
+
+    CVectorWriter stream(SER_NETWORK, PROTOCOL_VERSION, vEncoded, 0);
+    WriteCompactSize(stream, N);
+
+    BitWriter writer(vEncoded);
+    uint64_t nLast = 0;
+    for (uint64_t value : BuildHashedSet(elements)) {
+        GolombRiceEncode(writer, P, value - nLast);
+        nLast = value;
+    }
+    writer.Flush();
+}
+
+uint64_t GCSFilter::HashToRange(const Element& element) const
+{
+    uint64_t hash = CSipHasher(k0, k1).Write(element.data(), element.size()).Finalize();
+    return MapIntoRange(hash, F);
+}
+
+std::vector<uint64_t> GCSFilter::BuildHashedSet(const ElementSet& elements) const
+{
+    std::vector<uint64_t> vHashes;
+    vHashes.reserve(elements.size());
+    for (const Element& element : elements)
+        vHashes.push_back(HashToRange(element));
+    std::sort(vHashes.begin(), vHashes.end());
+    return vHashes;
+}
+
+bool GCSFilter::MatchInternal(const uint64_t* pElementHashes, size_t nSize) const
+{
+    BitReader reader(vEncoded, GetSizeOfCompactSize(N));
+
+    // Walk the sorted filter and the sorted queries side by side
+    uint64_t value = 0;
+    size_t i = 0;
+    for (uint32_t n = 0; n < N; n++) {
+        value += GolombRiceDecode(reader, P);
+        while (i < nSize && pElementHashes[i] < value)
+            i++;
+        if (i == nSize)
+            return false;
+        if (pElementHashes[i] == value)
+            return true;
+    }
+    return false;
+}
+
+bool GCSFilter::Match(const Element& element) const
+{
+    if (N == 0)
+        return false;
+    uint64_t hash = HashToRange(element);
+    return MatchInternal(&hash, 1);
+}
+
+bool GCSFilter::MatchAny(const ElementSet& elements) const
+{
+    if (N == 0 || elements.empty())
+        return false;
+    std::vector<uint64_t> vHashes = BuildHashedSet(elements);
+    return MatchInternal(vHashes.data(), vHashes.size());
+}
+
+static GCSFilter::ElementSet BasicFilterElements(const CBlock& block, const CBlockUndo& blockundo)
+{
+    GCSFilter::ElementSet elements;
+
+    for (const CTransactionRef& tx : block.vtx) {
+        for (const CTxOut& out : tx->vout) {
+            const CScript& script = out.scriptPubKey;
+            if (script.empty() || script[0] == OP_RETURN)
+                continue;
+            elements.emplace(script.begin(), script.end());
+        }
+    }
+
+    for (const CTxUndo& txundo : blockundo.vtxundo) {
+        for (const Coin& coin : txundo.vprevout) {
+            const CScript& script = coin.out.scriptPubKey;
+            if (script.empty())
+                continue;
+            elements.emplace(script.begin(), script.end());
+        }
+    }
+
+    return elements;
+}
+
+BlockFilter::BlockFilter(const uint256& blockHashIn, std::vector<unsigned char> vEncoded)
+    : blockHash(blockHashIn),
+      filter(ReadLE64(blockHashIn.begin()), ReadLE64(blockHashIn.begin() + 8), BASIC_FILTER_P, BASIC_FILTER_M, std::move(vEncoded))
+{
+}
+
+BlockFilter::BlockFilter(const CBlock& block, const CBlockUndo& blockundo)
+    : blockHash(block.GetHash()),
+      filter(ReadLE64(blockHash.begin()), ReadLE64(blockHash.begin() + 8), BASIC_FILTER_P, BASIC_FILTER_M, BasicFilterElements(block, blockundo))
+{
+}
+
+uint256 BlockFilter::GetHash() const
+{
+    const std::vector<unsigned char>& vEncoded = filter.GetEncoded();
+    return Hash(vEncoded.begin(), vEncoded.end());
+}
+
+void CBlockFilterIndexValue::SetPrevHeader(const uint256& prevHeader)
+{
+    header = Hash(hashFilter.begin(), hashFilter.end(), prevHeader.begin(), prevHeader.end());
+}
@@ -0,0 +1,122 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_BLOCKFILTER_H
+#define RAVEN_BLOCKFILTER_H
+
+#include "serialize.h"
+#include "uint256.h"
+
+#include <set>
+#include <stdint.h>
+#include <vector>
+
+class CBlock;
+class CBlockUndo;
+
+/**
+ * Golomb-coded set (as in BIP 158): a compact probabilistic set of byte strings. Every
+ * element is hashed into the range [0, N * M), and the sorted hashes are stored as
+ * Golomb-Rice coded differences with parameter P. Matching has no false negatives and
+ * a false positive rate of about 1 / M per queried element.
+ */
+class GCSFilter
+{
+public:
+    typedef std::vector<unsigned char> Element;
+    typedef std::set<Element> ElementSet;
+
+private:
+    uint64_t k0, k1;
+    uint8_t P;
+    uint32_t M;
+    uint32_t N;
+    uint64_t F;
+    std::vector<unsigned char> vEncoded;
+
+    uint64_t HashToRange(const Element& element) const;
+    std::vector<uint64_t> BuildHashedSet(const ElementSet& elements) const;
+    bool MatchInternal(const uint64_t* pElementHashes, size_t nSize) const;
+
+public:
+    /** An empty filter */
+    GCSFilter(uint64_t k0 = 0, uint64_t k1 = 0, uint8_t P = 0, uint32_t M = 0);
+    /** A filter of an encoded set, as returned by GetEncoded(). Throws std::ios_base::failure if it cannot be decoded. */
+    GCSFilter(uint64_t k0, uint64_t k1, uint8_t P, uint32_t M, std::vector<unsigned char> vEncodedIn);
+    /** A filter of the elements */
+    GCSFilter(uint64_t k0, uint64_t k1, uint8_t P, uint32_t M, const ElementSet& elements);
+
+    uint32_t GetN() const { return N; }
+    const std::vector<unsigned char>& GetEncoded() const { return vEncoded; }
+
+    /** Whether the element may be in the set */
+    bool Match(const Element& element) const;
+    /** Whether any of the elements may be in the set, in a single pass over the filter */
+    bool MatchAny(const ElementSet& elements) const;
+};
+
+/** Golomb-Rice parameter and inverse false positive rate of basic block filters */
+static const uint8_t BASIC_FILTER_P = 19;
+static const uint32_t BASIC_FILTER_M = 784931;
+
+/**
+ * The basic block filter: the scripts of all outputs created by a block (other than empty and
+ * OP_RETURN scripts), and of all outputs spent by it, taken from the block's undo data. Asset
+ * transfers are matched on their full asset scripts. The filter is keyed by the block hash.
+ */
+class BlockFilter
+{
+private:
+    uint256 blockHash;
+    GCSFilter filter;
+
+public:
+    BlockFilter() {}
+    BlockFilter(const uint256& blockHashIn, std::vector<unsigned char> vEncoded);
+    BlockFilter(const CBlock& block, const CBlockUndo& blockundo);
+
+    const uint256& GetBlockHash() const { return blockHash; }
+    const GCSFilter& GetFilter() const { return filter; }
+    const std::vector<unsigned char>& GetEncodedFilter() const { return filter.GetEncoded(); }
+
+    /** Double SHA256 of the encoded filter */
+    uint256 GetHash() const;
+};
+
+/** A block filter as stored in the index database, with its header */
+struct CBlockFilterIndexValue {
+    uint256 hashFilter;
+    uint256 header;
+    std::vector<unsigned char> vFilter;
+
+    ADD_SERIALIZE_METHODS;
+
+    template <typename Stream, typename Operation>
+    inline void SerializationOp(Stream& s, Operation ser_action) {
+        READWRITE(hashFilter);
+        READWRITE(header);
+        READWRITE(vFilter);
+    }
+
+    CBlockFilterIndexValue() {
+        SetNull();
+    }
+
+    explicit CBlockFilterIndexValue(const BlockFilter& filter) {
+        hashFilter = filter.GetHash();
+        header.SetNull();
+        vFilter = filter.GetEncodedFilter();
+    }
+
+    void SetNull() {
+        hashFilter.SetNull();
+        header.SetNull();
+        vFilter.clear();
+    }
+
+    /** Set the header, committing to the filter and to the header of the previous block's filter (null for the genesis block) */
+    void SetPrevHeader(const uint256& prevHeader);
+};
+
+#endif // RAVEN_BLOCKFILTER_H
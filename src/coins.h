@@ -243,6 +243,13 @@ public:
      */
     bool HaveCoinInCache(const COutPoint &outpoint) const;
 
+    /**
+     * Insert an unspent coin that was read from the backing view outside of this cache,
+     * e.g. by prefetch threads, exactly as FetchCoin would have. Nothing is done if the
+     * outpoint already has an entry, as that may hold newer (spent or modified) state.
+     */
+    void ImportCoin(const COutPoint &outpoint, Coin&& coin);
+
     /**
      * Return a reference to Coin in the cache, or a pruned one if not found. This is
      * more efficient than GetCoin.
@@ -250,3 +250,60 @@ uint64_t SipHashUint256Extra(uint64_t k0, uint64_t k1, const uint256& val, uint3
     SIPROUND;
     return v0 ^ v1 ^ v2 ^ v3;
 }
+
+namespace {
+
+/** The sph functions of an X16R algorithm, in hash selection order */
+struct X16RAlgorithm {
+    void (*init)(void* cc);
+    void (*update)(void* cc, const void* data, size_t len);
+    void (*close)(void* cc, void* dst);
+};
+
+const X16RAlgorithm x16rAlgorithms[16] = {
+    {sph_blake512_init, sph_blake512, sph_blake512_close},
+    {sph_bmw512_init, sph_bmw512, sph_bmw512_close},
+    {sph_groestl512_init, sph_groestl512, sph_groestl512_close},
+    {sph_jh512_init, sph_jh512, sph_jh512_close},
+    {sph_keccak512_init, sph_keccak512, sph_keccak512_close},
+    {sph_skein512_init, sph_skein512, sph_skein512_close},
+    {sph_luffa512_init, sph_luffa512, sph_luffa512_close},
+    {sph_cubehash512_init, sph_cubehash512, sph_cubehash512_close},
+    {sph_shavite512_init, sph_shavite512, sph_shavite512_close},
+    {sph_simd512_init, sph_simd512, sph_simd512_close},
+    {sph_echo512_init, sph_echo512, sph_echo512_close},
+    {sph_hamsi512_init, sph_hamsi512, sph_hamsi512_close},
+    {sph_fugue512_init, sph_fugue512, sph_fugue512_close},
+    {sph_shabal512_init, sph_shabal512, sph_shabal512_close},
+    {sph_whirlpool_init, sph_whirlpool, sph_whirlpool_close},
+    {sph_sha512_init, sph_sha512, sph_sha512_close},
+};
+
+} // namespace
+
+CX16RMidstate::CX16RMidstate(const unsigned char* pheader, const uint256& PrevBlockHash) : hashPrevBlock(PrevBlockHash)
+{
+    const X16RAlgorithm& algorithm = x16rAlgorithms[GetHashSelection(hashPrevBlock, 0)];
+    algorithm.init(&ctx);
+    algorithm.update(&ctx, pheader, MIDSTATE_BYTES);
+}
+
+uint256 CX16RMidstate::Finalize(const unsigned char* ptail) const
+{
+    // The sph contexts are plain structs, so the midstate is resumed from a copy
+    Context ctxRound = ctx;
+    uint512 hash[2];
+
+    const X16RAlgorithm& first = x16rAlgorithms[GetHashSelection(hashPrevBlock, 0)];
+    first.update(&ctxRound, ptail, TAIL_BYTES);
+    first.close(&ctxRound, &hash[0]);
+
+    for (int i = 1; i < 16; i++) {
+        const X16RAlgorithm& algorithm = x16rAlgorithms[GetHashSelection(hashPrevBlock, i)];
+        algorithm.init(&ctxRound);
+        algorithm.update(&ctxRound, &hash[(i - 1) & 1], 64);
+        algorithm.close(&ctxRound, &hash[i & 1]);
+    }
+
+    return hash[1].trim256();
+}
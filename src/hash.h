@@ -485,5 +485,48 @@ inline uint256 HashX16R(const T1 pbegin, const T1 pend, const uint256 PrevBlockH
     return hash[15].trim256();
 }
 
+/**
+ * X16R midstate of an 80 byte block header: the state of the first round after absorbing the
+ * first 64 header bytes. While searching for a nonce only the last 16 bytes change (the end of
+ * hashMerkleRoot, nTime, nBits and nNonce), and the algorithm of the first round is fixed by
+ * hashPrevBlock, so each hash only absorbs those 16 bytes before running the other rounds.
+ */
+class CX16RMidstate
+{
+public:
+    static const size_t MIDSTATE_BYTES = 64;
+    static const size_t TAIL_BYTES = 16;
+
+private:
+    union Context {
+        sph_blake512_context     blake;
+        sph_bmw512_context       bmw;
+        sph_groestl512_context   groestl;
+        sph_jh512_context        jh;
+        sph_keccak512_context    keccak;
+        sph_skein512_context     skein;
+        sph_luffa512_context     luffa;
+        sph_cubehash512_context  cubehash;
+        sph_shavite512_context   shavite;
+        sph_simd512_context      simd;
+        sph_echo512_context      echo;
+        sph_hamsi512_context     hamsi;
+        sph_fugue512_context     fugue;
+        sph_shabal512_context    shabal;
+        sph_whirlpool_context    whirlpool;
+        sph_sha512_context       sha512;
+    };
+
+    uint256 hashPrevBlock;
+    Context ctx;
+
+public:
+    /** Absorb the first MIDSTATE_BYTES bytes of a header with the previous block hash PrevBlockHash */
+    CX16RMidstate(const unsigned char* pheader, const uint256& PrevBlockHash);
+
+    /** The X16R hash of the header ending in the TAIL_BYTES bytes at ptail */
+    uint256 Finalize(const unsigned char* ptail) const;
+};
+
 
 #endif // RAVEN_HASH_H
@@ -0,0 +1,459 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "indexwriter.h"
+
+#include "assets/assets.h"
+#include "blockfilter.h"
+#include "chain.h"
+#include "chainparams.h"
+#include "hash.h"
+#include "init.h"
+#include "txdb.h"
+#include "ui_interface.h"
+#include "undo.h"
+#include "util.h"
+#include "validation.h"
+#include "warnings.h"
+
+#include <atomic>
+#include <functional>
+
+std::unique_ptr<CIndexWriter> g_indexwriter;
+
+/** Number of notified blocks kept for the writer, it reads the block from disk when it is further behind */
+static const size_t MAX_RECENT_BLOCKS = 32;
+/** Blocks read per build thread in each batch when catching up */
+static const size_t BLOCKS_PER_BUILD_THREAD = 16;
+
+/**
+ * Address index type (1 = P2PKH, P2PK or asset, 2 = P2SH, 0 = not indexed) and hash of a
+ * script, as used by the address and spent index keys.
+ */
+static int GetIndexAddress(const CScript& script, uint160& hashBytes, bool& fAsset, std::string& assetName, CAmount& assetAmount)
+{
+    fAsset = false;
+    if (script.IsPayToScriptHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin() + 2, script.begin() + 22));
+        return 2;
+    } else if (script.IsPayToPublicKeyHash()) {
+        hashBytes = uint160(std::vector<unsigned char>(script.begin() + 3, script.begin() + 23));
+        return 1;
+    } else if (script.IsPayToPublicKey()) {
+        hashBytes = Hash160(script.begin() + 1, script.end() - 1);
+        return 1;
+    }
+
+    hashBytes.SetNull();
+    /** RVN START */
+    if (AreAssetsDeployed() && ParseAssetScript(script, hashBytes, assetName, assetAmount)) {
+        fAsset = true;
+        return 1;
+    }
+    /** RVN END */
+    return 0;
+}
+
+static void AddBlockFilter(const CBlock& block, const CBlockUndo& blockundo, CIndexUpdate& update)
+{
+    BlockFilter filter(block, blockundo);
+    update.vBlockFilterIndex.push_back(std::make_pair(block.GetHash(), CBlockFilterIndexValue(filter)));
+}
+
+bool BuildIndexUpdate(const CBlock& block, const CBlockUndo& blockundo, int nHeight, bool fConnect, CIndexUpdate& update)
+{
+    if (blockundo.vtxundo.size() + 1 != block.vtx.size())
+        return error("%s: block and undo data inconsistent", __func__);
+
+    // Filters of disconnected blocks are kept, they are stored by block hash
+    if (fConnect && fBlockFilterIndex)
+        AddBlockFilter(block, blockundo, update);
+
+    update.fEraseAddressIndex = !fConnect;
+
+    // Disconnecting walks the block backwards, so that entries of outputs spent within
+    // the block are erased after they are restored by the spending input.
+    for (unsigned int n = 0; n < block.vtx.size(); n++) {
+        const unsigned int i = fConnect ? n : block.vtx.size() - 1 - n;
+        const CTransaction& tx = *block.vtx[i];
+        const uint256 txhash = tx.GetHash();
+
+        std::vector<unsigned int> vOrder;
+
+        // Inputs
+        if (i > 0 && (fAddressIndex || fSpentIndex)) {
+            const CTxUndo& txundo = blockundo.vtxundo[i - 1];
+            if (txundo.vprevout.size() != tx.vin.size())
+                return error("%s: transaction and undo data inconsistent", __func__);
+
+            for (unsigned int m = 0; m < tx.vin.size(); m++) {
+                const unsigned int j = fConnect ? m : tx.vin.size() - 1 - m;
+                const COutPoint& prevout = tx.vin[j].prevout;
+                const Coin& coin = txundo.vprevout[j];
+                const CScript& script = coin.out.scriptPubKey;
+
+                uint160 hashBytes;
+                bool fAsset;
+                std::string assetName;
+                CAmount assetAmount = 0;
+                int addressType = GetIndexAddress(script, hashBytes, fAsset, assetName, assetAmount);
+
+                if (fAddressIndex && addressType > 0) {
+                    if (fAsset) {
+                        update.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, nHeight, i, txhash, j, true), assetAmount * -1));
+                        update.vAddressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, prevout.hash, prevout.n),
+                                fConnect ? CAddressUnspentValue() : CAddressUnspentValue(assetAmount, script, coin.nHeight)));
+                    } else {
+                        update.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, j, true), coin.out.nValue * -1));
+                        update.vAddressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, prevout.hash, prevout.n),
+                                fConnect ? CAddressUnspentValue() : CAddressUnspentValue(coin.out.nValue, script, coin.nHeight)));
+                    }
+                }
+
+                if (fSpentIndex) {
+                    update.vSpentIndex.push_back(std::make_pair(CSpentIndexKey(prevout.hash, prevout.n),
+                            fConnect ? CSpentIndexValue(txhash, j, nHeight, coin.out.nValue, addressType, hashBytes) : CSpentIndexValue()));
+                }
+            }
+        }
+
+        // Outputs
+        if (fAddressIndex) {
+            for (unsigned int m = 0; m < tx.vout.size(); m++) {
+                const unsigned int k = fConnect ? m : tx.vout.size() - 1 - m;
+                const CTxOut& out = tx.vout[k];
+
+                uint160 hashBytes;
+                bool fAsset;
+                std::string assetName;
+                CAmount assetAmount = 0;
+                int addressType = GetIndexAddress(out.scriptPubKey, hashBytes, fAsset, assetName, assetAmount);
+                if (addressType == 0)
+                    continue;
+
+                if (fAsset) {
+                    update.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, nHeight, i, txhash, k, false), assetAmount));
+                    update.vAddressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, txhash, k),
+                            fConnect ? CAddressUnspentValue(assetAmount, out.scriptPubKey, nHeight) : CAddressUnspentValue()));
+                } else {
+                    update.vAddressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, nHeight, i, txhash, k, false), out.nValue));
+                    update.vAddressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, txhash, k),
+                            fConnect ? CAddressUnspentValue(out.nValue, out.scriptPubKey, nHeight) : CAddressUnspentValue()));
+                }
+            }
+        }
+    }
+
+    return true;
+}
+
+static void FatalIndexError(const std::string& strMessage)
+{
+    SetMiscWarning(strMessage);
+    LogPrintf("*** %s\n", strMessage);
+    uiInterface.ThreadSafeMessageBox(_("Error: A fatal internal error occurred, see debug.log for details"), "", CClientUIInterface::MSG_ERROR);
+    StartShutdown();
+}
+
+CIndexWriter::CIndexWriter(int nBuildThreadsIn) : nBuildThreads(std::max(1, nBuildThreadsIn)), fWake(false), fStop(false), pindexBestBlock(nullptr)
+{
+}
+
+CIndexWriter::~CIndexWriter()
+{
+    Stop();
+}
+
+bool CIndexWriter::Start()
+{
+    {
+        LOCK(cs_main);
+        uint256 hashBestBlock;
+        const CBlockIndex* pindex = nullptr;
+        if (pindexdb->ReadIndexBestBlock(hashBestBlock)) {
+            // A null best block means the indexes are to be built from the genesis block
+            if (!hashBestBlock.IsNull()) {
+                BlockMap::const_iterator it = mapBlockIndex.find(hashBestBlock);
+                if (it == mapBlockIndex.end())
+                    return error("%s: index best block %s not found in the block index", __func__, hashBestBlock.ToString());
+                pindex = it->second;
+            }
+        } else {
+            // Databases from before the writer was introduced kept the indexes in step with the chain
+            pindex = chainActive.Tip();
+        }
+
+        std::lock_guard<std::mutex> lock(mutex);
+        pindexBestBlock = pindex;
+        fStop = false;
+        LogPrintf("%s: indexes are at block %s\n", __func__, pindex ? pindex->GetBlockHash().ToString() : "none");
+    }
+
+    RegisterValidationInterface(this);
+    threadSync = std::thread(&TraceThread<std::function<void()> >, "idxwriter", std::function<void()>(std::bind(&CIndexWriter::ThreadSync, this)));
+    return true;
+}
+
+void CIndexWriter::Stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        fStop = true;
+    }
+    cvWake.notify_all();
+    cvBestBlock.notify_all();
+
+    if (threadSync.joinable()) {
+        threadSync.join();
+        UnregisterValidationInterface(this);
+    }
+}
+
+const CBlockIndex* CIndexWriter::GetBestBlock()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return pindexBestBlock;
+}
+
+bool CIndexWriter::IsBuilding()
+{
+    LOCK(cs_main);
+    const CBlockIndex* pindexBest = GetBestBlock();
+    if (!chainActive.Tip())
+        return false;
+    if (!pindexBest)
+        return true;
+    const CBlockIndex* pindexFork = chainActive.FindFork(pindexBest);
+    return !pindexFork || chainActive.Height() - pindexFork->nHeight > MAX_INDEX_QUERY_BLOCKS_BEHIND;
+}
+
+void CIndexWriter::BlockUntilSyncedToCurrentChain()
+{
+    const CBlockIndex* pindexTip;
+    {
+        LOCK(cs_main);
+        pindexTip = chainActive.Tip();
+    }
+    if (!pindexTip)
+        return;
+
+    std::unique_lock<std::mutex> lock(mutex);
+    cvBestBlock.wait(lock, [this, pindexTip] {
+        return fStop || (pindexBestBlock && pindexBestBlock->GetAncestor(pindexTip->nHeight) == pindexTip);
+    });
+}
+
+void CIndexWriter::AddRecentBlock(const std::shared_ptr<const CBlock>& pblock)
+{
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        // Blocks the writer never got to (e.g. connected and disconnected again in between) are dropped eventually
+        if (mapRecentBlocks.size() >= MAX_RECENT_BLOCKS)
+            mapRecentBlocks.erase(mapRecentBlocks.begin());
+        mapRecentBlocks.emplace(pblock->GetHash(), pblock);
+        fWake = true;
+    }
+    cvWake.notify_all();
+}
+
+std::shared_ptr<const CBlock> CIndexWriter::TakeRecentBlock(const uint256& hash)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    std::shared_ptr<const CBlock> pblock;
+    auto it = mapRecentBlocks.find(hash);
+    if (it != mapRecentBlocks.end()) {
+        pblock = it->second;
+        mapRecentBlocks.erase(it);
+    }
+    return pblock;
+}
+
+void CIndexWriter::BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted)
+{
+    AddRecentBlock(pblock);
+}
+
+void CIndexWriter::BlockDisconnected(const std::shared_ptr<const CBlock>& pblock)
+{
+    AddRecentBlock(pblock);
+}
+
+void CIndexWriter::NextBlocks(std::vector<CBlockJob>& vJobs)
+{
+    LOCK(cs_main);
+    const CBlockIndex* pindexIndexed = GetBestBlock();
+    const CBlockIndex* pindexFork = pindexIndexed ? chainActive.FindFork(pindexIndexed) : nullptr;
+    const CBlockIndex* pindexNext = nullptr;
+    if (!pindexIndexed) {
+        pindexNext = chainActive.Genesis();
+    } else if (pindexFork == pindexIndexed) {
+        pindexNext = chainActive.Next(pindexIndexed);
+    } else if (pindexFork != chainActive.Tip()) {
+        // The last indexed block is no longer in the active chain, roll it back
+        vJobs.emplace_back(pindexIndexed, false);
+    }
+    // Otherwise the indexes are ahead of the active chain on the same branch (e.g. the
+    // chainstate was not flushed before a crash) and the chain will catch up with them.
+
+    const size_t nMaxBlocks = nBuildThreads * BLOCKS_PER_BUILD_THREAD;
+    for (; pindexNext && vJobs.size() < nMaxBlocks; pindexNext = chainActive.Next(pindexNext))
+        vJobs.emplace_back(pindexNext, true);
+
+    for (CBlockJob& job : vJobs) {
+        job.posBlock = job.pindex->GetBlockPos();
+        job.posUndo = job.pindex->GetUndoPos();
+        job.pblock = TakeRecentBlock(job.pindex->GetBlockHash());
+    }
+}
+
+bool CIndexWriter::ReadBlock(CBlockJob& job)
+{
+    const CBlockIndex* pindex = job.pindex;
+
+    // The genesis block's outputs are not spendable and were never indexed, it only has a block filter
+    if (!pindex->pprev) {
+        if (!job.fConnect)
+            return error("%s: cannot disconnect the genesis block", __func__);
+        if (!fBlockFilterIndex)
+            return true;
+    }
+
+    if (!job.pblock) {
+        std::shared_ptr<CBlock> pblockRead = std::make_shared<CBlock>();
+        if (!ReadBlockFromDisk(*pblockRead, job.posBlock, Params().GetConsensus()) || pblockRead->GetHash() != pindex->GetBlockHash())
+            return error("%s: failed to read block %s from disk", __func__, pindex->GetBlockHash().ToString());
+        job.pblock = pblockRead;
+    }
+
+    if (!pindex->pprev) {
+        AddBlockFilter(*job.pblock, CBlockUndo(), job.update);
+        return true;
+    }
+
+    CBlockUndo blockundo;
+    if (job.posUndo.IsNull() || !UndoReadFromDisk(blockundo, job.posUndo, pindex->pprev->GetBlockHash()))
+        return error("%s: failed to read undo data of block %s", __func__, pindex->GetBlockHash().ToString());
+
+    return BuildIndexUpdate(*job.pblock, blockundo, pindex->nHeight, job.fConnect, job.update);
+}
+
+void CIndexWriter::ReadBlocks(std::vector<CBlockJob>& vJobs)
+{
+    int nThreads = std::min<int>(nBuildThreads, vJobs.size());
+    if (nThreads <= 1) {
+        for (CBlockJob& job : vJobs)
+            job.fOk = ReadBlock(job);
+        return;
+    }
+
+    std::atomic<size_t> nNext(0);
+    auto worker = [&vJobs, &nNext]() {
+        for (size_t i = nNext++; i < vJobs.size(); i = nNext++)
+            vJobs[i].fOk = ReadBlock(vJobs[i]);
+    };
+    std::vector<std::thread> vThreads;
+    for (int i = 0; i < nThreads - 1; i++)
+        vThreads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : vThreads)
+        thread.join();
+}
+
+bool CIndexWriter::WriteBlock(CBlockJob& job)
+{
+    const CBlockIndex* pindex = job.pindex;
+
+    // Timestamp entries of disconnected blocks are kept, but flagged as no longer in the active chain.
+    // They depend on the previous block's entry, so they are only computed here, in chain order.
+    if (!job.fConnect && fTimestampIndex) {
+        unsigned int logicalTS = 0;
+        if (pindexdb->ReadTimestampBlockIndex(pindex->GetBlockHash(), logicalTS))
+            job.update.vTimestampIndex.push_back(std::make_pair(CTimestampIndexKey(logicalTS, pindex->GetBlockHash()), CTimestampIndexValue(false)));
+    }
+    if (job.fConnect && fTimestampIndex && pindex->pprev) {
+        unsigned int logicalTS = pindex->nTime;
+        unsigned int prevLogicalTS = 0;
+
+        // retrieve logical timestamp of the previous block
+        if (!pindexdb->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
+            LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
+
+        if (logicalTS <= prevLogicalTS) {
+            logicalTS = prevLogicalTS + 1;
+            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
+        }
+        job.update.vTimestampIndex.push_back(std::make_pair(CTimestampIndexKey(logicalTS, pindex->GetBlockHash()), CTimestampIndexValue(true)));
+    }
+
+    // Filter headers chain up from the genesis block
+    for (auto& entry : job.update.vBlockFilterIndex) {
+        CBlockFilterIndexValue prev;
+        if (pindex->pprev && !pindexdb->ReadBlockFilter(pindex->pprev->GetBlockHash(), prev))
+            return error("%s: missing block filter of block %s", __func__, pindex->pprev->GetBlockHash().ToString());
+        entry.second.SetPrevHeader(prev.header);
+    }
+
+    const CBlockIndex* pindexNewBest = job.fConnect ? pindex : pindex->pprev;
+    if (!pindexdb->WriteIndexUpdate(job.update, pindexNewBest->GetBlockHash()))
+        return error("%s: failed to write index changes of block %s", __func__, pindex->GetBlockHash().ToString());
+
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        pindexBestBlock = pindexNewBest;
+    }
+    cvBestBlock.notify_all();
+    return true;
+}
+
+void CIndexWriter::ThreadSync()
+{
+    int64_t nLastProgressLog = 0;
+    while (true) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            if (fStop)
+                return;
+            fWake = false;
+        }
+
+        std::vector<CBlockJob> vJobs;
+        NextBlocks(vJobs);
+
+        if (vJobs.empty()) {
+            std::unique_lock<std::mutex> lock(mutex);
+            cvWake.wait(lock, [this] { return fWake || fStop; });
+            continue;
+        }
+
+        ReadBlocks(vJobs);
+
+        for (CBlockJob& job : vJobs) {
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (fStop)
+                    return;
+            }
+            if (!job.fOk || !WriteBlock(job)) {
+                FatalIndexError(strprintf("Failed to %s block %s in the address, spent and timestamp indexes", job.fConnect ? "add" : "remove", job.pindex->GetBlockHash().ToString()));
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    fStop = true;
+                }
+                cvBestBlock.notify_all();
+                return;
+            }
+        }
+
+        if (vJobs.size() > 1 && GetTime() - nLastProgressLog >= 30) {
+            LogPrintf("Building indexes: at block %d (%s)\n", vJobs.back().pindex->nHeight, vJobs.back().pindex->GetBlockHash().ToString());
+            nLastProgressLog = GetTime();
+        }
+    }
+}
+
+void BlockUntilIndexesSynced()
+{
+    if (g_indexwriter)
+        g_indexwriter->BlockUntilSyncedToCurrentChain();
+}
@@ -0,0 +1,115 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_INDEXWRITER_H
+#define RAVEN_INDEXWRITER_H
+
+#include "chain.h"
+#include "txdb.h"
+#include "validationinterface.h"
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+class CBlock;
+class CBlockUndo;
+class uint256;
+
+/** Default for -indexbuildthreads, the number of threads reading blocks while the indexes catch up */
+static const int DEFAULT_INDEX_BUILD_THREADS = 4;
+static const int MAX_INDEX_BUILD_THREADS = 16;
+/** Queries are refused instead of waiting while the indexes are further behind the tip than this */
+static const int MAX_INDEX_QUERY_BLOCKS_BEHIND = 100;
+
+/**
+ * Collect the address and spent index changes (as enabled by -addressindex and -spentindex)
+ * of connecting a block, or of disconnecting it when fConnect is false. The spent coins are
+ * taken from the block's undo data.
+ */
+bool BuildIndexUpdate(const CBlock& block, const CBlockUndo& blockundo, int nHeight, bool fConnect, CIndexUpdate& update);
+
+/**
+ * Maintains the address, spent and timestamp indexes on a background thread, so that
+ * connecting blocks does not wait on their database writes.
+ *
+ * The writer follows the active chain from the block recorded as the index best block,
+ * which is written atomically with each block's index changes. Blocks are read back from
+ * the validation interface notifications when available, otherwise from disk together with
+ * their undo data, so a writer that fell behind (or is started on an older database) simply
+ * catches up. Blocks that get reorganized away are removed again the same way.
+ *
+ * Enabling an index on an existing node resets the index best block, and the writer then
+ * builds the indexes from the genesis block while the node keeps running. The best block is
+ * shared, so the indexes that were already enabled are built again as well. When catching up,
+ * batches of blocks are read and turned into index changes by several threads, and written
+ * in chain order.
+ */
+class CIndexWriter final : public CValidationInterface
+{
+private:
+    /** A block to add to or remove from the indexes */
+    struct CBlockJob
+    {
+        const CBlockIndex* pindex;
+        bool fConnect;
+        CDiskBlockPos posBlock;
+        CDiskBlockPos posUndo;
+        std::shared_ptr<const CBlock> pblock;
+        CIndexUpdate update;
+        bool fOk;
+
+        CBlockJob(const CBlockIndex* pindexIn, bool fConnectIn) : pindex(pindexIn), fConnect(fConnectIn), fOk(false) {}
+    };
+
+    const int nBuildThreads;
+    std::mutex mutex;
+    std::condition_variable cvWake;
+    std::condition_variable cvBestBlock;
+    bool fWake;
+    bool fStop;
+    //! Last block whose changes are in the indexes
+    const CBlockIndex* pindexBestBlock;
+    //! Blocks from recent notifications, saving the writer a disk read
+    std::map<uint256, std::shared_ptr<const CBlock> > mapRecentBlocks;
+
+    std::thread threadSync;
+
+    void ThreadSync();
+    void NextBlocks(std::vector<CBlockJob>& vJobs);
+    static bool ReadBlock(CBlockJob& job);
+    void ReadBlocks(std::vector<CBlockJob>& vJobs);
+    bool WriteBlock(CBlockJob& job);
+    void AddRecentBlock(const std::shared_ptr<const CBlock>& pblock);
+    std::shared_ptr<const CBlock> TakeRecentBlock(const uint256& hash);
+
+protected:
+    void BlockConnected(const std::shared_ptr<const CBlock>& pblock, const CBlockIndex* pindex, const std::vector<CTransactionRef>& vtxConflicted) override;
+    void BlockDisconnected(const std::shared_ptr<const CBlock>& pblock) override;
+
+public:
+    explicit CIndexWriter(int nBuildThreadsIn = DEFAULT_INDEX_BUILD_THREADS);
+    ~CIndexWriter();
+
+    /** Load the index best block and start following the chain. Requires the block index to be loaded. */
+    bool Start();
+    /** Stop the writer thread and unregister from validation notifications */
+    void Stop();
+
+    const CBlockIndex* GetBestBlock();
+    /** Whether the indexes are too far behind the active chain to serve queries, as while they are being built */
+    bool IsBuilding();
+
+    /** Wait until the indexes include the current active chain tip. Must not be called with cs_main held. */
+    void BlockUntilSyncedToCurrentChain();
+};
+
+extern std::unique_ptr<CIndexWriter> g_indexwriter;
+
+/** Wait for the index writer, if running, to reach the current tip. Must not be called with cs_main held. */
+void BlockUntilIndexesSynced();
+
+#endif // RAVEN_INDEXWRITER_H
@@ -12,6 +12,7 @@
 
 #include "addrman.h"
 #include "amount.h"
+#include "blockconnectstats.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -20,6 +21,7 @@
 #include "fs.h"
 #include "httpserver.h"
 #include "httprpc.h"
+#include "indexwriter.h"
 #include "key.h"
 #include "validation.h"
 #include "miner.h"
@@ -37,6 +39,7 @@
 #include "script/standard.h"
 #include "script/sigcache.h"
 #include "scheduler.h"
+#include "stratum.h"
 #include "timedata.h"
 #include "txdb.h"
 #include "txmempool.h"
@@ -167,6 +170,7 @@ void Interrupt(boost::thread_group& threadGroup)
     InterruptRPC();
     InterruptREST();
     InterruptTorControl();
+    InterruptStratumServer();
     if (g_connman)
         g_connman->Interrupt();
     threadGroup.interrupt_all();
@@ -195,6 +199,7 @@ void Shutdown()
     FlushWallets();
 #endif
     GenerateRavens(false, 0, Params());
+    StopStratumServer();
 
     MapPort(false);
 
@@ -205,6 +210,11 @@ void Shutdown()
     peerLogic.reset();
     g_connman.reset();
 
+    if (g_indexwriter) {
+        g_indexwriter->Stop();
+        g_indexwriter.reset();
+    }
+
     StopTorControl();
     if (fDumpMempoolLater && gArgs.GetArg("-persistmempool", DEFAULT_PERSIST_MEMPOOL)) {
         DumpMempool();
@@ -250,6 +260,8 @@ void Shutdown()
         pcoinsdbview = nullptr;
         delete pblocktree;
         pblocktree = nullptr;
+        delete pindexdb;
+        pindexdb = nullptr;
         delete passets;
         passets = nullptr;
         delete passetsdb;
@@ -343,6 +355,7 @@ std::string HelpMessage(HelpMessageMode mode)
     if (showDebug)
         strUsage += HelpMessageOpt("-blocksonly", strprintf(_("Whether to operate in a blocks only mode (default: %u)"), DEFAULT_BLOCKSONLY));
     strUsage +=HelpMessageOpt("-assumevalid=<hex>", strprintf(_("If this block is in the chain assume that it and its ancestors are valid and potentially skip their script verification (0 to verify all, default: %s, testnet: %s)"), defaultChainParams->GetConsensus().defaultAssumeValid.GetHex(), testnetChainParams->GetConsensus().defaultAssumeValid.GetHex()));
+    strUsage += HelpMessageOpt("-connectstatsblocks=<n>", strprintf(_("Keep per stage connect times of the last <n> blocks for getblockconnectstats (default: %u)"), DEFAULT_CONNECT_STATS_BLOCKS));
     strUsage += HelpMessageOpt("-conf=<file>", strprintf(_("Specify configuration file (default: %s)"), RAVEN_CONF_FILENAME));
     if (mode == HMM_RAVEND)
     {
@@ -368,17 +381,21 @@ std::string HelpMessage(HelpMessageMode mode)
         strUsage += HelpMessageOpt("-minimumchainwork=<hex>", strprintf("Minimum work assumed to exist on a valid chain in hex (default: %s, testnet: %s)", defaultChainParams->GetConsensus().nMinimumChainWork.GetHex(), testnetChainParams->GetConsensus().nMinimumChainWork.GetHex()));
     }
     strUsage += HelpMessageOpt("-persistmempool", strprintf(_("Whether to save the mempool on shutdown and load on restart (default: %u)"), DEFAULT_PERSIST_MEMPOOL));
+    strUsage += HelpMessageOpt("-blockprefetch=<n>", strprintf(_("Set the number of threads reading the inputs of a block from the chainstate before connecting it (0 to %d, 0 = disable, default: %d)"),
+        MAX_BLOCK_PREFETCH_THREADS, DEFAULT_BLOCK_PREFETCH_THREADS));
     strUsage += HelpMessageOpt("-blockreconstructionextratxn=<n>", strprintf(_("Extra transactions to keep in memory for compact block reconstructions (default: %u)"), DEFAULT_BLOCK_RECONSTRUCTION_EXTRA_TXN));
     strUsage += HelpMessageOpt("-par=<n>", strprintf(_("Set the number of script verification threads (%u to %d, 0 = auto, <0 = leave that many cores free, default: %d)"),
         -GetNumCores(), MAX_SCRIPTCHECK_THREADS, DEFAULT_SCRIPTCHECK_THREADS));
+    strUsage += HelpMessageOpt("-parallelconnect", strprintf(_("Check the inputs of independent block transactions in parallel on the -par threads when connecting blocks (default: %u)"), DEFAULT_PARALLEL_CONNECT));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-pid=<file>", strprintf(_("Specify pid file (default: %s)"), RAVEN_PID_FILENAME));
 #endif
-    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex and -rescan. "
+    strUsage += HelpMessageOpt("-prune=<n>", strprintf(_("Reduce storage requirements by enabling pruning (deleting) of old blocks. This allows the pruneblockchain RPC to be called to delete specific blocks, and enables automatic pruning of old blocks if a target size in MiB is provided. This mode is incompatible with -txindex, -addressindex, -spentindex, -timestampindex, -blockfilterindex and -rescan. "
             "Warning: Reverting this setting requires re-downloading the entire blockchain. "
             "(default: 0 = disable pruning blocks, 1 = allow manual pruning via RPC, >%u = automatically prune block files to stay under the specified target size in MiB)"), MIN_DISK_SPACE_FOR_BLOCK_FILES / 1024 / 1024));
     strUsage += HelpMessageOpt("-reindex-chainstate", _("Rebuild chain state from the currently indexed blocks"));
     strUsage += HelpMessageOpt("-reindex", _("Rebuild chain state and block index from the blk*.dat files on disk"));
+    strUsage += HelpMessageOpt("-reindex-index", _("Rebuild only the block index from the blk*.dat and rev*.dat files on disk, keeping the chain state and assets database"));
 #ifndef WIN32
     strUsage += HelpMessageOpt("-sysperms", _("Create new files with system default permissions, instead of umask 077 (only effective with disabled wallet functionality)"));
 #endif
@@ -387,6 +404,10 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-addressindex", strprintf(_("Maintain a full address index, used to query for the balance, txids and unspent outputs for addresses (default: %u)"), DEFAULT_ADDRESSINDEX));
     strUsage += HelpMessageOpt("-timestampindex", strprintf(_("Maintain a timestamp index for block hashes, used to query blocks hashes by a range of timestamps (default: %u)"), DEFAULT_TIMESTAMPINDEX));
     strUsage += HelpMessageOpt("-spentindex", strprintf(_("Maintain a full spent index, used to query the spending txid and input index for an outpoint (default: %u)"), DEFAULT_SPENTINDEX));
+    strUsage += HelpMessageOpt("-blockfilterindex", strprintf(_("Maintain a compact filter of the scripts of every block, used by light clients and wallet backends through the getblockfilter rpc call. Turning an index on for an existing node also rebuilds the address, spent and timestamp indexes that are already on (default: %u)"), DEFAULT_BLOCKFILTERINDEX));
+    strUsage += HelpMessageOpt("-addressquerythreads=<n>", strprintf(_("Number of threads reading the address index for queries of several addresses (1 to %d, default: %d)"), MAX_ADDRESS_QUERY_THREADS, DEFAULT_ADDRESS_QUERY_THREADS));
+    strUsage += HelpMessageOpt("-indexbuildthreads=<n>", strprintf(_("Number of threads reading blocks while the address, spent and timestamp indexes are built or catch up (1 to %d, default: %d)"), MAX_INDEX_BUILD_THREADS, DEFAULT_INDEX_BUILD_THREADS));
+    strUsage += HelpMessageOpt("-indexdbcache=<n>", strprintf(_("Set the cache size in megabytes of the address, spent and timestamp index database, in addition to -dbcache (%d to %d, default: %d)"), nMinDbCache, nMaxDbCache, nDefaultIndexDBCache));
 
     strUsage += HelpMessageGroup(_("Connection options:"));
     strUsage += HelpMessageOpt("-addnode=<ip>", _("Add a node to connect to and attempt to keep the connection open (see the `addnode` RPC command help for more info)"));
@@ -508,6 +529,12 @@ std::string HelpMessage(HelpMessageMode mode)
     strUsage += HelpMessageOpt("-blockmintxfee=<amt>", strprintf(_("Set lowest fee rate (in %s/kB) for transactions to be included in block creation. (default: %s)"), CURRENCY_UNIT, FormatMoney(DEFAULT_BLOCK_MIN_TX_FEE)));
     if (showDebug)
         strUsage += HelpMessageOpt("-blockversion=<n>", "Override block version to test forking scenarios");
+    strUsage += HelpMessageOpt("-longpollfeethreshold=<n>", strprintf(_("Return long-polling getblocktemplate calls once new transactions would add <n> percent to the fees of the last template, 0 to only check the mempool every minute (default: %d)"), DEFAULT_LONGPOLL_FEE_THRESHOLD));
+    strUsage += HelpMessageOpt("-stratum", strprintf(_("Serve block templates to miners over the Stratum protocol (default: %u)"), DEFAULT_STRATUM_ENABLE));
+    strUsage += HelpMessageOpt("-stratumaddress=<addr>", _("Address that blocks mined through the Stratum server pay to (required with -stratum)"));
+    strUsage += HelpMessageOpt("-stratumbind=<addr>", _("Bind the unauthenticated Stratum server to given address. Use [host]:port notation for IPv6. This option can be specified multiple times (default: 127.0.0.1)"));
+    strUsage += HelpMessageOpt("-stratumport=<port>", strprintf(_("Listen for Stratum connections on <port> (default: %u)"), DEFAULT_STRATUM_PORT));
+    strUsage += HelpMessageOpt("-stratumdifficulty=<n>", strprintf(_("Share difficulty announced to Stratum miners (default: %s)"), DEFAULT_STRATUM_DIFFICULTY));
 
     strUsage += HelpMessageGroup(_("RPC server options:"));
     strUsage += HelpMessageOpt("-server", _("Accept command line and JSON-RPC commands"));
@@ -914,6 +941,12 @@ bool AppInitParameterInteraction()
     if (gArgs.GetArg("-prune", 0)) {
         if (gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX))
             return InitError(_("Prune mode is incompatible with -txindex."));
+        if (gArgs.GetBoolArg("-reindex-index", false))
+            return InitError(_("Prune mode is incompatible with -reindex-index."));
+        // The index writer reads blocks and undo data behind the tip, which pruning could delete first
+        if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) ||
+                gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX) || gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX))
+            return InitError(_("Prune mode is incompatible with -addressindex, -spentindex, -timestampindex and -blockfilterindex."));
     }
 
     // -bind and -whitebind can't be set when not listening
@@ -1034,6 +1067,11 @@ bool AppInitParameterInteraction()
         nScriptCheckThreads = 0;
     else if (nScriptCheckThreads > MAX_SCRIPTCHECK_THREADS)
         nScriptCheckThreads = MAX_SCRIPTCHECK_THREADS;
+    fParallelConnect = gArgs.GetBoolArg("-parallelconnect", DEFAULT_PARALLEL_CONNECT);
+
+    nBlockPrefetchThreads = std::max(0, std::min((int)gArgs.GetArg("-blockprefetch", DEFAULT_BLOCK_PREFETCH_THREADS), MAX_BLOCK_PREFETCH_THREADS));
+    nAddressQueryThreads = std::max(1, std::min((int)gArgs.GetArg("-addressquerythreads", DEFAULT_ADDRESS_QUERY_THREADS), MAX_ADDRESS_QUERY_THREADS));
+    blockConnectStats.SetMaxBlocks(std::max<int64_t>(0, gArgs.GetArg("-connectstatsblocks", DEFAULT_CONNECT_STATS_BLOCKS)));
 
     // block pruning; get the amount of disk space (in MiB) to allot for block & undo files
     int64_t nPruneArg = gArgs.GetArg("-prune", 0);
@@ -1253,8 +1291,16 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     if (nScriptCheckThreads) {
         for (int i=0; i<nScriptCheckThreads-1; i++)
             threadGroup.create_thread(&ThreadScriptCheck);
+        if (fParallelConnect) {
+            for (int i=0; i<nScriptCheckThreads-1; i++)
+                threadGroup.create_thread(&ThreadInputCheck);
+        }
     }
 
+    // The validation thread takes part in the prefetch as well
+    for (int i=0; i<nBlockPrefetchThreads-1; i++)
+        threadGroup.create_thread(&ThreadInputPrefetch);
+
     // Start the lightweight task scheduler thread
     CScheduler::Function serviceLoop = boost::bind(&CScheduler::serviceQueue, &scheduler);
     threadGroup.create_thread(boost::bind(&TraceThread<CScheduler::Function>, "scheduler", serviceLoop));
@@ -1402,6 +1448,7 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
     fReindex = gArgs.GetBoolArg("-reindex", false);
     bool fReindexChainState = gArgs.GetBoolArg("-reindex-chainstate", false);
+    bool fReindexIndex = !fReindex && gArgs.GetBoolArg("-reindex-index", false);
 
     // block tree db settings
     size_t dbMaxFileSize = gArgs.GetArg("-dbmaxfilesize", DEFAULT_DB_MAX_FILE_SIZE) << 20;
@@ -1420,10 +1467,19 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
     nCoinDBCache = std::min(nCoinDBCache, nMaxCoinsDBCache << 20); // cap total coins db cache
     nTotalCache -= nCoinDBCache;
     nCoinCacheUsage = nTotalCache; // the rest goes to in-memory cache
+    // The optional indexes get their own budget, so their cache pressure does not affect the block tree and chainstate
+    int64_t nIndexDBCache = nMinIndexDBCache << 20;
+    if (gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX) || gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX) || gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)
+            || gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+        nIndexDBCache = gArgs.GetArg("-indexdbcache", nDefaultIndexDBCache) << 20;
+        nIndexDBCache = std::max(nIndexDBCache, nMinDbCache << 20);
+        nIndexDBCache = std::min(nIndexDBCache, nMaxDbCache << 20);
+    }
     int64_t nMempoolSizeMax = gArgs.GetArg("-maxmempool", DEFAULT_MAX_MEMPOOL_SIZE) * 1000000;
     LogPrintf("Cache configuration:\n");
     LogPrintf("* Using %.1fMiB for block index database\n", nBlockTreeDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for chain state database\n", nCoinDBCache * (1.0 / 1024 / 1024));
+    LogPrintf("* Using %.1fMiB for address, spent and timestamp index database\n", nIndexDBCache * (1.0 / 1024 / 1024));
     LogPrintf("* Using %.1fMiB for in-memory UTXO set (plus up to %.1fMiB of unused mempool space)\n", nCoinCacheUsage * (1.0 / 1024 / 1024), nMempoolSizeMax * (1.0 / 1024 / 1024));
 
     bool fLoaded = false;
@@ -1442,7 +1498,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                 delete pcoinscatcher;
                 delete pblocktree;
 
-                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReset, dbMaxFileSize);
+                pblocktree = new CBlockTreeDB(nBlockTreeDBCache, false, fReset || fReindexIndex, dbMaxFileSize);
+                delete pindexdb;
+                pindexdb = new CIndexDB(nIndexDBCache, false, fReset, dbMaxFileSize);
 
 
                 delete passets;
@@ -1460,8 +1518,9 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                if (!passetsdb->ReadReissuedMempoolState())
-                    LogPrintf("Database failed to load last Reissued Mempool State. Will have to start from empty state");
+                // Reissues waiting in the mempool are no longer kept in the database, drop what older versions left there
+                if (!passetsdb->EraseReissuedMempoolState())
+                    LogPrintf("Database failed to erase the old Reissued Mempool State\n");
 
                 LogPrintf("Loaded Assets from database without error\nCache of assets size: %d\n", passetsCache->Size());
 
@@ -1474,6 +1533,34 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
 
                 if (fRequestShutdown) break;
 
+                if (fReindexIndex && !fReset) {
+                    // Recreate blocks/index from the block and undo files, leaving chainstate/ and assets/ alone
+                    uiInterface.InitMessage(_("Rebuilding block index..."));
+                    uint256 hashBestBlock;
+                    {
+                        CCoinsViewDB coinsdb(nMinDbCache << 20);
+                        hashBestBlock = coinsdb.GetBestBlock();
+                        if (hashBestBlock.IsNull() && !coinsdb.GetHeadBlocks().empty())
+                            hashBestBlock = coinsdb.GetHeadBlocks().front();
+                    }
+                    if (!RebuildBlockIndexFromDisk(chainparams, hashBestBlock)) {
+                        strLoadError = _("Error rebuilding block index from block files");
+                        break;
+                    }
+                    fReindexIndex = false;
+                }
+
+                // Older versions kept the address, spent and timestamp indexes in blocks/index
+                if (!pindexdb->MigrateFromBlockTree(*pblocktree)) {
+                    strLoadError = _("Error moving the address, spent and timestamp indexes to their own database");
+                    break;
+                }
+
+                if (!pindexdb->UpgradeAddressIndex()) {
+                    strLoadError = _("Error upgrading address index database");
+                    break;
+                }
+
                 // LoadBlockIndex will load fTxIndex from the db, or set it if
                 // we're reindexing. It will also load fHavePruned if we've
                 // ever removed a block file from disk.
@@ -1501,24 +1588,86 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
                     break;
                 }
 
-                // Check for changed -addressindex state
-                if (fAddressIndex != gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -addressindex");
+                // Older versions only recorded the asset index in the block tree
+                bool fAssetIndexRecorded;
+                if (!passetsdb->ReadFlag("assetindex", fAssetIndexRecorded))
+                    passetsdb->WriteFlag("assetindex", fAssetIndex);
+
+                // The address, spent, timestamp and block filter indexes can be turned on for an existing database,
+                // the index writer then builds them from the block and undo files in the background
+                bool fEnableAddressIndex = !fAddressIndex && gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
+                bool fEnableSpentIndex = !fSpentIndex && gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
+                bool fEnableTimestampIndex = !fTimestampIndex && gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
+                bool fEnableBlockFilterIndex = !fBlockFilterIndex && gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+
+                // Check for disabled -addressindex state
+                if (fAddressIndex && !gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to disable -addressindex");
                     break;
                 }
 
-                // Check for changed -spentindex state
-                if (fSpentIndex != gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -spentindex");
+                // Check for disabled -spentindex state
+                if (fSpentIndex && !gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to disable -spentindex");
                     break;
                 }
 
-                // Check for changed -timestampindex state
-                if (fTimestampIndex != gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
-                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to change -timestampindex");
+                // Check for disabled -timestampindex state
+                if (fTimestampIndex && !gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to disable -timestampindex");
                     break;
                 }
 
+                // Check for disabled -blockfilterindex state
+                if (fBlockFilterIndex && !gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX)) {
+                    strLoadError = _("You need to rebuild the database using -reindex-chainstate to disable -blockfilterindex");
+                    break;
+                }
+
+                if (fEnableAddressIndex || fEnableSpentIndex || fEnableTimestampIndex || fEnableBlockFilterIndex) {
+                    if (fHavePruned) {
+                        strLoadError = _("You need to rebuild the database using -reindex to enable the address, spent, timestamp or block filter index after blocks were pruned");
+                        break;
+                    }
+                    // All indexes share one best block, so the ones already built are built again with the new ones
+                    std::string strRebuilt;
+                    for (const auto& index : {std::make_pair(fAddressIndex, "address"), std::make_pair(fSpentIndex, "spent"),
+                                              std::make_pair(fTimestampIndex, "timestamp"), std::make_pair(fBlockFilterIndex, "block filter")}) {
+                        if (index.first)
+                            strRebuilt += std::string(strRebuilt.empty() ? "" : ", ") + index.second;
+                    }
+                    if (!strRebuilt.empty())
+                        LogPrintf("%s: enabling an index rebuilds the already built indexes from the genesis block too (%s)\n", __func__, strRebuilt);
+                    // Reset the index best block before recording the new flags, so the build restarts if interrupted
+                    if (!pindexdb->WriteIndexBestBlock(uint256())) {
+                        strLoadError = _("Error resetting the index database");
+                        break;
+                    }
+                    if (fEnableAddressIndex) {
+                        fAddressIndex = true;
+                        pblocktree->WriteFlag("addressindex", true);
+                        pindexdb->WriteFlag("addressindex", true);
+                    }
+                    if (fEnableSpentIndex) {
+                        fSpentIndex = true;
+                        pblocktree->WriteFlag("spentindex", true);
+                        pindexdb->WriteFlag("spentindex", true);
+                    }
+                    if (fEnableTimestampIndex) {
+                        fTimestampIndex = true;
+                        pblocktree->WriteFlag("timestampindex", true);
+                        pindexdb->WriteFlag("timestampindex", true);
+                    }
+                    if (fEnableBlockFilterIndex) {
+                        fBlockFilterIndex = true;
+                        pblocktree->WriteFlag("blockfilterindex", true);
+                        pindexdb->WriteFlag("blockfilterindex", true);
+                    }
+                    LogPrintf("%s: indexes will be built in the background (address index %s, spent index %s, timestamp index %s, block filter index %s)\n", __func__,
+                        fAddressIndex ? "enabled" : "disabled", fSpentIndex ? "enabled" : "disabled", fTimestampIndex ? "enabled" : "disabled",
+                        fBlockFilterIndex ? "enabled" : "disabled");
+                }
+
                 // Check for changed -prune state.  What we are concerned about is a user who has pruned blocks
                 // in the past, but is now trying to run unpruned.
                 if (fHavePruned && !fPruneMode) {
@@ -1651,6 +1800,14 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         ::feeEstimator.Read(est_filein);
     fFeeEstimatesInitialized = true;
 
+    if (fAddressIndex || fSpentIndex || fTimestampIndex || fBlockFilterIndex) {
+        int nIndexBuildThreads = gArgs.GetArg("-indexbuildthreads", DEFAULT_INDEX_BUILD_THREADS);
+        nIndexBuildThreads = std::max(1, std::min(MAX_INDEX_BUILD_THREADS, nIndexBuildThreads));
+        g_indexwriter = std::unique_ptr<CIndexWriter>(new CIndexWriter(nIndexBuildThreads));
+        if (!g_indexwriter->Start())
+            return InitError(_("Unable to start the address, spent and timestamp index writer"));
+    }
+
     // ********************************************************* Step 8: load wallet
 #ifdef ENABLE_WALLET
     if (!OpenWallets())
@@ -1783,6 +1940,10 @@ bool AppInitMain(boost::thread_group& threadGroup, CScheduler& scheduler)
         return false;
     }
 
+    if (!StartStratumServer()) {
+        return false;
+    }
+
     // ********************************************************* Step 12: finished
 
     SetRPCWarmupFinished();
@@ -34,6 +34,8 @@
 
 #include <boost/thread.hpp>
 #include <algorithm>
+#include <atomic>
+#include <deque>
 #include <queue>
 #include <utility>
 
@@ -52,9 +54,6 @@ extern std::vector<CWalletRef> vpwallets;
 
 uint64_t nLastBlockTx = 0;
 uint64_t nLastBlockWeight = 0;
-uint64_t nMiningTimeStart = 0;
-uint64_t nHashesPerSec = 0;
-uint64_t nHashesDone = 0;
 
 
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev)
@@ -116,9 +115,24 @@ void BlockAssembler::resetBlock()
     // These counters do not include coinbase tx
     nBlockTx = 0;
     nFees = 0;
+
+    lastPackageFeeRate = CFeeRate();
+    fPackageSkipped = false;
+    keptMinFeeRate = CFeeRate();
+    skippedMaxFeeRate = CFeeRate();
 }
 
 std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTx)
+{
+    return CreateNewBlockInternal(scriptPubKeyIn, fMineWitnessTx, nullptr);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::UpdateNewBlock(const CBlockTemplate& prevTemplate, const CScript& scriptPubKeyIn, bool fMineWitnessTx)
+{
+    return CreateNewBlockInternal(scriptPubKeyIn, fMineWitnessTx, &prevTemplate);
+}
+
+std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlockInternal(const CScript& scriptPubKeyIn, bool fMineWitnessTx, const CBlockTemplate* pprevTemplate)
 {
     int64_t nTimeStart = GetTimeMicros();
 
@@ -161,10 +175,34 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     // transaction (which in most cases can be a no-op).
     fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus()) && fMineWitnessTx;
 
+    // Keep the transactions of a previous template on the same tip, so that
+    // package selection only has to fill the remaining space
+    int nTxKept = 0;
+    if (pprevTemplate && pprevTemplate->block.hashPrevBlock == pindexPrev->GetBlockHash())
+        nTxKept = addTemplateTxs(*pprevTemplate);
+
     int nPackagesSelected = 0;
     int nDescendantsUpdated = 0;
     addPackageTxs(nPackagesSelected, nDescendantsUpdated);
 
+    // A package that was left out for lack of room but outbids a kept transaction
+    // could only get in by displacing it, so select from scratch instead
+    if (nTxKept > 0 && skippedMaxFeeRate > keptMinFeeRate) {
+        resetBlock();
+        fIncludeWitness = IsWitnessEnabled(pindexPrev, chainparams.GetConsensus()) && fMineWitnessTx;
+        pblock->vtx.resize(1);
+        pblocktemplate->vTxFees.resize(1);
+        pblocktemplate->vTxSigOpsCost.resize(1);
+        nTxKept = 0;
+        nPackagesSelected = 0;
+        nDescendantsUpdated = 0;
+        addPackageTxs(nPackagesSelected, nDescendantsUpdated);
+    }
+
+    // Once packages had to be left out for lack of room, a new one only improves the
+    // template if it outbids the last package that was selected
+    pblocktemplate->minFeeRate = fPackageSkipped ? std::max(lastPackageFeeRate, blockMinFeeRate) : blockMinFeeRate;
+
     int64_t nTime1 = GetTimeMicros();
 
     nLastBlockTx = nBlockTx;
@@ -197,7 +235,7 @@ std::unique_ptr<CBlockTemplate> BlockAssembler::CreateNewBlock(const CScript& sc
     }
     int64_t nTime2 = GetTimeMicros();
 
-    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
+    LogPrint(BCLog::BENCH, "CreateNewBlock() packages: %.2fms (%d txs kept, %d packages, %d updated descendants), validity: %.2fms (total %.2fms)\n", 0.001 * (nTime1 - nTimeStart), nTxKept, nPackagesSelected, nDescendantsUpdated, 0.001 * (nTime2 - nTime1), 0.001 * (nTime2 - nTimeStart));
 
     return std::move(pblocktemplate);
 }
@@ -312,6 +350,39 @@ void BlockAssembler::SortForBlock(const CTxMemPool::setEntries& package, CTxMemP
     std::sort(sortedEntries.begin(), sortedEntries.end(), CompareTxIterByAncestorCount());
 }
 
+// Re-add the transactions of a previous template that are still in the mempool,
+// in their original order. Removing a transaction from the mempool also removes
+// its descendants, so this is the previous template minus whole packages; a
+// transaction is nevertheless only kept if its in-mempool parents are kept.
+int BlockAssembler::addTemplateTxs(const CBlockTemplate& prevTemplate)
+{
+    int nTxKept = 0;
+    for (size_t i = 1; i < prevTemplate.block.vtx.size(); i++) {
+        CTxMemPool::txiter it = mempool.mapTx.find(prevTemplate.block.vtx[i]->GetHash());
+        if (it == mempool.mapTx.end())
+            continue;
+
+        bool fParentsKept = true;
+        for (CTxMemPool::txiter parent : mempool.GetMemPoolParents(it)) {
+            if (!inBlock.count(parent)) {
+                fParentsKept = false;
+                break;
+            }
+        }
+        if (!fParentsKept || !TestPackageTransactions({it}))
+            continue;
+        if (!TestPackage(it->GetTxSize(), it->GetSigOpCost()))
+            continue;
+
+        AddToBlock(it);
+        ++nTxKept;
+        CFeeRate feeRate(it->GetModFeesWithAncestors(), it->GetSizeWithAncestors());
+        if (nTxKept == 1 || feeRate < keptMinFeeRate)
+            keptMinFeeRate = feeRate;
+    }
+    return nTxKept;
+}
+
 // This transaction selection algorithm orders the mempool based
 // on feerate of a transaction including all unconfirmed ancestors.
 // Since we don't remove transactions from the mempool as we select them
@@ -397,6 +468,8 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         }
 
         if (!TestPackage(packageSize, packageSigOpsCost)) {
+            fPackageSkipped = true;
+            skippedMaxFeeRate = std::max(skippedMaxFeeRate, CFeeRate(packageFees, packageSize));
             if (fUsingModified) {
                 // Since we always look at the best entry in mapModifiedTx,
                 // we must erase failed entries so that we can consider the
@@ -446,6 +519,7 @@ void BlockAssembler::addPackageTxs(int &nPackagesSelected, int &nDescendantsUpda
         }
 
         ++nPackagesSelected;
+        lastPackageFeeRate = CFeeRate(packageFees, packageSize);
 
         // Update transactions that depend on each of these
         nDescendantsUpdated += UpdatePackagesForAdded(ancestors, mapModifiedTx);
@@ -507,13 +581,123 @@ CWallet *GetFirstWallet() {
     return(vpwallets[0]);
 }
 
-void static RavenMiner(const CChainParams& chainparams)
+/** The block template shared by all internal miner threads. It is rebuilt by
+ * whichever thread first notices that it is stale, and every rebuild gets a new
+ * nWorkId so that the other threads drop their search and pick it up. */
+struct CMinerWork
+{
+    std::shared_ptr<const CBlockTemplate> pblocktemplate;
+    std::shared_ptr<CReserveScript> coinbaseScript;
+    const CBlockIndex* pindexPrev;
+    unsigned int nTransactionsUpdatedLast;
+    int64_t nStart;
+};
+
+static CCriticalSection cs_minerWork;
+static CMinerWork minerWork;
+static std::atomic<uint64_t> nMinerWorkId(0);
+
+/** Hash counts of the internal miner, per thread and per X16R algorithm order */
+static CCriticalSection cs_minerStats;
+static int64_t nMiningTimeStart = 0;
+static std::vector<uint64_t> vThreadHashesDone;
+static std::map<std::string, std::pair<uint64_t, int64_t>> mapOrderHashesDone; // order -> (hashes, microseconds)
+static std::deque<std::string> vOrderHistory;
+/** Number of recent algorithm orders getmininginfo reports */
+static const size_t MAX_MINER_ORDER_STATS = 16;
+/** Nonces hashed between checks for new work */
+static const uint32_t MINER_NONCE_BATCH = 256;
+
+/** The X16R algorithm order selected by a previous block hash, one hex digit per round */
+static std::string GetX16ROrder(const uint256& hashPrevBlock)
+{
+    std::string strOrder;
+    for (int i = 0; i < 16; i++)
+        strOrder += "0123456789abcdef"[GetHashSelection(hashPrevBlock, i)];
+    return strOrder;
+}
+
+static void AddMinerHashes(int nThread, const std::string& strOrder, uint64_t nHashes, int64_t nMicros)
+{
+    LOCK(cs_minerStats);
+    if (nThread < (int)vThreadHashesDone.size())
+        vThreadHashesDone[nThread] += nHashes;
+    auto it = mapOrderHashesDone.find(strOrder);
+    if (it == mapOrderHashesDone.end()) {
+        it = mapOrderHashesDone.emplace(strOrder, std::make_pair(0, 0)).first;
+        vOrderHistory.push_back(strOrder);
+        if (vOrderHistory.size() > MAX_MINER_ORDER_STATS) {
+            mapOrderHashesDone.erase(vOrderHistory.front());
+            vOrderHistory.pop_front();
+        }
+    }
+    it->second.first += nHashes;
+    it->second.second += nMicros;
+}
+
+void GetMinerStats(CMinerStats& stats)
+{
+    LOCK(cs_minerStats);
+    int64_t nSeconds = std::max<int64_t>(1, (GetTimeMicros() - nMiningTimeStart) / 1000000);
+    stats.nHashesPerSec = 0;
+    stats.vThreadHashesPerSec.clear();
+    for (uint64_t nHashes : vThreadHashesDone) {
+        stats.vThreadHashesPerSec.push_back(nHashes / nSeconds);
+        stats.nHashesPerSec += nHashes / nSeconds;
+    }
+    stats.vOrderHashesPerSec.clear();
+    for (const std::string& strOrder : vOrderHistory) {
+        const std::pair<uint64_t, int64_t>& done = mapOrderHashesDone.at(strOrder);
+        stats.vOrderHashesPerSec.emplace_back(strOrder, done.second > 0 ? done.first * 1000000 / done.second : 0);
+    }
+}
+
+/** Get the shared template, rebuilding it first if the tip has changed or the mempool changed a while ago */
+static bool GetMinerWork(CWallet* pWallet, std::shared_ptr<const CBlockTemplate>& pblocktemplate, const CBlockIndex*& pindexPrev,
+                         std::shared_ptr<CReserveScript>& coinbaseScript, uint64_t& nWorkId)
+{
+    LOCK(cs_minerWork);
+    const CBlockIndex* pindexTip = chainActive.Tip();
+    if (!pindexTip)
+        return false;
+    if (!minerWork.pblocktemplate || minerWork.pindexPrev != pindexTip ||
+        (mempool.GetTransactionsUpdated() != minerWork.nTransactionsUpdatedLast && GetTime() - minerWork.nStart > 60)) {
+        if (!minerWork.coinbaseScript)
+            pWallet->GetScriptForMining(minerWork.coinbaseScript);
+        // Throw an error if no script was provided.  This can happen
+        // due to some internal error but also if the keypool is empty.
+        // In the latter case, already the pointer is NULL.
+        if (!minerWork.coinbaseScript || minerWork.coinbaseScript->reserveScript.empty())
+            throw std::runtime_error("No coinbase script available (mining requires a wallet)");
+
+        minerWork.nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
+        minerWork.pindexPrev = pindexTip;
+        minerWork.nStart = GetTime();
+        minerWork.pblocktemplate = BlockAssembler(Params()).CreateNewBlock(minerWork.coinbaseScript->reserveScript);
+        if (!minerWork.pblocktemplate) {
+            LogPrintf("RavenMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
+            return false;
+        }
+        ++nMinerWorkId;
+        LogPrintf("RavenMiner -- Running miner with %u transactions in block (%u bytes)\n", minerWork.pblocktemplate->block.vtx.size(),
+            ::GetSerializeSize(minerWork.pblocktemplate->block, SER_NETWORK, PROTOCOL_VERSION));
+    }
+    pblocktemplate = minerWork.pblocktemplate;
+    pindexPrev = minerWork.pindexPrev;
+    coinbaseScript = minerWork.coinbaseScript;
+    nWorkId = nMinerWorkId;
+    return true;
+}
+
+void static RavenMiner(const CChainParams& chainparams, int nThread, int nThreads)
 {
     LogPrintf("RavenMiner -- started\n");
     SetThreadPriority(THREAD_PRIORITY_LOWEST);
     RenameThread("raven-miner");
 
-    unsigned int nExtraNonce = 0;
+    // Threads roll disjoint extranonces (nThread, nThread + nThreads, ...), so
+    // their coinbases, and with them the nonce ranges they search, never overlap
+    unsigned int nExtraNonceRound = 0;
 
 
     CWallet * pWallet = NULL;
@@ -532,29 +716,7 @@ void static RavenMiner(const CChainParams& chainparams)
         return;
     }
 
-
-    std::shared_ptr<CReserveScript> coinbaseScript;
-
-    pWallet->GetScriptForMining(coinbaseScript);
-
-    //GetMainSignals().ScriptForMining(coinbaseScript);
-
-    if (!coinbaseScript)
-        LogPrintf("coinbaseScript is NULL\n");
-
-    if (coinbaseScript->reserveScript.empty())
-        LogPrintf("coinbaseScript is empty\n");
-
     try {
-        // Throw an error if no script was provided.  This can happen
-        // due to some internal error but also if the keypool is empty.
-        // In the latter case, already the pointer is NULL.
-        if (!coinbaseScript || coinbaseScript->reserveScript.empty())
-        {
-            throw std::runtime_error("No coinbase script available (mining requires a wallet)");
-        }
-
-
         while (true) {
 
             if (chainparams.MiningRequiresPeers()) {
@@ -571,62 +733,71 @@ void static RavenMiner(const CChainParams& chainparams)
 
 
             //
-            // Create new block
+            // Get the shared block and make it ours with a thread specific extranonce
             //
-            unsigned int nTransactionsUpdatedLast = mempool.GetTransactionsUpdated();
-            CBlockIndex* pindexPrev = chainActive.Tip();
-            if(!pindexPrev) break;
-
-
-
-            std::unique_ptr<CBlockTemplate> pblocktemplate(BlockAssembler(Params()).CreateNewBlock(coinbaseScript->reserveScript));
-
-            if (!pblocktemplate.get())
-            {
-                LogPrintf("RavenMiner -- Keypool ran out, please call keypoolrefill before restarting the mining thread\n");
+            std::shared_ptr<const CBlockTemplate> pblocktemplate;
+            const CBlockIndex* pindexPrev;
+            std::shared_ptr<CReserveScript> coinbaseScript;
+            uint64_t nWorkId;
+            if (!GetMinerWork(pWallet, pblocktemplate, pindexPrev, coinbaseScript, nWorkId))
                 return;
-            }
-            CBlock *pblock = &pblocktemplate->block;
-            IncrementExtraNonce(pblock, pindexPrev, nExtraNonce);
 
-            LogPrintf("RavenMiner -- Running miner with %u transactions in block (%u bytes)\n", pblock->vtx.size(),
-                ::GetSerializeSize(*pblock, SER_NETWORK, PROTOCOL_VERSION));
+            CBlock block(pblocktemplate->block);
+            CBlock *pblock = &block;
+            unsigned int nExtraNonce = ++nExtraNonceRound * nThreads + nThread;
+            CMutableTransaction txCoinbase(*pblock->vtx[0]);
+            txCoinbase.vin[0].scriptSig = (CScript() << (pindexPrev->nHeight + 1) << CScriptNum(nExtraNonce)) + COINBASE_FLAGS;
+            assert(txCoinbase.vin[0].scriptSig.size() <= 100);
+            pblock->vtx[0] = MakeTransactionRef(std::move(txCoinbase));
+            pblock->hashMerkleRoot = BlockMerkleRoot(*pblock);
 
             //
             // Search
             //
-            int64_t nStart = GetTime();
             arith_uint256 hashTarget = arith_uint256().SetCompact(pblock->nBits);
+            const std::string strOrder = GetX16ROrder(pblock->hashPrevBlock);
+            // Only the nonce and the time change below, so the start of the header is hashed once
+            CX16RMidstate midstate = pblock->GetX16RMidstate();
             while (true)
             {
-
+                // Hash a batch of nonces between checks for new work
+                bool fFound = false;
+                int64_t nBatchStart = GetTimeMicros();
+                uint32_t nHashes = 0;
                 uint256 hash;
-                while (true)
+                while (nHashes < MINER_NONCE_BATCH)
                 {
-                    hash = pblock->GetHash();
-                    if (UintToArith256(hash) <= hashTarget)
+                    hash = pblock->GetHash(midstate);
+                    ++nHashes;
+                    if (UintToArith256(hash) <= hashTarget) {
+                        fFound = true;
+                        break;
+                    }
+                    pblock->nNonce += 1;
+                }
+                AddMinerHashes(nThread, strOrder, nHashes, GetTimeMicros() - nBatchStart);
+
+                if (fFound)
+                {
+                    // Found a solution
+                    SetThreadPriority(THREAD_PRIORITY_NORMAL);
+                    LogPrintf("RavenMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
+                    ProcessBlockFound(pblock, chainparams);
+                    SetThreadPriority(THREAD_PRIORITY_LOWEST);
                     {
-                        // Found a solution
-                        SetThreadPriority(THREAD_PRIORITY_NORMAL);
-                        LogPrintf("RavenMiner:\n  proof-of-work found\n  hash: %s\n  target: %s\n", hash.GetHex(), hashTarget.GetHex());
-                        ProcessBlockFound(pblock, chainparams);
-                        SetThreadPriority(THREAD_PRIORITY_LOWEST);
+                        // The next template needs a fresh key
+                        LOCK(cs_minerWork);
                         coinbaseScript->KeepScript();
+                        if (minerWork.coinbaseScript == coinbaseScript)
+                            minerWork.coinbaseScript.reset();
+                    }
 
-                        // In regression test mode, stop mining after a block is found. This
-                        // allows developers to controllably generate a block on demand.
-                        if (chainparams.MineBlocksOnDemand())
-                            throw boost::thread_interrupted();
+                    // In regression test mode, stop mining after a block is found. This
+                    // allows developers to controllably generate a block on demand.
+                    if (chainparams.MineBlocksOnDemand())
+                        throw boost::thread_interrupted();
 
-                        break;
-                    }
-                    pblock->nNonce += 1;
-                    nHashesDone += 1;
-                    if (nHashesDone % 500000 == 0) {   //Calculate hashing speed
-                        nHashesPerSec = nHashesDone / (((GetTimeMicros() - nMiningTimeStart) / 1000000) + 1);
-                    } 
-                    if ((pblock->nNonce & 0xFF) == 0)
-                        break;
+                    break;
                 }
 
                 // Check for stop or if block needs to be rebuilt
@@ -636,10 +807,15 @@ void static RavenMiner(const CChainParams& chainparams)
                 //    break;
                 if (pblock->nNonce >= 0xffff0000)
                     break;
-                if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 60)
+                if (nMinerWorkId != nWorkId)
                     break;
                 if (pindexPrev != chainActive.Tip())
                     break;
+                {
+                    LOCK(cs_minerWork);
+                    if (mempool.GetTransactionsUpdated() != minerWork.nTransactionsUpdatedLast && GetTime() - minerWork.nStart > 60)
+                        break;
+                }
 
                 // Update nTime every few seconds
                 if (UpdateTime(pblock, chainparams.GetConsensus(), pindexPrev) < 0)
@@ -677,9 +853,14 @@ int GenerateRavens(bool fGenerate, int nThreads, const CChainParams& chainparams
     if (minerThreads != NULL)
     {
         minerThreads->interrupt_all();
+        minerThreads->join_all();
         delete minerThreads;
         minerThreads = NULL;
     }
+    {
+        LOCK(cs_minerWork);
+        minerWork = CMinerWork();
+    }
 
     if (nThreads == 0 || !fGenerate)
         return numCores;
@@ -687,12 +868,16 @@ int GenerateRavens(bool fGenerate, int nThreads, const CChainParams& chainparams
     minerThreads = new boost::thread_group();
     
     //Reset metrics
-    nMiningTimeStart = GetTimeMicros();
-    nHashesDone = 0;
-    nHashesPerSec = 0;
+    {
+        LOCK(cs_minerStats);
+        nMiningTimeStart = GetTimeMicros();
+        vThreadHashesDone.assign(nThreads, 0);
+        mapOrderHashesDone.clear();
+        vOrderHistory.clear();
+    }
 
     for (int i = 0; i < nThreads; i++){
-        minerThreads->create_thread(boost::bind(&RavenMiner, boost::cref(chainparams)));
+        minerThreads->create_thread(boost::bind(&RavenMiner, boost::cref(chainparams), i, nThreads));
     }
 
     return(numCores);
@@ -22,6 +22,10 @@ class CScript;
 namespace Consensus { struct Params; };
 
 static const bool DEFAULT_PRINTPRIORITY = false;
+/** Seconds after which getblocktemplate assembles its template from scratch, rather than updating it for mempool changes */
+static const int64_t BLOCK_TEMPLATE_REBUILD_INTERVAL = 60;
+/** Default for -longpollfeethreshold, the percentage of fees new transactions must add to a template to end long-polls */
+static const int64_t DEFAULT_LONGPOLL_FEE_THRESHOLD = 1;
 
 struct CBlockTemplate
 {
@@ -29,6 +33,8 @@ struct CBlockTemplate
     std::vector<CAmount> vTxFees;
     std::vector<int64_t> vTxSigOpsCost;
     std::vector<unsigned char> vchCoinbaseCommitment;
+    /** Lowest ancestor fee rate at which a new package would still improve this template */
+    CFeeRate minFeeRate;
 };
 
 // Container for tracking updates to ancestor feerate as we include (parent)
@@ -149,6 +155,13 @@ private:
     uint64_t nBlockSigOpsCost;
     CAmount nFees;
     CTxMemPool::setEntries inBlock;
+    // Fee rate of the last package selected, and whether any package was left out for lack of room
+    CFeeRate lastPackageFeeRate;
+    bool fPackageSkipped;
+    // Lowest ancestor fee rate of the transactions kept from a previous template, and highest
+    // fee rate of a package left out for lack of room
+    CFeeRate keptMinFeeRate;
+    CFeeRate skippedMaxFeeRate;
 
     // Chain context for the block
     int nHeight;
@@ -167,8 +180,15 @@ public:
 
     /** Construct a new block template with coinbase to scriptPubKeyIn */
     std::unique_ptr<CBlockTemplate> CreateNewBlock(const CScript& scriptPubKeyIn, bool fMineWitnessTx=true);
+    /** Construct a new block template from a previous one on the same tip: the previous template's
+      * transactions that are still in the mempool are kept, and new packages fill the remaining space.
+      * Falls back to CreateNewBlock() if the tip has changed, or if a package that did not fit pays a
+      * higher fee rate than a kept transaction. */
+    std::unique_ptr<CBlockTemplate> UpdateNewBlock(const CBlockTemplate& prevTemplate, const CScript& scriptPubKeyIn, bool fMineWitnessTx=true);
 
 private:
+    std::unique_ptr<CBlockTemplate> CreateNewBlockInternal(const CScript& scriptPubKeyIn, bool fMineWitnessTx, const CBlockTemplate* pprevTemplate);
+
     // utility functions
     /** Clear the block's state and prepare for assembling a new block */
     void resetBlock();
@@ -176,6 +196,9 @@ private:
     void AddToBlock(CTxMemPool::txiter iter);
 
     // Methods for how to add transactions to a block.
+    /** Add the transactions of a previous template that are still in the mempool.
+      * Returns the number of transactions added. */
+    int addTemplateTxs(const CBlockTemplate& prevTemplate);
     /** Add transactions based on feerate including unconfirmed ancestors
       * Increments nPackagesSelected / nDescendantsUpdated with corresponding
       * statistics from the package selection (for logging statistics). */
@@ -207,4 +230,14 @@ void IncrementExtraNonce(CBlock* pblock, const CBlockIndex* pindexPrev, unsigned
 int64_t UpdateTime(CBlockHeader* pblock, const Consensus::Params& consensusParams, const CBlockIndex* pindexPrev);
 
 int GenerateRavens(bool fGenerate, int nThreads, const CChainParams& chainparams);
+
+/** Hash rates of the internal miner since it was last started */
+struct CMinerStats
+{
+    uint64_t nHashesPerSec;
+    std::vector<uint64_t> vThreadHashesPerSec;
+    /** Hashes per second while mining on each recent X16R algorithm order, oldest first */
+    std::vector<std::pair<std::string, uint64_t>> vOrderHashesPerSec;
+};
+void GetMinerStats(CMinerStats& stats);
 #endif // RAVEN_MINER_H
@@ -16,6 +16,17 @@ uint256 CBlockHeader::GetHash() const
     return HashX16R(BEGIN(nVersion), END(nNonce), hashPrevBlock);
 }
 
+CX16RMidstate CBlockHeader::GetX16RMidstate() const
+{
+    return CX16RMidstate((const unsigned char*)BEGIN(nVersion), hashPrevBlock);
+}
+
+uint256 CBlockHeader::GetHash(const CX16RMidstate& midstate) const
+{
+    static_assert(CX16RMidstate::MIDSTATE_BYTES + CX16RMidstate::TAIL_BYTES == 80, "X16R midstate must cover the 80 byte header");
+    return midstate.Finalize((const unsigned char*)END(nNonce) - CX16RMidstate::TAIL_BYTES);
+}
+
 std::string CBlock::ToString() const
 {
     std::stringstream s;
@@ -11,6 +11,8 @@
 #include "serialize.h"
 #include "uint256.h"
 
+class CX16RMidstate;
+
 /** Nodes collect new transactions into a block, hash them into a hash tree,
  * and scan through nonce values to make the block's hash satisfy proof-of-work
  * requirements.  When they solve the proof-of-work, they broadcast the block
@@ -63,6 +65,11 @@ public:
 
     uint256 GetHash() const;
 
+    /** The X16R midstate of this header, shared by all headers that differ from it only in the last 16 bytes */
+    CX16RMidstate GetX16RMidstate() const;
+    /** GetHash() from the midstate of a header that differs from this one only in the last 16 bytes */
+    uint256 GetHash(const CX16RMidstate& midstate) const;
+
     int64_t GetBlockTime() const
     {
         return (int64_t)nTime;
@@ -8,11 +8,13 @@
 
 #include "amount.h"
 #include "base58.h"
+#include "blockconnectstats.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
 #include "coins.h"
 #include "consensus/validation.h"
+#include "indexwriter.h"
 #include "validation.h"
 #include "core_io.h"
 #include "policy/feerate.h"
@@ -721,6 +723,8 @@ UniValue getblockdeltas(const JSONRPCRequest& request)
     if (request.fHelp || request.params.size() != 1)
         throw std::runtime_error("");
 
+    EnsureIndexesSynced();
+
     std::string strHash = request.params[0].get_str();
     uint256 hash(uint256S(strHash));
 
@@ -752,6 +756,9 @@ UniValue getblockhashes(const JSONRPCRequest& request)
             "    {\n"
             "      \"noOrphans\":true   (boolean) will only include blocks on the main chain\n"
             "      \"logicalTimes\":true   (boolean) will include logical timestamps with hashes\n"
+            "      \"offset\":n   (numeric) skip the first n blocks of the range\n"
+            "      \"limit\":n   (numeric) return at most n blocks\n"
+            "      \"summary\":\"hour\"|\"day\"   (string) only count the blocks of every hour or day of the range\n"
             "    }\n"
             "\nResult:\n"
             "[\n"
@@ -763,6 +770,13 @@ UniValue getblockhashes(const JSONRPCRequest& request)
             "    \"logicalts\": (numeric) The logical timestamp\n"
             "  }\n"
             "]\n"
+            "\nResult (with summary):\n"
+            "[\n"
+            "  {\n"
+            "    \"time\": (numeric) The logical timestamp the hour or day starts at\n"
+            "    \"blocks\": (numeric) The number of blocks in the hour or day\n"
+            "  }\n"
+            "]\n"
             "\nExamples:\n"
             + HelpExampleCli("getblockhashes", "1231614698 1231024505")
             + HelpExampleRpc("getblockhashes", "1231614698, 1231024505")
@@ -773,26 +787,69 @@ UniValue getblockhashes(const JSONRPCRequest& request)
     unsigned int low = request.params[1].get_int();
     bool fActiveOnly = false;
     bool fLogicalTS = false;
+    int nOffset = 0;
+    int nLimit = 0;
+    unsigned int nBucketSize = 0;
 
     if (request.params.size() > 2) {
         if (request.params[2].isObject()) {
             UniValue noOrphans = find_value(request.params[2].get_obj(), "noOrphans");
             UniValue returnLogical = find_value(request.params[2].get_obj(), "logicalTimes");
+            UniValue offsetValue = find_value(request.params[2].get_obj(), "offset");
+            UniValue limitValue = find_value(request.params[2].get_obj(), "limit");
+            UniValue summaryValue = find_value(request.params[2].get_obj(), "summary");
 
             if (noOrphans.isBool())
                 fActiveOnly = noOrphans.get_bool();
 
             if (returnLogical.isBool())
                 fLogicalTS = returnLogical.get_bool();
+
+            if (offsetValue.isNum()) {
+                nOffset = offsetValue.get_int();
+                if (nOffset < 0)
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Offset is expected to be zero or greater");
+            }
+
+            if (limitValue.isNum()) {
+                nLimit = limitValue.get_int();
+                if (nLimit <= 0)
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+            }
+
+            if (summaryValue.isStr()) {
+                if (summaryValue.get_str() == "hour")
+                    nBucketSize = 60 * 60;
+                else if (summaryValue.get_str() == "day")
+                    nBucketSize = 24 * 60 * 60;
+                else
+                    throw JSONRPCError(RPC_INVALID_PARAMETER, "Summary is expected to be hour or day");
+            }
         }
     }
 
-    std::vector<std::pair<uint256, unsigned int> > blockHashes;
+    EnsureIndexesSynced();
 
-    if (fActiveOnly)
-        LOCK(cs_main);
+    // Counted from the index alone, without listing the blocks
+    if (nBucketSize > 0) {
+        std::vector<std::pair<unsigned int, unsigned int> > buckets;
+        if (!GetTimestampIndexSummary(high, low, fActiveOnly, nBucketSize, buckets)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
+        }
 
-    if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes)) {
+        UniValue result(UniValue::VARR);
+        for (const auto& bucket : buckets) {
+            UniValue item(UniValue::VOBJ);
+            item.push_back(Pair("time", (int64_t)bucket.first));
+            item.push_back(Pair("blocks", (int)bucket.second));
+            result.push_back(item);
+        }
+        return result;
+    }
+
+    std::vector<std::pair<uint256, unsigned int> > blockHashes;
+
+    if (!GetTimestampIndex(high, low, fActiveOnly, blockHashes, nOffset, nLimit)) {
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for block hashes");
     }
 
@@ -1781,6 +1838,119 @@ UniValue getchaintxstats(const JSONRPCRequest& request)
     return ret;
 }
 
+UniValue getblockconnectstats(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getblockconnectstats\n"
+            "\nReturns the time spent in each stage of connecting the last blocks to the tip (see -connectstatsblocks).\n"
+            "Times are in milliseconds. Stages that do not apply to a block (e.g. disabled indexes) count as 0 for it.\n"
+            "verify_scripts includes connect_txs, as scripts are checked on the -par threads while transactions are connected.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"blocks\": xxxxx,           (numeric) The number of connected blocks the statistics are computed over\n"
+            "  \"stages\": {\n"
+            "    \"stage\": {              (json object) One of load_block, prefetch_inputs, sanity_checks, fork_checks, connect_txs,\n"
+            "                              asset_checks, verify_scripts, undo_write, asset_undo_write, txindex_write,\n"
+            "                              flush_coins, flush_assets, write_chainstate, postprocess, total\n"
+            "      \"p50\": x.xxx,          (numeric) Median time\n"
+            "      \"p95\": x.xxx,          (numeric) 95th percentile\n"
+            "      \"p99\": x.xxx,          (numeric) 99th percentile\n"
+            "      \"max\": x.xxx,          (numeric) Maximum time\n"
+            "      \"mean\": x.xxx          (numeric) Average time\n"
+            "    }, ...\n"
+            "  }\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockconnectstats", "")
+            + HelpExampleRpc("getblockconnectstats", "")
+        );
+
+    std::vector<CBlockConnectStageSummary> vSummary;
+    size_t nBlocks = blockConnectStats.Summarize(vSummary);
+
+    UniValue stages(UniValue::VOBJ);
+    for (int stage = 0; stage < CONNECT_STAGE_COUNT; stage++) {
+        const CBlockConnectStageSummary& summary = vSummary[stage];
+        UniValue obj(UniValue::VOBJ);
+        obj.push_back(Pair("p50", summary.nP50 * 0.001));
+        obj.push_back(Pair("p95", summary.nP95 * 0.001));
+        obj.push_back(Pair("p99", summary.nP99 * 0.001));
+        obj.push_back(Pair("max", summary.nMax * 0.001));
+        obj.push_back(Pair("mean", summary.nMean * 0.001));
+        stages.push_back(Pair(BlockConnectStageName((BlockConnectStage)stage), obj));
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("blocks", (uint64_t)nBlocks));
+    ret.push_back(Pair("stages", stages));
+    return ret;
+}
+
+void EnsureIndexesSynced()
+{
+    if (!g_indexwriter)
+        return;
+    if (g_indexwriter->IsBuilding()) {
+        const CBlockIndex* pindexBest = g_indexwriter->GetBestBlock();
+        int nHeight;
+        {
+            LOCK(cs_main);
+            nHeight = chainActive.Height();
+        }
+        throw JSONRPCError(RPC_IN_WARMUP, strprintf("Indexes are being built (block %d of %d), see getindexinfo",
+            pindexBest ? pindexBest->nHeight : -1, nHeight));
+    }
+    g_indexwriter->BlockUntilSyncedToCurrentChain();
+}
+
+UniValue getindexinfo(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() != 0)
+        throw std::runtime_error(
+            "getindexinfo\n"
+            "\nReturns the state of the address, spent, timestamp and block filter indexes.\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"addressindex\": true|false,  (boolean) Whether the address index is enabled\n"
+            "  \"spentindex\": true|false,    (boolean) Whether the spent index is enabled\n"
+            "  \"timestampindex\": true|false, (boolean) Whether the timestamp index is enabled\n"
+            "  \"blockfilterindex\": true|false, (boolean) Whether the block filter index is enabled\n"
+            "  \"synced\": true|false,        (boolean) Whether the indexes are close enough to the tip to answer queries\n"
+            "  \"bestblockhash\": \"hash\",     (string) The last block included in the indexes\n"
+            "  \"height\": xxxxx,             (numeric) The height of that block, -1 before the genesis block is indexed\n"
+            "  \"blocks\": xxxxx,             (numeric) The height of the active chain\n"
+            "  \"progress\": xxx.xxx          (numeric) Percentage of the active chain included in the indexes\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getindexinfo", "")
+            + HelpExampleRpc("getindexinfo", "")
+        );
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("addressindex", fAddressIndex));
+    ret.push_back(Pair("spentindex", fSpentIndex));
+    ret.push_back(Pair("timestampindex", fTimestampIndex));
+    ret.push_back(Pair("blockfilterindex", fBlockFilterIndex));
+    if (!g_indexwriter)
+        return ret;
+
+    bool fBuilding = g_indexwriter->IsBuilding();
+    const CBlockIndex* pindexBest = g_indexwriter->GetBestBlock();
+    int nHeight;
+    {
+        LOCK(cs_main);
+        nHeight = chainActive.Height();
+    }
+    int nBestHeight = pindexBest ? pindexBest->nHeight : -1;
+    ret.push_back(Pair("synced", !fBuilding));
+    ret.push_back(Pair("bestblockhash", pindexBest ? pindexBest->GetBlockHash().GetHex() : ""));
+    ret.push_back(Pair("height", nBestHeight));
+    ret.push_back(Pair("blocks", nHeight));
+    ret.push_back(Pair("progress", nHeight > 0 ? std::min(100.0, 100.0 * std::max(nBestHeight, 0) / nHeight) : 100.0));
+    return ret;
+}
+
 UniValue savemempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() != 0) {
@@ -1800,6 +1970,53 @@ UniValue savemempool(const JSONRPCRequest& request)
     return NullUniValue;
 }
 
+UniValue getblockfilter(const JSONRPCRequest& request)
+{
+    if (request.fHelp || request.params.size() < 1 || request.params.size() > 2)
+        throw std::runtime_error(
+            "getblockfilter \"blockhash\" ( \"filtertype\" )\n"
+            "\nReturns the compact filter of a block's scripts (requires -blockfilterindex).\n"
+            "\nArguments:\n"
+            "1. \"blockhash\"    (string, required) The hash of the block\n"
+            "2. \"filtertype\"   (string, optional, default=basic) The type of filter, only basic is supported\n"
+            "\nResult:\n"
+            "{\n"
+            "  \"filter\": \"hex\",  (string) The hex-encoded Golomb-coded set of the scripts created and spent by the block\n"
+            "  \"header\": \"hex\"   (string) The hex-encoded filter header, committing to the filters of the block and its ancestors\n"
+            "}\n"
+            "\nExamples:\n"
+            + HelpExampleCli("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+            + HelpExampleRpc("getblockfilter", "\"00000000c937983704a73af28acdec37b049d214adbda81d7e2a3dd146f6ed09\"")
+        );
+
+    uint256 hash(ParseHashV(request.params[0], "blockhash"));
+    if (request.params.size() > 1 && request.params[1].get_str() != "basic") {
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Unknown filtertype");
+    }
+
+    if (!fBlockFilterIndex) {
+        throw JSONRPCError(RPC_MISC_ERROR, "Block filters are not enabled, restart with -blockfilterindex");
+    }
+
+    {
+        LOCK(cs_main);
+        if (mapBlockIndex.count(hash) == 0)
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Block not found");
+    }
+
+    EnsureIndexesSynced();
+
+    CBlockFilterIndexValue value;
+    if (!GetBlockFilter(hash, value)) {
+        throw JSONRPCError(RPC_MISC_ERROR, "No filter available for block, it is not in the active chain or its data is not available");
+    }
+
+    UniValue ret(UniValue::VOBJ);
+    ret.push_back(Pair("filter", HexStr(value.vFilter)));
+    ret.push_back(Pair("header", value.header.GetHex()));
+    return ret;
+}
+
 static const CRPCCommand commands[] =
 { //  category              name                      actor (function)         argNames
   //  --------------------- ------------------------  -----------------------  ----------
@@ -1807,12 +2024,15 @@ static const CRPCCommand commands[] =
     { "blockchain",         "getchaintxstats",        &getchaintxstats,        {"nblocks", "blockhash"} },
     { "blockchain",         "getbestblockhash",       &getbestblockhash,       {} },
     { "blockchain",         "getblockcount",          &getblockcount,          {} },
+    { "blockchain",         "getblockconnectstats",   &getblockconnectstats,   {} },
     { "blockchain",         "getblock",               &getblock,               {"blockhash","verbosity|verbose"} },
     { "blockchain",         "getblockdeltas",         &getblockdeltas,         {} },
+    { "blockchain",         "getblockfilter",         &getblockfilter,         {"blockhash","filtertype"} },
     { "blockchain",         "getblockhashes",         &getblockhashes,         {} },
     { "blockchain",         "getblockhash",           &getblockhash,           {"height"} },
     { "blockchain",         "getblockheader",         &getblockheader,         {"blockhash","verbose"} },
     { "blockchain",         "getchaintips",           &getchaintips,           {} },
+    { "blockchain",         "getindexinfo",           &getindexinfo,           {} },
     { "blockchain",         "getdifficulty",          &getdifficulty,          {} },
     { "blockchain",         "getmempoolancestors",    &getmempoolancestors,    {"txid","verbose"} },
     { "blockchain",         "getmempooldescendants",  &getmempooldescendants,  {"txid","verbose"} },
@@ -34,5 +34,11 @@ UniValue mempoolToJSON(bool fVerbose = false);
 /** Block header to JSON */
 UniValue blockheaderToJSON(const CBlockIndex* blockindex);
 
+/**
+ * Wait for the address, spent and timestamp indexes to include the chain tip, or throw
+ * when they are still being built. Must not be called with cs_main held.
+ */
+void EnsureIndexesSynced();
+
 #endif
 
@@ -12,6 +12,7 @@
 #include "consensus/params.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "hash.h"
 #include "init.h"
 #include "validation.h"
 #include "miner.h"
@@ -32,7 +33,6 @@
 
 #include <univalue.h>
 
-extern uint64_t nHashesPerSec;
 
 unsigned int ParseConfirmTarget(const UniValue& value)
 {
@@ -131,7 +131,8 @@ UniValue generateBlocks(std::shared_ptr<CReserveScript> coinbaseScript, int nGen
             LOCK(cs_main);
             IncrementExtraNonce(pblock, chainActive.Tip(), nExtraNonce);
         }
-        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetHash(), pblock->nBits, Params().GetConsensus())) {
+        CX16RMidstate midstate = pblock->GetX16RMidstate();
+        while (nMaxTries > 0 && pblock->nNonce < nInnerLoopCount && !CheckProofOfWork(pblock->GetHash(midstate), pblock->nBits, Params().GetConsensus())) {
             ++pblock->nNonce;
             --nMaxTries;
         }
@@ -204,6 +205,13 @@ UniValue getmininginfo(const JSONRPCRequest& request)
             "  \"difficulty\": xxx.xxxxx    (numeric) The current difficulty\n"
             "  \"networkhashps\": nnn,      (numeric) The network hashes per second\n"
             "  \"hashespersec\": nnn,       (numeric) The hashes per second of built-in miner\n"
+            "  \"threadhashespersec\": [nnn, ...], (array) The hashes per second of each built-in miner thread\n"
+            "  \"algorithmorders\": [        (array) The built-in miner's hashes per second on recent X16R algorithm orders\n"
+            "    {\n"
+            "      \"order\": \"xxxx\",        (string) The order of the 16 hash algorithms, one hex digit each\n"
+            "      \"hashespersec\": nnn      (numeric) The hashes per second while mining with this order\n"
+            "    }, ...\n"
+            "  ],\n"
             "  \"pooledtx\": n              (numeric) The size of the mempool\n"
             "  \"chain\": \"xxxx\",           (string) current network name as defined in BIP70 (main, test, regtest)\n"
             "  \"warnings\": \"...\"          (string) any network and blockchain warnings\n"
@@ -223,7 +231,21 @@ UniValue getmininginfo(const JSONRPCRequest& request)
     obj.push_back(Pair("currentblocktx",   (uint64_t)nLastBlockTx));
     obj.push_back(Pair("difficulty",       (double)GetDifficulty()));
     obj.push_back(Pair("networkhashps",    getnetworkhashps(request)));
-    obj.push_back(Pair("hashespersec",     (uint64_t)nHashesPerSec));
+    CMinerStats minerStats;
+    GetMinerStats(minerStats);
+    obj.push_back(Pair("hashespersec",     minerStats.nHashesPerSec));
+    UniValue threadRates(UniValue::VARR);
+    for (uint64_t nRate : minerStats.vThreadHashesPerSec)
+        threadRates.push_back(nRate);
+    obj.push_back(Pair("threadhashespersec", threadRates));
+    UniValue orderRates(UniValue::VARR);
+    for (const auto& orderRate : minerStats.vOrderHashesPerSec) {
+        UniValue entry(UniValue::VOBJ);
+        entry.push_back(Pair("order", orderRate.first));
+        entry.push_back(Pair("hashespersec", orderRate.second));
+        orderRates.push_back(entry);
+    }
+    obj.push_back(Pair("algorithmorders", orderRates));
     obj.push_back(Pair("pooledtx",         (uint64_t)mempool.size()));
     obj.push_back(Pair("chain",            Params().NetworkIDString()));
     if (IsDeprecatedRPCEnabled("getmininginfo")) {
@@ -458,7 +480,8 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
 
     if (!lpval.isNull())
     {
-        // Wait to respond until either the best block changes, OR a minute has passed and there are more transactions
+        // Wait to respond until either the best block changes, OR new transactions add enough fees to the
+        // template (see -longpollfeethreshold), OR a minute has passed and there are more transactions
         uint256 hashWatchedChain;
         boost::system_time checktxtime;
         unsigned int nTransactionsUpdatedLastLP;
@@ -486,6 +509,9 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
             boost::unique_lock<boost::mutex> lock(csBestBlock);
             while (chainActive.Tip()->GetBlockHash() == hashWatchedChain && IsRPCRunning())
             {
+                // New transactions that add enough fees to the last template notify cvBlockChange
+                if (mempool.TemplateFeesImproved() && mempool.GetTransactionsUpdated() != nTransactionsUpdatedLastLP)
+                    break;
                 if (!cvBlockChange.timed_wait(lock, checktxtime))
                 {
                     // Timeout: Check transactions for update
@@ -511,14 +537,22 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
     // Update block
     static CBlockIndex* pindexPrev;
     static int64_t nStart;
+    static int64_t nStartFull;
     static std::unique_ptr<CBlockTemplate> pblocktemplate;
     // Cache whether the last invocation was with segwit support, to avoid returning
     // a segwit-block to a non-segwit caller.
     static bool fLastTemplateSupportsSegwit = true;
-    if (pindexPrev != chainActive.Tip() ||
-        (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && GetTime() - nStart > 5) ||
-        fLastTemplateSupportsSegwit != fSupportsSegwit)
+    bool fNewTip = pindexPrev != chainActive.Tip() || fLastTemplateSupportsSegwit != fSupportsSegwit;
+    // New transactions that add enough fees to the template skip the refresh throttle
+    bool fFeesImproved = mempool.TemplateFeesImproved();
+    if (fNewTip || (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast && (fFeesImproved || GetTime() - nStart > 5)))
     {
+        // On the same tip, update the template for the mempool changes rather than
+        // assembling it from scratch, which is only done every so often. Once new
+        // transactions add enough fees, select from scratch so they can push out
+        // kept ones before the fee watch is armed again.
+        bool fUpdate = !fNewTip && !fFeesImproved && pblocktemplate && GetTime() - nStartFull <= BLOCK_TEMPLATE_REBUILD_INTERVAL;
+
         // Clear pindexPrev so future calls make a new block, despite any failures from here on
         pindexPrev = nullptr;
 
@@ -530,10 +564,20 @@ UniValue getblocktemplate(const JSONRPCRequest& request)
 
         // Create new block
         CScript scriptDummy = CScript() << OP_TRUE;
-        pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptDummy, fSupportsSegwit);
+        if (fUpdate) {
+            pblocktemplate = BlockAssembler(Params()).UpdateNewBlock(*pblocktemplate, scriptDummy, fSupportsSegwit);
+        } else {
+            nStartFull = nStart;
+            pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptDummy, fSupportsSegwit);
+        }
         if (!pblocktemplate)
             throw JSONRPCError(RPC_OUT_OF_MEMORY, "Out of memory");
 
+        // Have the mempool end long-polls once new transactions would add enough fees to this template
+        int64_t nFeeThreshold = gArgs.GetArg("-longpollfeethreshold", DEFAULT_LONGPOLL_FEE_THRESHOLD);
+        CAmount nTemplateFees = -pblocktemplate->vTxFees[0];
+        mempool.WatchTemplateFees(pblocktemplate->minFeeRate, nFeeThreshold > 0 ? std::max<CAmount>(1, nTemplateFees * nFeeThreshold / 100) : 0);
+
         // Need to update only after we know CreateNewBlock succeeded
         pindexPrev = pindexPrevNew;
     }
@@ -15,6 +15,7 @@
 #include "netbase.h"
 #include "rpc/blockchain.h"
 #include "rpc/server.h"
+#include "streams.h"
 #include "timedata.h"
 #include "txmempool.h"
 #include "util.h"
@@ -26,6 +27,7 @@
 #endif
 #include "warnings.h"
 
+#include <limits>
 #include <stdint.h>
 #ifdef HAVE_MALLOC_INFO
 #include <malloc.h>
@@ -699,16 +701,109 @@ bool getAddressesFromParams(const UniValue& params, std::vector<std::pair<uint16
     return true;
 }
 
-bool heightSort(std::pair<CAddressUnspentKey, CAddressUnspentValue> a,
-                std::pair<CAddressUnspentKey, CAddressUnspentValue> b) {
-    return a.second.blockHeight < b.second.blockHeight;
-}
-
 bool timestampSort(std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> a,
                    std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> b) {
     return a.second.time < b.second.time;
 }
 
+/** Read the optional "limit" and "cursor" fields of an address query, returns whether the results are paginated */
+bool getPageFromParams(const UniValue& params, size_t &limit, std::string &cursor)
+{
+    if (!params[0].isObject())
+        return false;
+
+    UniValue limitValue = find_value(params[0].get_obj(), "limit");
+    UniValue cursorValue = find_value(params[0].get_obj(), "cursor");
+    if (limitValue.isNull()) {
+        if (!cursorValue.isNull())
+            throw JSONRPCError(RPC_INVALID_PARAMETER, "A cursor requires a limit");
+        return false;
+    }
+    if (limitValue.get_int() <= 0)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Limit is expected to be greater than zero");
+    limit = limitValue.get_int();
+    if (!cursorValue.isNull())
+        cursor = cursorValue.get_str();
+    return true;
+}
+
+/** A cursor names the requested address and the index entry a page ended with */
+template <typename K>
+std::string encodeAddressCursor(size_t addressPos, const K &key)
+{
+    CDataStream ssCursor(SER_DISK, CLIENT_VERSION);
+    ssCursor << (uint32_t)addressPos << key;
+    return HexStr(ssCursor.begin(), ssCursor.end());
+}
+
+template <typename K>
+void decodeAddressCursor(const std::string &cursor, const std::vector<std::pair<uint160, int> > &addresses, size_t &addressPos, K &key)
+{
+    bool fValid = IsHex(cursor);
+    if (fValid) {
+        CDataStream ssCursor(ParseHex(cursor), SER_DISK, CLIENT_VERSION);
+        try {
+            uint32_t pos;
+            ssCursor >> pos >> key;
+            addressPos = pos;
+            fValid = ssCursor.empty() && addressPos < addresses.size() &&
+                     key.hashBytes == addresses[addressPos].first && key.type == (unsigned int)addresses[addressPos].second;
+        } catch (const std::exception&) {
+            fValid = false;
+        }
+    }
+    if (!fValid)
+        throw JSONRPCError(RPC_INVALID_PARAMETER, "Invalid cursor");
+}
+
+/**
+ * Collect one page of index entries of the given addresses, address by address in index order.
+ * readPage(address, pkeyAfter, nMax, entries) reads at most nMax entries of one address following
+ * pkeyAfter, and isNewItem(pkeyPrev, key) tells whether an entry counts towards the limit, so that
+ * the entries of one result item stay on the same page. Returns the cursor of the next page, or an
+ * empty string when there are no more entries.
+ */
+template <typename K, typename V, typename ReadPage, typename IsNewItem>
+std::string readAddressPage(const std::vector<std::pair<uint160, int> > &addresses, size_t limit, const std::string &cursor,
+                            ReadPage readPage, IsNewItem isNewItem, std::vector<std::pair<K, V> > &entries)
+{
+    size_t addressPos = 0;
+    K keyAfter;
+    bool fAfter = false;
+    if (!cursor.empty()) {
+        decodeAddressCursor(cursor, addresses, addressPos, keyAfter);
+        fAfter = true;
+    }
+    // The address keyAfter belongs to, which is still the previous one when a page ends on an address boundary
+    size_t keyPos = addressPos;
+
+    size_t items = 0;
+    for (; addressPos < addresses.size(); addressPos++, fAfter = false) {
+        while (true) {
+            // One entry more than the page can take, to find out whether the address has more
+            size_t nMax = limit - items + 1;
+            std::vector<std::pair<K, V> > page;
+            if (!readPage(addresses[addressPos], fAfter ? &keyAfter : nullptr, nMax, page)) {
+                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+            }
+            for (const std::pair<K, V> &entry : page) {
+                if (isNewItem(fAfter ? &keyAfter : nullptr, entry.first)) {
+                    if (items == limit)
+                        return encodeAddressCursor(keyPos, keyAfter);
+                    items++;
+                }
+                entries.push_back(entry);
+                keyAfter = entry.first;
+                keyPos = addressPos;
+                fAfter = true;
+            }
+            if (page.size() < nMax)
+                break;
+        }
+    }
+    return "";
+}
+
 UniValue getaddressmempool(const JSONRPCRequest& request)
 {
     if (request.fHelp || request.params.size() > 2)
@@ -815,6 +910,8 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    ],\n"
             "  \"chainInfo\",  (boolean, optional, default false) Include chain info with results\n"
             "  \"assetName\"   (string, optional) Get UTXOs for a particular asset instead of RVN ('*' for all assets).\n"
+            "  \"limit\"   (number, optional) Return at most this many outputs, in index order per address instead of by height\n"
+            "  \"cursor\"  (string, optional) Continue after the outputs returned with this cursor\n"
             "}\n"
             "\nResult\n"
             "[\n"
@@ -828,11 +925,17 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
             "    \"satoshis\"  (number) The number of satoshis of the output\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"utxos\"  (array) The outputs as above\n"
+            "  \"cursor\"  (string) Cursor of the next page, only present if there are more outputs\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
             + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"assetName\":\"MY_ASSET\"}'")
             + HelpExampleRpc("getaddressutxos", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"assetName\":\"MY_ASSET\"}")
+            + HelpExampleCli("getaddressutxos", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"],\"limit\":1000}'")
             );
 
     bool includeChainInfo = false;
@@ -856,22 +959,31 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    size_t limit = 0;
+    std::string cursor;
+    bool fPaginate = getPageFromParams(request.params, limit, cursor);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (assetName == "*") {
-            if (!GetAddressUnspent((*it).first, (*it).second, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressUnspent((*it).first, (*it).second, assetName, unspentOutputs)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+    EnsureIndexesSynced();
+
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+    std::string nextCursor;
+
+    if (fPaginate) {
+        std::string pageAssetName = assetName == "*" ? "" : assetName;
+        nextCursor = readAddressPage(addresses, limit, cursor,
+            [&pageAssetName](const std::pair<uint160, int> &address, const CAddressUnspentKey *pkeyAfter, size_t nMax,
+                             std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &page) {
+                return GetAddressUnspentPage(address.first, address.second, pageAssetName, pkeyAfter, nMax, page);
+            },
+            [](const CAddressUnspentKey *pkeyPrev, const CAddressUnspentKey &key) { return true; },
+            unspentOutputs);
+    } else {
+        // Merged in order of height
+        if (!GetAddressesUnspent(addresses, assetName == "*" ? "" : assetName, unspentOutputs)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
 
-    std::sort(unspentOutputs.begin(), unspentOutputs.end(), heightSort);
-
     UniValue utxos(UniValue::VARR);
 
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=unspentOutputs.begin(); it!=unspentOutputs.end(); it++) {
@@ -899,13 +1011,18 @@ UniValue getaddressutxos(const JSONRPCRequest& request)
         utxos.push_back(output);
     }
 
-    if (includeChainInfo) {
+    if (includeChainInfo || fPaginate) {
         UniValue result(UniValue::VOBJ);
         result.push_back(Pair("utxos", utxos));
 
-        LOCK(cs_main);
-        result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
-        result.push_back(Pair("height", (int)chainActive.Height()));
+        if (!nextCursor.empty()) {
+            result.push_back(Pair("cursor", nextCursor));
+        }
+        if (includeChainInfo) {
+            LOCK(cs_main);
+            result.push_back(Pair("hash", chainActive.Tip()->GetBlockHash().GetHex()));
+            result.push_back(Pair("height", (int)chainActive.Height()));
+        }
         return result;
     } else {
         return utxos;
@@ -929,6 +1046,8 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "  \"end\" (number) The end block height\n"
             "  \"chainInfo\" (boolean) Include chain info in results, only applies if start and end specified\n"
             "  \"assetName\"   (string, optional) Get deltas for a particular asset instead of RVN.\n"
+            "  \"limit\"   (number, optional) Return at most this many deltas\n"
+            "  \"cursor\"  (string, optional) Continue after the deltas returned with this cursor\n"
             "}\n"
             "\nResult:\n"
             "[\n"
@@ -941,6 +1060,12 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
             "    \"address\"  (string) The base58check encoded address\n"
             "  }\n"
             "]\n"
+            "\nResult (with limit or chainInfo):\n"
+            "{\n"
+            "  \"deltas\"  (array) The deltas as above\n"
+            "  \"cursor\"  (string) Cursor of the next page, only present if there are more deltas\n"
+            "  \"start\", \"end\"  (object) Hash and height of the start and end blocks, with chainInfo\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddressdeltas", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddressdeltas", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -986,17 +1111,26 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    size_t limit = 0;
+    std::string cursor;
+    bool fPaginate = getPageFromParams(request.params, limit, cursor);
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (start > 0 && end > 0) {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex, start, end)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
-        } else {
-            if (!GetAddressIndex((*it).first, (*it).second, assetName, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+    EnsureIndexesSynced();
+
+    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+    std::string nextCursor;
+
+    if (fPaginate) {
+        nextCursor = readAddressPage(addresses, limit, cursor,
+            [&assetName, start, end](const std::pair<uint160, int> &address, const CAddressIndexKey *pkeyAfter, size_t nMax,
+                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &page) {
+                return GetAddressIndexPage(address.first, address.second, assetName, start, end, pkeyAfter, nMax, page);
+            },
+            [](const CAddressIndexKey *pkeyPrev, const CAddressIndexKey &key) { return true; },
+            addressIndex);
+    } else {
+        if (!GetAddressesIndex(addresses, assetName, addressIndex, start, end)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
     }
 
@@ -1021,6 +1155,14 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
 
     UniValue result(UniValue::VOBJ);
 
+    if (fPaginate && !(includeChainInfo && start > 0 && end > 0)) {
+        result.push_back(Pair("deltas", deltas));
+        if (!nextCursor.empty()) {
+            result.push_back(Pair("cursor", nextCursor));
+        }
+        return result;
+    }
+
     if (includeChainInfo && start > 0 && end > 0) {
         LOCK(cs_main);
 
@@ -1041,6 +1183,9 @@ UniValue getaddressdeltas(const JSONRPCRequest& request)
         endInfo.push_back(Pair("height", end));
 
         result.push_back(Pair("deltas", deltas));
+        if (!nextCursor.empty()) {
+            result.push_back(Pair("cursor", nextCursor));
+        }
         result.push_back(Pair("start", startInfo));
         result.push_back(Pair("end", endInfo));
 
@@ -1092,6 +1237,8 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
         throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "Invalid address");
     }
 
+    EnsureIndexesSynced();
+
     bool includeAssets = false;
     if (request.params.size() > 1) {
         includeAssets = request.params[1].get_bool();
@@ -1103,10 +1250,8 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
 
         std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+        if (!GetAddressesIndex(addresses, "", addressIndex)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
 
         //assetName -> (received, balance)
@@ -1140,10 +1285,8 @@ UniValue getaddressbalance(const JSONRPCRequest& request)
     } else {
         std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-        for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-            if (!GetAddressIndex((*it).first, (*it).second, RVN, addressIndex)) {
-                throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-            }
+        if (!GetAddressesIndex(addresses, RVN, addressIndex)) {
+            throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
         }
 
         CAmount balance = 0;
@@ -1181,6 +1324,9 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "    ]\n"
             "  \"start\" (number, optional) The start block height\n"
             "  \"end\" (number, optional) The end block height\n"
+            "  \"limit\" (number, optional) Return at most this many txids, address by address. A transaction\n"
+            "          involving several of the addresses may then be listed once for each of them.\n"
+            "  \"cursor\" (string, optional) Continue after the txids returned with this cursor\n"
             "},\n"
             "\"includeAssets\" (boolean, optional, default false)  If true this will return an expanded result which includes asset transactions\n"
             "\nResult:\n"
@@ -1188,6 +1334,11 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
             "  \"transactionid\"  (string) The transaction id\n"
             "  ,...\n"
             "]\n"
+            "\nResult (with limit):\n"
+            "{\n"
+            "  \"txids\"  (array) The transaction ids as above\n"
+            "  \"cursor\"  (string) Cursor of the next page, only present if there are more txids\n"
+            "}\n"
             "\nExamples:\n"
             + HelpExampleCli("getaddresstxids", "'{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}'")
             + HelpExampleRpc("getaddresstxids", "{\"addresses\": [\"12c6DSiU4Rq3P4ZxziKxzrL5LmMBrzjrJX\"]}")
@@ -1221,52 +1372,61 @@ UniValue getaddresstxids(const JSONRPCRequest& request)
         if (!AreAssetsDeployed())
             throw JSONRPCError(RPC_INVALID_PARAMETER, "Assets aren't active.  includeAssets can't be true.");
 
+    size_t limit = 0;
+    std::string cursor;
+    bool fPaginate = getPageFromParams(request.params, limit, cursor);
+
+    EnsureIndexesSynced();
+
     std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
 
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        if (includeAssets) {
-            if (start > 0 && end > 0) {
-                if (!GetAddressIndex((*it).first, (*it).second, addressIndex, start, end)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            } else {
-                if (!GetAddressIndex((*it).first, (*it).second, addressIndex)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            }
-        } else {
-            if (start > 0 && end > 0) {
-                if (!GetAddressIndex((*it).first, (*it).second, RVN, addressIndex, start, end)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
-            } else {
-                if (!GetAddressIndex((*it).first, (*it).second, RVN, addressIndex)) {
-                    throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
-                }
+    if (fPaginate) {
+        std::string pageAssetName = includeAssets ? "" : RVN;
+        // The transactions of all assets are read in height order, which keeps their entries together
+        int pageStart = start, pageEnd = end;
+        if (includeAssets && !(start > 0 && end > 0)) {
+            pageStart = 0;
+            pageEnd = std::numeric_limits<int>::max();
+        }
+        std::string nextCursor = readAddressPage(addresses, limit, cursor,
+            [&pageAssetName, pageStart, pageEnd](const std::pair<uint160, int> &address, const CAddressIndexKey *pkeyAfter, size_t nMax,
+                                         std::vector<std::pair<CAddressIndexKey, CAmount> > &page) {
+                return GetAddressIndexPage(address.first, address.second, pageAssetName, pageStart, pageEnd, pkeyAfter, nMax, page);
+            },
+            // All entries of a transaction are next to each other in the index of an address
+            [](const CAddressIndexKey *pkeyPrev, const CAddressIndexKey &key) {
+                return !pkeyPrev || pkeyPrev->blockHeight != key.blockHeight || pkeyPrev->txindex != key.txindex;
+            },
+            addressIndex);
+
+        std::set<uint256> seen;
+        UniValue txids(UniValue::VARR);
+        for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
+            if (seen.insert(it->first.txhash).second) {
+                txids.push_back(it->first.txhash.GetHex());
             }
         }
-    }
 
-    std::set<std::pair<int, std::string> > txids;
-    UniValue result(UniValue::VARR);
-
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=addressIndex.begin(); it!=addressIndex.end(); it++) {
-        int height = it->first.blockHeight;
-        std::string txid = it->first.txhash.GetHex();
-
-        if (addresses.size() > 1) {
-            txids.insert(std::make_pair(height, txid));
-        } else {
-            if (txids.insert(std::make_pair(height, txid)).second) {
-                result.push_back(txid);
-            }
+        UniValue result(UniValue::VOBJ);
+        result.push_back(Pair("txids", txids));
+        if (!nextCursor.empty()) {
+            result.push_back(Pair("cursor", nextCursor));
         }
+        return result;
     }
 
-    if (addresses.size() > 1) {
-        for (std::set<std::pair<int, std::string> >::const_iterator it=txids.begin(); it!=txids.end(); it++) {
-            result.push_back(it->second);
-        }
+    bool fRange = start > 0 && end > 0;
+    if (!GetAddressesIndex(addresses, includeAssets ? "" : RVN, addressIndex, fRange ? start : 0, fRange ? end : 0)) {
+        throw JSONRPCError(RPC_INVALID_ADDRESS_OR_KEY, "No information available for address");
+    }
+
+    // Deduplicated in binary, only the result is hex encoded
+    std::vector<uint256> txids;
+    GetAddressIndexTxids(addressIndex, txids);
+
+    UniValue result(UniValue::VARR);
+    for (const uint256& txid : txids) {
+        result.push_back(txid.GetHex());
     }
 
     return result;
@@ -1306,6 +1466,8 @@ UniValue getspentinfo(const JSONRPCRequest& request)
     uint256 txid = ParseHashV(txidValue, "txid");
     int outputIndex = indexValue.get_int();
 
+    EnsureIndexesSynced();
+
     CSpentIndexKey key(txid, outputIndex);
     CSpentIndexValue value;
 
@@ -9,6 +9,7 @@
 #include "coins.h"
 #include "consensus/validation.h"
 #include "core_io.h"
+#include "indexwriter.h"
 #include "init.h"
 #include "keystore.h"
 #include "validation.h"
@@ -183,6 +184,10 @@ UniValue getrawtransaction(const JSONRPCRequest& request)
             + HelpExampleRpc("getrawtransaction", "\"mytxid\", true")
         );
 
+    // Spent info may be incomplete while the spent index is being built
+    if (fSpentIndex && g_indexwriter && !g_indexwriter->IsBuilding())
+        BlockUntilIndexesSynced();
+
     LOCK(cs_main);
 
     uint256 hash = ParseHashV(request.params[0], "parameter 1");
@@ -0,0 +1,687 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "stratum.h"
+
+#include "arith_uint256.h"
+#include "base58.h"
+#include "chainparams.h"
+#include "consensus/merkle.h"
+#include "miner.h"
+#include "netbase.h"
+#include "random.h"
+#include "streams.h"
+#include "txmempool.h"
+#include "ui_interface.h"
+#include "util.h"
+#include "utilstrencodings.h"
+#include "validation.h"
+#include "validationinterface.h"
+
+#include <univalue.h>
+
+#include <algorithm>
+#include <deque>
+#include <limits>
+#include <map>
+#include <memory>
+#include <set>
+#include <stdlib.h>
+
+#include <boost/bind.hpp>
+#include <boost/thread.hpp>
+
+#include <event2/buffer.h>
+#include <event2/bufferevent.h>
+#include <event2/event.h>
+#include <event2/listener.h>
+#include <event2/thread.h>
+#include <event2/util.h>
+
+/** Size of the per-connection part of the coinbase extranonce, chosen by us */
+static const int STRATUM_EXTRANONCE1_SIZE = 4;
+/** Size of the part of the coinbase extranonce rolled by the miner */
+static const int STRATUM_EXTRANONCE2_SIZE = 4;
+/** Sanity limit on the length of a request line */
+static const size_t MAX_STRATUM_LINE_LENGTH = 16384;
+/** Disconnect clients that stop reading once this much output is queued for them */
+static const size_t MAX_STRATUM_SEND_BUFFER = 1024 * 1024;
+/** Number of recent jobs that shares are still accepted for */
+static const size_t MAX_STRATUM_JOBS = 8;
+
+/** Stratum error codes, as used by the common pool implementations */
+enum StratumErrorCode
+{
+    STRATUM_ERR_OTHER = 20,
+    STRATUM_ERR_JOB_NOT_FOUND = 21,
+    STRATUM_ERR_DUPLICATE_SHARE = 22,
+    STRATUM_ERR_LOW_DIFFICULTY = 23,
+    STRATUM_ERR_UNAUTHORIZED = 24,
+    STRATUM_ERR_NOT_SUBSCRIBED = 25,
+};
+
+/** A block template handed out as a mining.notify job. The coinbase is split
+ * around the extranonce so that miners can roll extranonce2 themselves.
+ */
+struct StratumJob
+{
+    std::string strId;
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    int nHeight;
+    std::vector<unsigned char> vCoinbase1;
+    std::vector<unsigned char> vCoinbase2;
+    std::vector<uint256> vMerkleBranch;
+    /** Hashes of the shares already submitted for this job */
+    std::set<uint256> setShares;
+};
+
+struct StratumClient
+{
+    struct bufferevent* bev;
+    std::string strPeer;
+    std::vector<unsigned char> vExtraNonce1;
+    bool fSubscribed;
+    bool fAuthorized;
+};
+
+class StratumServer;
+
+/** Wakes the server thread up for a fresh job as soon as the tip changes */
+class StratumNotifier : public CValidationInterface
+{
+public:
+    explicit StratumNotifier(struct event* evIn) : ev(evIn) {}
+
+protected:
+    void UpdatedBlockTip(const CBlockIndex* pindexNew, const CBlockIndex* pindexFork, bool fInitialDownload) override
+    {
+        if (!fInitialDownload)
+            event_active(ev, 0, 0);
+    }
+
+private:
+    struct event* ev;
+};
+
+/** Catches the validation result of a block found by a Stratum client */
+class StratumBlockChecked : public CValidationInterface
+{
+public:
+    uint256 hash;
+    bool found;
+    CValidationState state;
+
+    explicit StratumBlockChecked(const uint256& hashIn) : hash(hashIn), found(false), state() {}
+
+protected:
+    void BlockChecked(const CBlock& block, const CValidationState& stateIn) override
+    {
+        if (block.GetHash() != hash)
+            return;
+        found = true;
+        state = stateIn;
+    }
+};
+
+/** All state is owned by the event loop thread, except for the tip notification
+ * which only activates an event.
+ */
+class StratumServer
+{
+public:
+    StratumServer(struct event_base* base, const CScript& scriptPayoutIn, const arith_uint256& shareTargetIn, double dDifficultyIn);
+    ~StratumServer();
+
+    bool Bind(const CService& addr);
+    /** Build a new job and push it to all subscribed clients */
+    void UpdateJob(bool fCleanJobs);
+    /** Rebuild the current job if the mempool has changed since it was made */
+    void RefreshJob();
+
+    struct event* evNewTip;
+    struct event* evRefresh;
+
+private:
+    struct event_base* base;
+    std::vector<struct evconnlistener*> vListeners;
+    std::map<struct bufferevent*, StratumClient> mapClients;
+    std::deque<std::unique_ptr<StratumJob>> vJobs;
+    CScript scriptPayout;
+    arith_uint256 shareTarget;
+    double dDifficulty;
+    uint32_t nExtraNonce1Counter;
+    uint32_t nJobCounter;
+    unsigned int nTransactionsUpdatedLast;
+
+    void Send(StratumClient& client, const UniValue& msg);
+    void SendResult(StratumClient& client, const UniValue& id, const UniValue& result);
+    void SendError(StratumClient& client, const UniValue& id, StratumErrorCode code, const std::string& strMessage);
+    void SendJob(StratumClient& client, const StratumJob& job, bool fCleanJobs);
+    void Disconnect(StratumClient& client);
+    /** Handle one request line. Returns false if the client was disconnected. */
+    bool HandleLine(StratumClient& client, const std::string& strLine);
+    void HandleSubmit(StratumClient& client, const UniValue& id, const UniValue& params);
+    StratumJob* FindJob(const std::string& strId);
+
+    static void accept_cb(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx);
+    static void read_cb(struct bufferevent* bev, void* ctx);
+    static void event_cb(struct bufferevent* bev, short what, void* ctx);
+};
+
+StratumServer::StratumServer(struct event_base* baseIn, const CScript& scriptPayoutIn, const arith_uint256& shareTargetIn, double dDifficultyIn) :
+    evNewTip(nullptr), evRefresh(nullptr), base(baseIn), scriptPayout(scriptPayoutIn), shareTarget(shareTargetIn), dDifficulty(dDifficultyIn),
+    nExtraNonce1Counter(GetRand(std::numeric_limits<uint32_t>::max())), nJobCounter(0), nTransactionsUpdatedLast(0)
+{
+}
+
+StratumServer::~StratumServer()
+{
+    for (auto& entry : mapClients)
+        bufferevent_free(entry.first);
+    mapClients.clear();
+    for (struct evconnlistener* listener : vListeners)
+        evconnlistener_free(listener);
+    vListeners.clear();
+}
+
+bool StratumServer::Bind(const CService& addr)
+{
+    struct sockaddr_storage sockaddr;
+    socklen_t len = sizeof(sockaddr);
+    if (!addr.GetSockAddr((struct sockaddr*)&sockaddr, &len)) {
+        LogPrintf("stratum: Unable to use %s as a bind address\n", addr.ToString());
+        return false;
+    }
+    struct evconnlistener* listener = evconnlistener_new_bind(base, accept_cb, this, LEV_OPT_CLOSE_ON_FREE | LEV_OPT_REUSEABLE, -1,
+                                                              (struct sockaddr*)&sockaddr, len);
+    if (!listener) {
+        LogPrintf("stratum: Unable to bind to %s\n", addr.ToString());
+        return false;
+    }
+    LogPrintf("stratum: Listening on %s\n", addr.ToString());
+    vListeners.push_back(listener);
+    return true;
+}
+
+void StratumServer::accept_cb(struct evconnlistener* listener, evutil_socket_t fd, struct sockaddr* addr, int socklen, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    struct bufferevent* bev = bufferevent_socket_new(self->base, fd, BEV_OPT_CLOSE_ON_FREE);
+    if (!bev) {
+        evutil_closesocket(fd);
+        return;
+    }
+
+    CService peer;
+    peer.SetSockAddr(addr);
+
+    StratumClient& client = self->mapClients[bev];
+    client.bev = bev;
+    client.strPeer = peer.ToString();
+    uint32_t nExtraNonce1 = self->nExtraNonce1Counter++;
+    for (int i = STRATUM_EXTRANONCE1_SIZE - 1; i >= 0; i--)
+        client.vExtraNonce1.push_back((nExtraNonce1 >> (8 * i)) & 0xff);
+    client.fSubscribed = false;
+    client.fAuthorized = false;
+
+    bufferevent_setcb(bev, read_cb, nullptr, event_cb, self);
+    bufferevent_enable(bev, EV_READ | EV_WRITE);
+    LogPrint(BCLog::STRATUM, "stratum: Client %s connected\n", client.strPeer);
+}
+
+void StratumServer::read_cb(struct bufferevent* bev, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    auto it = self->mapClients.find(bev);
+    if (it == self->mapClients.end())
+        return;
+    StratumClient& client = it->second;
+
+    struct evbuffer* input = bufferevent_get_input(bev);
+    size_t n_read_out = 0;
+    char* line;
+    while ((line = evbuffer_readln(input, &n_read_out, EVBUFFER_EOL_CRLF)) != nullptr) {
+        std::string strLine(line, n_read_out);
+        free(line);
+        // Handling a request may disconnect this or other stalled clients
+        if (!self->HandleLine(client, strLine) || !self->mapClients.count(bev))
+            return;
+    }
+    if (evbuffer_get_length(input) > MAX_STRATUM_LINE_LENGTH) {
+        LogPrint(BCLog::STRATUM, "stratum: Request line from %s too long, disconnecting\n", client.strPeer);
+        self->Disconnect(client);
+    }
+}
+
+void StratumServer::event_cb(struct bufferevent* bev, short what, void* ctx)
+{
+    StratumServer* self = static_cast<StratumServer*>(ctx);
+    auto it = self->mapClients.find(bev);
+    if (it == self->mapClients.end())
+        return;
+    if (what & (BEV_EVENT_EOF | BEV_EVENT_ERROR))
+        self->Disconnect(it->second);
+}
+
+void StratumServer::Disconnect(StratumClient& client)
+{
+    struct bufferevent* bev = client.bev;
+    LogPrint(BCLog::STRATUM, "stratum: Client %s disconnected\n", client.strPeer);
+    mapClients.erase(bev);
+    bufferevent_free(bev);
+}
+
+void StratumServer::Send(StratumClient& client, const UniValue& msg)
+{
+    std::string strMsg = msg.write() + "\n";
+    bufferevent_write(client.bev, strMsg.data(), strMsg.size());
+}
+
+void StratumServer::SendResult(StratumClient& client, const UniValue& id, const UniValue& result)
+{
+    UniValue reply(UniValue::VOBJ);
+    reply.push_back(Pair("id", id));
+    reply.push_back(Pair("result", result));
+    reply.push_back(Pair("error", NullUniValue));
+    Send(client, reply);
+}
+
+void StratumServer::SendError(StratumClient& client, const UniValue& id, StratumErrorCode code, const std::string& strMessage)
+{
+    UniValue error(UniValue::VARR);
+    error.push_back((int)code);
+    error.push_back(strMessage);
+    error.push_back(NullUniValue);
+
+    UniValue reply(UniValue::VOBJ);
+    reply.push_back(Pair("id", id));
+    reply.push_back(Pair("result", NullUniValue));
+    reply.push_back(Pair("error", error));
+    Send(client, reply);
+}
+
+/** Stratum sends the previous block hash as its internal byte order with each 32-bit word byte-swapped */
+static std::string StratumPrevHash(const uint256& hash)
+{
+    std::vector<unsigned char> vch(hash.begin(), hash.end());
+    for (size_t i = 0; i < vch.size(); i += 4)
+        std::reverse(vch.begin() + i, vch.begin() + i + 4);
+    return HexStr(vch);
+}
+
+void StratumServer::SendJob(StratumClient& client, const StratumJob& job, bool fCleanJobs)
+{
+    const CBlock& block = job.pblocktemplate->block;
+
+    UniValue branch(UniValue::VARR);
+    for (const uint256& hash : job.vMerkleBranch)
+        branch.push_back(HexStr(hash.begin(), hash.end()));
+
+    UniValue params(UniValue::VARR);
+    params.push_back(job.strId);
+    params.push_back(StratumPrevHash(block.hashPrevBlock));
+    params.push_back(HexStr(job.vCoinbase1));
+    params.push_back(HexStr(job.vCoinbase2));
+    params.push_back(branch);
+    params.push_back(strprintf("%08x", (uint32_t)block.nVersion));
+    params.push_back(strprintf("%08x", block.nBits));
+    params.push_back(strprintf("%08x", block.nTime));
+    params.push_back(fCleanJobs);
+
+    UniValue notify(UniValue::VOBJ);
+    notify.push_back(Pair("id", NullUniValue));
+    notify.push_back(Pair("method", "mining.notify"));
+    notify.push_back(Pair("params", params));
+    Send(client, notify);
+}
+
+StratumJob* StratumServer::FindJob(const std::string& strId)
+{
+    for (const auto& job : vJobs)
+        if (job->strId == strId)
+            return job.get();
+    return nullptr;
+}
+
+/** The coinbase scriptSig: BIP34 height followed by extranonce1 || extranonce2 */
+static CScript StratumCoinbaseScript(int nHeight, const std::vector<unsigned char>& vExtraNonce)
+{
+    return CScript() << nHeight << vExtraNonce;
+}
+
+void StratumServer::UpdateJob(bool fCleanJobs)
+{
+    if (IsInitialBlockDownload())
+        return;
+
+    std::unique_ptr<CBlockTemplate> pblocktemplate;
+    unsigned int nTransactionsUpdated = mempool.GetTransactionsUpdated();
+    try {
+        if (!fCleanJobs && !vJobs.empty())
+            pblocktemplate = BlockAssembler(Params()).UpdateNewBlock(*vJobs.back()->pblocktemplate, scriptPayout);
+        else
+            pblocktemplate = BlockAssembler(Params()).CreateNewBlock(scriptPayout);
+    } catch (const std::exception& e) {
+        LogPrintf("stratum: Unable to create a block template: %s\n", e.what());
+        return;
+    }
+    if (!pblocktemplate)
+        return;
+
+    std::unique_ptr<StratumJob> job(new StratumJob());
+    CBlock& block = pblocktemplate->block;
+    {
+        LOCK(cs_main);
+        BlockMap::const_iterator mi = mapBlockIndex.find(block.hashPrevBlock);
+        if (mi == mapBlockIndex.end())
+            return;
+        job->nHeight = mi->second->nHeight + 1;
+    }
+    nTransactionsUpdatedLast = nTransactionsUpdated;
+    // A new tip invalidates every outstanding job, not just the ones on the old tip
+    fCleanJobs = fCleanJobs || vJobs.empty() || vJobs.back()->pblocktemplate->block.hashPrevBlock != block.hashPrevBlock;
+
+    // Serialize the coinbase with two different extranonce placeholders to find where miners may roll it
+    const size_t nExtraNonceSize = STRATUM_EXTRANONCE1_SIZE + STRATUM_EXTRANONCE2_SIZE;
+    CMutableTransaction coinbaseTx(*block.vtx[0]);
+    coinbaseTx.vin[0].scriptSig = StratumCoinbaseScript(job->nHeight, std::vector<unsigned char>(nExtraNonceSize, 0x00));
+    CDataStream ssLow(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ssLow << coinbaseTx;
+    coinbaseTx.vin[0].scriptSig = StratumCoinbaseScript(job->nHeight, std::vector<unsigned char>(nExtraNonceSize, 0xff));
+    CDataStream ssHigh(SER_NETWORK, PROTOCOL_VERSION | SERIALIZE_TRANSACTION_NO_WITNESS);
+    ssHigh << coinbaseTx;
+
+    auto mismatch = std::mismatch(ssLow.begin(), ssLow.end(), ssHigh.begin());
+    size_t nOffset = mismatch.first - ssLow.begin();
+    if (ssLow.size() != ssHigh.size() || nOffset + nExtraNonceSize > ssLow.size() ||
+        !std::equal(ssLow.begin() + nOffset + nExtraNonceSize, ssLow.end(), ssHigh.begin() + nOffset + nExtraNonceSize)) {
+        LogPrintf("stratum: Unable to locate the extranonce in the coinbase\n");
+        return;
+    }
+    job->vCoinbase1.assign(ssLow.begin(), ssLow.begin() + nOffset);
+    job->vCoinbase2.assign(ssLow.begin() + nOffset + nExtraNonceSize, ssLow.end());
+    job->vMerkleBranch = BlockMerkleBranch(block, 0);
+    job->strId = strprintf("%x", ++nJobCounter);
+    job->pblocktemplate = std::move(pblocktemplate);
+
+    if (fCleanJobs)
+        vJobs.clear();
+    vJobs.push_back(std::move(job));
+    while (vJobs.size() > MAX_STRATUM_JOBS)
+        vJobs.pop_front();
+
+    const StratumJob& current = *vJobs.back();
+    LogPrint(BCLog::STRATUM, "stratum: New job %s at height %d with %u txs (clean %d)\n", current.strId, current.nHeight,
+             current.pblocktemplate->block.vtx.size(), fCleanJobs);
+
+    std::vector<StratumClient*> vStalled;
+    for (auto& entry : mapClients) {
+        StratumClient& client = entry.second;
+        if (!client.fSubscribed)
+            continue;
+        if (evbuffer_get_length(bufferevent_get_output(client.bev)) > MAX_STRATUM_SEND_BUFFER) {
+            vStalled.push_back(&client);
+            continue;
+        }
+        SendJob(client, current, fCleanJobs);
+    }
+    for (StratumClient* client : vStalled)
+        Disconnect(*client);
+}
+
+void StratumServer::RefreshJob()
+{
+    if (mempool.GetTransactionsUpdated() != nTransactionsUpdatedLast)
+        UpdateJob(false);
+}
+
+bool StratumServer::HandleLine(StratumClient& client, const std::string& strLine)
+{
+    if (strLine.empty())
+        return true;
+
+    UniValue request;
+    if (!request.read(strLine) || !request.isObject()) {
+        LogPrint(BCLog::STRATUM, "stratum: Malformed request from %s, disconnecting\n", client.strPeer);
+        Disconnect(client);
+        return false;
+    }
+
+    const UniValue& id = find_value(request, "id");
+    const UniValue& method = find_value(request, "method");
+    const UniValue& params = find_value(request, "params");
+    if (!method.isStr() || !params.isArray()) {
+        SendError(client, id, STRATUM_ERR_OTHER, "Invalid request");
+        return true;
+    }
+
+    if (method.get_str() == "mining.subscribe") {
+        std::string strSubscription = HexStr(client.vExtraNonce1);
+        UniValue subscriptions(UniValue::VARR);
+        for (const char* pszMethod : {"mining.set_difficulty", "mining.notify"}) {
+            UniValue subscription(UniValue::VARR);
+            subscription.push_back(pszMethod);
+            subscription.push_back(strSubscription);
+            subscriptions.push_back(subscription);
+        }
+        UniValue result(UniValue::VARR);
+        result.push_back(subscriptions);
+        result.push_back(HexStr(client.vExtraNonce1));
+        result.push_back(STRATUM_EXTRANONCE2_SIZE);
+        SendResult(client, id, result);
+        client.fSubscribed = true;
+
+        UniValue difficulty(UniValue::VARR);
+        difficulty.push_back(dDifficulty);
+        UniValue notify(UniValue::VOBJ);
+        notify.push_back(Pair("id", NullUniValue));
+        notify.push_back(Pair("method", "mining.set_difficulty"));
+        notify.push_back(Pair("params", difficulty));
+        Send(client, notify);
+
+        if (vJobs.empty())
+            UpdateJob(true);
+        else
+            SendJob(client, *vJobs.back(), true);
+    } else if (method.get_str() == "mining.authorize") {
+        // Payouts go to -stratumaddress, so worker names are only used for logging
+        if (params.size() < 1 || !params[0].isStr()) {
+            SendError(client, id, STRATUM_ERR_OTHER, "Invalid parameters");
+            return true;
+        }
+        LogPrint(BCLog::STRATUM, "stratum: Client %s authorized as %s\n", client.strPeer, params[0].get_str());
+        client.fAuthorized = true;
+        SendResult(client, id, true);
+    } else if (method.get_str() == "mining.submit") {
+        HandleSubmit(client, id, params);
+    } else {
+        SendError(client, id, STRATUM_ERR_OTHER, "Unknown method");
+    }
+    return true;
+}
+
+static bool ParseStratumUInt32(const UniValue& value, uint32_t& nOut)
+{
+    if (!value.isStr() || value.get_str().size() != 8 || !IsHex(value.get_str()))
+        return false;
+    nOut = (uint32_t)strtoul(value.get_str().c_str(), nullptr, 16);
+    return true;
+}
+
+void StratumServer::HandleSubmit(StratumClient& client, const UniValue& id, const UniValue& params)
+{
+    if (!client.fSubscribed) {
+        SendError(client, id, STRATUM_ERR_NOT_SUBSCRIBED, "Not subscribed");
+        return;
+    }
+    if (!client.fAuthorized) {
+        SendError(client, id, STRATUM_ERR_UNAUTHORIZED, "Unauthorized worker");
+        return;
+    }
+
+    // params: [worker, job_id, extranonce2, ntime, nonce]
+    uint32_t nTime, nNonce;
+    if (params.size() < 5 || !params[1].isStr() || !params[2].isStr() || !IsHex(params[2].get_str()) ||
+        !ParseStratumUInt32(params[3], nTime) || !ParseStratumUInt32(params[4], nNonce)) {
+        SendError(client, id, STRATUM_ERR_OTHER, "Invalid parameters");
+        return;
+    }
+    std::vector<unsigned char> vExtraNonce2 = ParseHex(params[2].get_str());
+    if (vExtraNonce2.size() != STRATUM_EXTRANONCE2_SIZE) {
+        SendError(client, id, STRATUM_ERR_OTHER, "Invalid extranonce2 size");
+        return;
+    }
+
+    StratumJob* pjob = FindJob(params[1].get_str());
+    if (!pjob) {
+        SendError(client, id, STRATUM_ERR_JOB_NOT_FOUND, "Job not found");
+        return;
+    }
+    StratumJob& job = *pjob;
+
+    std::vector<unsigned char> vExtraNonce(client.vExtraNonce1);
+    vExtraNonce.insert(vExtraNonce.end(), vExtraNonce2.begin(), vExtraNonce2.end());
+
+    CBlock block(job.pblocktemplate->block);
+    CMutableTransaction coinbaseTx(*block.vtx[0]);
+    coinbaseTx.vin[0].scriptSig = StratumCoinbaseScript(job.nHeight, vExtraNonce);
+    block.vtx[0] = MakeTransactionRef(std::move(coinbaseTx));
+    block.hashMerkleRoot = ComputeMerkleRootFromBranch(block.vtx[0]->GetHash(), job.vMerkleBranch, 0);
+    block.nTime = nTime;
+    block.nNonce = nNonce;
+
+    uint256 hash = block.GetHash();
+    if (job.setShares.count(hash)) {
+        SendError(client, id, STRATUM_ERR_DUPLICATE_SHARE, "Duplicate share");
+        return;
+    }
+
+    arith_uint256 blockTarget;
+    blockTarget.SetCompact(block.nBits);
+    arith_uint256 hashArith = UintToArith256(hash);
+    if (hashArith > shareTarget && hashArith > blockTarget) {
+        SendError(client, id, STRATUM_ERR_LOW_DIFFICULTY, "Low difficulty share");
+        return;
+    }
+    job.setShares.insert(hash);
+
+    if (hashArith <= blockTarget) {
+        LogPrintf("stratum: Block %s found by %s\n", hash.ToString(), client.strPeer);
+        StratumBlockChecked sc(hash);
+        RegisterValidationInterface(&sc);
+        bool fNewBlock = false;
+        bool fAccepted = ProcessNewBlock(Params(), std::make_shared<const CBlock>(block), true, &fNewBlock);
+        UnregisterValidationInterface(&sc);
+        if (!fAccepted || (sc.found && !sc.state.IsValid())) {
+            std::string strReason = sc.found && !sc.state.GetRejectReason().empty() ? sc.state.GetRejectReason() : "rejected";
+            LogPrintf("stratum: Block %s was rejected: %s\n", hash.ToString(), strReason);
+            SendError(client, id, STRATUM_ERR_OTHER, "Block rejected: " + strReason);
+            return;
+        }
+        if (!fNewBlock)
+            LogPrintf("stratum: Block %s was already known\n", hash.ToString());
+    }
+    SendResult(client, id, true);
+}
+
+static struct event_base* gStratumBase = nullptr;
+static boost::thread stratumThread;
+static std::unique_ptr<StratumServer> gStratumServer;
+static std::unique_ptr<StratumNotifier> gStratumNotifier;
+
+static void StratumNewTipCallback(evutil_socket_t, short, void*)
+{
+    gStratumServer->UpdateJob(true);
+}
+
+static void StratumRefreshCallback(evutil_socket_t, short, void*)
+{
+    gStratumServer->RefreshJob();
+}
+
+static void StratumThread()
+{
+    event_base_dispatch(gStratumBase);
+}
+
+bool StartStratumServer()
+{
+    if (!gArgs.GetBoolArg("-stratum", DEFAULT_STRATUM_ENABLE))
+        return true;
+
+    CTxDestination dest = DecodeDestination(gArgs.GetArg("-stratumaddress", ""));
+    if (!IsValidDestination(dest))
+        return InitError(_("-stratum requires a valid -stratumaddress to pay block rewards to"));
+
+    double dDifficulty = atof(gArgs.GetArg("-stratumdifficulty", std::to_string(DEFAULT_STRATUM_DIFFICULTY)).c_str());
+    if (!(dDifficulty * 1000000 >= 1) || dDifficulty > 1e12)
+        return InitError(strprintf(_("Invalid -stratumdifficulty: '%s'"), gArgs.GetArg("-stratumdifficulty", "")));
+    // Share target: the difficulty 1 target scaled down by the difficulty, in millionths
+    arith_uint256 shareTarget;
+    shareTarget.SetCompact(0x1d00ffff);
+    shareTarget *= 1000000;
+    shareTarget /= arith_uint256((uint64_t)(dDifficulty * 1000000));
+
+#ifdef WIN32
+    evthread_use_windows_threads();
+#else
+    evthread_use_pthreads();
+#endif
+    gStratumBase = event_base_new();
+    if (!gStratumBase)
+        return InitError(_("Unable to create the Stratum event base"));
+
+    gStratumServer.reset(new StratumServer(gStratumBase, GetScriptForDestination(dest), shareTarget, dDifficulty));
+
+    int nPort = gArgs.GetArg("-stratumport", (int)DEFAULT_STRATUM_PORT);
+    std::vector<std::string> vBind = gArgs.GetArgs("-stratumbind");
+    if (vBind.empty())
+        vBind.push_back("127.0.0.1");
+    bool fBound = false;
+    for (const std::string& strBind : vBind) {
+        CService addrBind;
+        if (!Lookup(strBind.c_str(), addrBind, nPort, false))
+            return InitError(strprintf(_("Cannot resolve -stratumbind address: '%s'"), strBind));
+        fBound |= gStratumServer->Bind(addrBind);
+    }
+    if (!fBound) {
+        gStratumServer.reset();
+        event_base_free(gStratumBase);
+        gStratumBase = nullptr;
+        return InitError(strprintf(_("Unable to bind the Stratum server to port %d"), nPort));
+    }
+
+    gStratumServer->evNewTip = event_new(gStratumBase, -1, 0, StratumNewTipCallback, nullptr);
+    gStratumServer->evRefresh = event_new(gStratumBase, -1, EV_PERSIST, StratumRefreshCallback, nullptr);
+    struct timeval tv = {STRATUM_JOB_REFRESH_INTERVAL, 0};
+    event_add(gStratumServer->evRefresh, &tv);
+
+    gStratumNotifier.reset(new StratumNotifier(gStratumServer->evNewTip));
+    RegisterValidationInterface(gStratumNotifier.get());
+
+    stratumThread = boost::thread(boost::bind(&TraceThread<void (*)()>, "stratum", &StratumThread));
+    return true;
+}
+
+void InterruptStratumServer()
+{
+    if (gStratumBase) {
+        LogPrintf("stratum: Thread interrupt\n");
+        event_base_loopbreak(gStratumBase);
+    }
+}
+
+void StopStratumServer()
+{
+    if (gStratumBase) {
+        UnregisterValidationInterface(gStratumNotifier.get());
+        gStratumNotifier.reset();
+        stratumThread.join();
+        event_free(gStratumServer->evNewTip);
+        event_free(gStratumServer->evRefresh);
+        gStratumServer.reset();
+        event_base_free(gStratumBase);
+        gStratumBase = nullptr;
+    }
+}
@@ -0,0 +1,27 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+/**
+ * Stratum (v1) work server: pushes block templates to miners as mining.notify
+ * jobs as soon as the tip changes and submits solved blocks through
+ * ProcessNewBlock, without the getblocktemplate polling round trip.
+ */
+#ifndef RAVEN_STRATUM_H
+#define RAVEN_STRATUM_H
+
+#include <stdint.h>
+
+static const bool DEFAULT_STRATUM_ENABLE = false;
+static const unsigned short DEFAULT_STRATUM_PORT = 3333;
+/** Share difficulty announced to miners, in units of the 0x1d00ffff target */
+static const double DEFAULT_STRATUM_DIFFICULTY = 1.0;
+/** Seconds between job refreshes that pick up new mempool transactions */
+static const int64_t STRATUM_JOB_REFRESH_INTERVAL = 30;
+
+/** Start the server if -stratum is set. Returns false (after InitError) on bad options or bind failure. */
+bool StartStratumServer();
+void InterruptStratumServer();
+void StopStratumServer();
+
+#endif // RAVEN_STRATUM_H
@@ -0,0 +1,194 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#ifndef RAVEN_SUPPORT_ALLOCATORS_POOL_H
+#define RAVEN_SUPPORT_ALLOCATORS_POOL_H
+
+#include <cstddef>
+#include <new>
+#include <vector>
+
+/**
+ * Memory resource for node based containers, which allocate one small block per element.
+ *
+ * Blocks of up to MAX_BLOCK_SIZE_BYTES are rounded up to a multiple of ALIGN_BYTES and
+ * handed out from a free list per rounded size, which is refilled by carving up large
+ * chunks. Freed blocks go back on their free list for the next element of that size; the
+ * chunks themselves are only released when the resource is destroyed. Larger or more
+ * strictly aligned requests (e.g. the bucket array of a hashed index) go to operator new.
+ *
+ * Every block handed out is counted, so InUseBytes() is the exact memory the containers
+ * hold rather than an estimate of allocator overhead.
+ *
+ * Not thread safe: the owner must serialize access, and the resource must outlive every
+ * container allocating from it.
+ */
+template <std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolResource
+{
+    static_assert(ALIGN_BYTES >= sizeof(void*), "ALIGN_BYTES must fit a free list pointer");
+    static_assert((ALIGN_BYTES & (ALIGN_BYTES - 1)) == 0, "ALIGN_BYTES must be a power of two");
+    static_assert(ALIGN_BYTES <= alignof(std::max_align_t), "chunks are only aligned to max_align_t");
+
+    /** A free block, linked to the next free block of the same size */
+    struct ListNode {
+        ListNode* pNext;
+    };
+
+    const std::size_t nChunkSizeBytes;
+    //! Free lists, indexed by block size in units of ALIGN_BYTES
+    std::vector<ListNode*> vFreeLists;
+    std::vector<void*> vChunks;
+    //! Not yet handed out part of the newest chunk
+    char* pAvailableBegin;
+    char* pAvailableEnd;
+    std::size_t nInUseBytes;
+
+    static std::size_t NumAlignUnits(std::size_t nBytes)
+    {
+        return nBytes == 0 ? 1 : (nBytes + ALIGN_BYTES - 1) / ALIGN_BYTES;
+    }
+
+    static bool IsPooled(std::size_t nBytes, std::size_t nAlignment)
+    {
+        return nBytes <= MAX_BLOCK_SIZE_BYTES && nAlignment <= ALIGN_BYTES;
+    }
+
+    void PushFree(void* p, std::size_t nUnits)
+    {
+        ListNode* pNode = new (p) ListNode;
+        pNode->pNext = vFreeLists[nUnits];
+        vFreeLists[nUnits] = pNode;
+    }
+
+    void AllocateChunk()
+    {
+        // The unused tail of the current chunk is smaller than the block that did not fit,
+        // so it fits a free list
+        if (pAvailableBegin != pAvailableEnd)
+            PushFree(pAvailableBegin, (pAvailableEnd - pAvailableBegin) / ALIGN_BYTES);
+
+        void* pChunk = ::operator new(nChunkSizeBytes);
+        vChunks.push_back(pChunk);
+        pAvailableBegin = static_cast<char*>(pChunk);
+        pAvailableEnd = pAvailableBegin + nChunkSizeBytes;
+    }
+
+public:
+    explicit PoolResource(std::size_t nChunkSizeBytesIn = 256 * 1024)
+        : nChunkSizeBytes(NumAlignUnits(nChunkSizeBytesIn < MAX_BLOCK_SIZE_BYTES ? MAX_BLOCK_SIZE_BYTES : nChunkSizeBytesIn) * ALIGN_BYTES),
+          vFreeLists(NumAlignUnits(MAX_BLOCK_SIZE_BYTES) + 1, nullptr),
+          pAvailableBegin(nullptr), pAvailableEnd(nullptr), nInUseBytes(0)
+    {
+    }
+
+    ~PoolResource()
+    {
+        for (void* pChunk : vChunks)
+            ::operator delete(pChunk);
+    }
+
+    PoolResource(const PoolResource&) = delete;
+    PoolResource& operator=(const PoolResource&) = delete;
+
+    void* Allocate(std::size_t nBytes, std::size_t nAlignment)
+    {
+        if (!IsPooled(nBytes, nAlignment)) {
+            void* p = ::operator new(nBytes);
+            nInUseBytes += nBytes;
+            return p;
+        }
+
+        const std::size_t nUnits = NumAlignUnits(nBytes);
+        nInUseBytes += nUnits * ALIGN_BYTES;
+        if (vFreeLists[nUnits] != nullptr) {
+            ListNode* pNode = vFreeLists[nUnits];
+            vFreeLists[nUnits] = pNode->pNext;
+            return pNode;
+        }
+        if (static_cast<std::size_t>(pAvailableEnd - pAvailableBegin) < nUnits * ALIGN_BYTES)
+            AllocateChunk();
+        void* p = pAvailableBegin;
+        pAvailableBegin += nUnits * ALIGN_BYTES;
+        return p;
+    }
+
+    void Deallocate(void* p, std::size_t nBytes, std::size_t nAlignment) noexcept
+    {
+        if (!IsPooled(nBytes, nAlignment)) {
+            ::operator delete(p);
+            nInUseBytes -= nBytes;
+            return;
+        }
+
+        const std::size_t nUnits = NumAlignUnits(nBytes);
+        nInUseBytes -= nUnits * ALIGN_BYTES;
+        PushFree(p, nUnits);
+    }
+
+    /** Bytes currently handed out, with pooled blocks counted at their rounded size */
+    std::size_t InUseBytes() const { return nInUseBytes; }
+    /** Bytes held in chunks, including free blocks kept for reuse */
+    std::size_t ChunkBytes() const { return vChunks.size() * nChunkSizeBytes; }
+};
+
+/**
+ * Allocator that takes its memory from a PoolResource, so containers sharing a resource
+ * share its free lists. Rebinds to any type, e.g. the internal nodes of a container.
+ */
+template <class T, std::size_t MAX_BLOCK_SIZE_BYTES, std::size_t ALIGN_BYTES>
+class PoolAllocator
+{
+    template <class U, std::size_t M, std::size_t A>
+    friend class PoolAllocator;
+
+    PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* pResource;
+
+public:
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef std::size_t size_type;
+    typedef std::ptrdiff_t difference_type;
+
+    template <class U>
+    struct rebind {
+        typedef PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES> other;
+    };
+
+    explicit PoolAllocator(PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* pResourceIn) noexcept : pResource(pResourceIn) {}
+
+    template <class U>
+    PoolAllocator(const PoolAllocator<U, MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>& other) noexcept : pResource(other.pResource) {}
+
+    T* allocate(std::size_t n)
+    {
+        if (n > static_cast<std::size_t>(-1) / sizeof(T))
+            throw std::bad_alloc();
+        return static_cast<T*>(pResource->Allocate(n * sizeof(T), alignof(T)));
+    }
+
+    void deallocate(T* p, std::size_t n) noexcept
+    {
+        pResource->Deallocate(p, n * sizeof(T), alignof(T));
+    }
+
+    PoolResource<MAX_BLOCK_SIZE_BYTES, ALIGN_BYTES>* Resource() const { return pResource; }
+};
+
+template <class T, class U, std::size_t M, std::size_t A>
+bool operator==(const PoolAllocator<T, M, A>& a, const PoolAllocator<U, M, A>& b) noexcept
+{
+    return a.Resource() == b.Resource();
+}
+
+template <class T, class U, std::size_t M, std::size_t A>
+bool operator!=(const PoolAllocator<T, M, A>& a, const PoolAllocator<U, M, A>& b) noexcept
+{
+    return !(a == b);
+}
+
+#endif // RAVEN_SUPPORT_ALLOCATORS_POOL_H
@@ -5,9 +5,12 @@
 
 #include "util.h"
 
+#include "support/allocators/pool.h"
 #include "support/allocators/secure.h"
 #include "test/test_raven.h"
 
+#include <map>
+
 #include <boost/test/unit_test.hpp>
 
 BOOST_FIXTURE_TEST_SUITE(allocator_tests, BasicTestingSetup)
@@ -251,4 +254,55 @@ BOOST_FIXTURE_TEST_SUITE(allocator_tests, BasicTestingSetup)
         BOOST_CHECK(pool.stats().used == initial.used);
     }
 
+    BOOST_AUTO_TEST_CASE(pool_resource_test)
+    {
+        BOOST_TEST_MESSAGE("Running Pool Resource Test");
+
+        PoolResource<64, 8> resource(1024);
+        BOOST_CHECK(resource.InUseBytes() == 0);
+        BOOST_CHECK(resource.ChunkBytes() == 0);
+
+        // Small blocks are rounded up to the alignment and carved from one chunk
+        void *a0 = resource.Allocate(20, 8);
+        void *a1 = resource.Allocate(24, 8);
+        BOOST_CHECK(resource.InUseBytes() == 48);
+        BOOST_CHECK(resource.ChunkBytes() == 1024);
+        BOOST_CHECK(reinterpret_cast<uintptr_t>(a0) % 8 == 0);
+        BOOST_CHECK(reinterpret_cast<uintptr_t>(a1) % 8 == 0);
+
+        // A freed block is reused for the next block of the same rounded size
+        resource.Deallocate(a0, 20, 8);
+        BOOST_CHECK(resource.InUseBytes() == 24);
+        void *a2 = resource.Allocate(17, 8);
+        BOOST_CHECK(a2 == a0);
+
+        // Blocks that are too large or too strictly aligned bypass the pool, but are still counted
+        void *big = resource.Allocate(100, 8);
+        void *aligned = resource.Allocate(16, 16);
+        BOOST_CHECK(resource.InUseBytes() == 24 + 24 + 100 + 16);
+        resource.Deallocate(big, 100, 8);
+        resource.Deallocate(aligned, 16, 16);
+        resource.Deallocate(a1, 24, 8);
+        resource.Deallocate(a2, 17, 8);
+        BOOST_CHECK(resource.InUseBytes() == 0);
+        BOOST_CHECK(resource.ChunkBytes() == 1024);
+
+        // Containers sharing the resource draw more chunks as they grow and give every block back
+        {
+            typedef std::map<int, int, std::less<int>, PoolAllocator<std::pair<const int, int>, 64, 8> > poolMap;
+            poolMap map1((std::less<int>()), PoolAllocator<std::pair<const int, int>, 64, 8>(&resource));
+            poolMap map2((std::less<int>()), PoolAllocator<std::pair<const int, int>, 64, 8>(&resource));
+            for (int i = 0; i < 1000; i++) {
+                map1[i] = i;
+                map2[-i] = i;
+            }
+            BOOST_CHECK(resource.InUseBytes() >= 2000 * sizeof(std::pair<const int, int>));
+            BOOST_CHECK(resource.ChunkBytes() > 1024);
+            for (int i = 0; i < 1000; i += 2)
+                map1.erase(i);
+            BOOST_CHECK(map1.size() == 500 && map1.count(1) && !map1.count(2));
+        }
+        BOOST_CHECK(resource.InUseBytes() == 0);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
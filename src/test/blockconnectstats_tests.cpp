@@ -0,0 +1,67 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockconnectstats.h"
+#include "test/test_raven.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockconnectstats_tests, BasicTestingSetup)
+
+    BOOST_AUTO_TEST_CASE(blockconnectstats_percentiles_test)
+    {
+        BOOST_TEST_MESSAGE("Running Block Connect Stats Percentiles Test");
+
+        CBlockConnectStats stats(100);
+        std::vector<CBlockConnectStageSummary> vSummary;
+        BOOST_CHECK_EQUAL(stats.Summarize(vSummary), 0U);
+        BOOST_CHECK_EQUAL(vSummary.size(), (size_t)CONNECT_STAGE_COUNT);
+
+        // Blocks taking 1..100us in total, recorded in two parts
+        for (int i = 1; i <= 100; i++) {
+            stats.BeginBlock();
+            stats.Record(CONNECT_STAGE_TOTAL, i - 1);
+            stats.Record(CONNECT_STAGE_TOTAL, 1);
+            stats.CommitBlock();
+        }
+        BOOST_CHECK_EQUAL(stats.Summarize(vSummary), 100U);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_TOTAL].nP50, 50);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_TOTAL].nP95, 95);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_TOTAL].nP99, 99);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_TOTAL].nMax, 100);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_TOTAL].nMean, 50);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_CONNECT_TXS].nMax, 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(blockconnectstats_window_test)
+    {
+        BOOST_TEST_MESSAGE("Running Block Connect Stats Window Test");
+
+        CBlockConnectStats stats(10);
+        std::vector<CBlockConnectStageSummary> vSummary;
+
+        // An unfinished block is discarded by the next BeginBlock
+        stats.BeginBlock();
+        stats.Record(CONNECT_STAGE_VERIFY_SCRIPTS, 1000000);
+
+        for (int i = 1; i <= 20; i++) {
+            stats.BeginBlock();
+            stats.Record(CONNECT_STAGE_VERIFY_SCRIPTS, i);
+            stats.CommitBlock();
+        }
+        BOOST_CHECK_EQUAL(stats.Summarize(vSummary), 10U);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_VERIFY_SCRIPTS].nP50, 15);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_VERIFY_SCRIPTS].nMax, 20);
+
+        stats.SetMaxBlocks(4);
+        BOOST_CHECK_EQUAL(stats.Summarize(vSummary), 4U);
+        BOOST_CHECK_EQUAL(vSummary[CONNECT_STAGE_VERIFY_SCRIPTS].nP50, 18);
+
+        stats.SetMaxBlocks(0);
+        stats.BeginBlock();
+        stats.CommitBlock();
+        BOOST_CHECK_EQUAL(stats.Summarize(vSummary), 0U);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,109 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "blockfilter.h"
+#include "coins.h"
+#include "primitives/block.h"
+#include "script/script.h"
+#include "undo.h"
+#include "test/test_raven.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(blockfilter_tests, BasicTestingSetup)
+
+    BOOST_AUTO_TEST_CASE(blockfilter_gcs_filter_test)
+    {
+        BOOST_TEST_MESSAGE("Running Block Filter GCS Filter Test");
+
+        GCSFilter::ElementSet included, excluded;
+        for (int i = 0; i < 100; i++) {
+            GCSFilter::Element element1(32);
+            element1[0] = i;
+            included.insert(std::move(element1));
+
+            GCSFilter::Element element2(32);
+            element2[1] = i;
+            excluded.insert(std::move(element2));
+        }
+
+        GCSFilter filter(0, 0, 10, 1 << 10, included);
+        BOOST_CHECK_EQUAL(filter.GetN(), 100U);
+        for (const auto& element : included) {
+            BOOST_CHECK(filter.Match(element));
+            BOOST_CHECK(filter.MatchAny({element, *excluded.begin()}));
+        }
+
+        // Decoding gives the same filter, truncating it fails
+        GCSFilter decoded(0, 0, 10, 1 << 10, filter.GetEncoded());
+        BOOST_CHECK_EQUAL(decoded.GetN(), 100U);
+        BOOST_CHECK(decoded.MatchAny(included));
+        std::vector<unsigned char> vTruncated(filter.GetEncoded().begin(), filter.GetEncoded().end() - 4);
+        BOOST_CHECK_THROW(GCSFilter(0, 0, 10, 1 << 10, vTruncated), std::ios_base::failure);
+
+        // No false negatives, and few false positives at a rate of 1 / 1024
+        int nFalsePositives = 0;
+        for (const auto& element : excluded)
+            nFalsePositives += filter.Match(element);
+        BOOST_CHECK(nFalsePositives < 5);
+
+        GCSFilter empty;
+        BOOST_CHECK_EQUAL(empty.GetEncoded().size(), 1U);
+        BOOST_CHECK(!empty.Match(*included.begin()));
+    }
+
+    BOOST_AUTO_TEST_CASE(blockfilter_basic_test)
+    {
+        BOOST_TEST_MESSAGE("Running Block Filter Basic Test");
+
+        CScript scriptPayee = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x01) << OP_EQUALVERIFY << OP_CHECKSIG;
+        CScript scriptAsset = CScript() << OP_DUP << OP_HASH160 << std::vector<unsigned char>(20, 0x02) << OP_EQUALVERIFY << OP_CHECKSIG
+                                        << OP_RVN_ASSET << std::vector<unsigned char>(16, 0x03) << OP_DROP;
+        CScript scriptData = CScript() << OP_RETURN << std::vector<unsigned char>(4, 0x04);
+        CScript scriptSpent = CScript() << OP_HASH160 << std::vector<unsigned char>(20, 0x05) << OP_EQUAL;
+        CScript scriptOther = CScript() << OP_HASH160 << std::vector<unsigned char>(20, 0x06) << OP_EQUAL;
+
+        CMutableTransaction coinbase;
+        coinbase.vin.resize(1);
+        coinbase.vout.emplace_back(5000, scriptPayee);
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].prevout = COutPoint(InsecureRand256(), 0);
+        tx.vout.emplace_back(0, scriptAsset);
+        tx.vout.emplace_back(0, scriptData);
+        tx.vout.emplace_back(0, CScript());
+
+        CBlock block;
+        block.vtx.push_back(MakeTransactionRef(coinbase));
+        block.vtx.push_back(MakeTransactionRef(tx));
+
+        CBlockUndo blockundo;
+        blockundo.vtxundo.resize(1);
+        blockundo.vtxundo[0].vprevout.emplace_back(CTxOut(1000, scriptSpent), 100, false);
+
+        BlockFilter filter(block, blockundo);
+        BOOST_CHECK(filter.GetBlockHash() == block.GetHash());
+        BOOST_CHECK_EQUAL(filter.GetFilter().GetN(), 3U);
+        BOOST_CHECK(filter.GetFilter().Match(GCSFilter::Element(scriptPayee.begin(), scriptPayee.end())));
+        BOOST_CHECK(filter.GetFilter().Match(GCSFilter::Element(scriptAsset.begin(), scriptAsset.end())));
+        BOOST_CHECK(filter.GetFilter().Match(GCSFilter::Element(scriptSpent.begin(), scriptSpent.end())));
+        BOOST_CHECK(!filter.GetFilter().Match(GCSFilter::Element(scriptData.begin(), scriptData.end())));
+        BOOST_CHECK(!filter.GetFilter().Match(GCSFilter::Element(scriptOther.begin(), scriptOther.end())));
+
+        // Stored with its header, and read back by block hash
+        CBlockFilterIndexValue value(filter);
+        value.SetPrevHeader(uint256());
+        BOOST_CHECK(value.hashFilter == filter.GetHash());
+        BOOST_CHECK(!value.header.IsNull());
+        BlockFilter decoded(block.GetHash(), value.vFilter);
+        BOOST_CHECK(decoded.GetHash() == filter.GetHash());
+        BOOST_CHECK(decoded.GetFilter().Match(GCSFilter::Element(scriptSpent.begin(), scriptSpent.end())));
+
+        // Headers chain up over the filters
+        CBlockFilterIndexValue next(filter);
+        next.SetPrevHeader(value.header);
+        BOOST_CHECK(next.header != value.header);
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
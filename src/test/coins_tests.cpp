@@ -856,6 +856,41 @@ BOOST_FIXTURE_TEST_SUITE(coins_tests, BasicTestingSetup)
         CheckAddCoin(VALUE2, VALUE3, VALUE3, DIRTY | FRESH, DIRTY | FRESH, true);
     }
 
+    void CheckImportCoin(CAmount cache_value, CAmount import_value, CAmount expected_value, char cache_flags, char expected_flags)
+    {
+        SingleEntryCacheTest test(ABSENT, cache_value, cache_flags);
+
+        Coin coin;
+        SetCoinsValue(import_value, coin);
+        test.cache.ImportCoin(OUTPOINT, std::move(coin));
+        test.cache.SelfTest();
+
+        CAmount result_value;
+        char result_flags;
+        GetCoinsMapEntry(test.cache.map(), result_value, result_flags);
+        BOOST_CHECK_EQUAL(result_value, expected_value);
+        BOOST_CHECK_EQUAL(result_flags, expected_flags);
+    }
+
+    BOOST_AUTO_TEST_CASE(ccoins_import_test)
+    {
+        BOOST_TEST_MESSAGE("Running cCoins Import Test");
+
+        /* Check ImportCoin behavior, inserting a coin read from the base view by
+         * another thread. Existing entries, spent or not, are never replaced and
+         * imported entries are clean, as if AccessCoin had fetched them.
+         *
+         *              Cache   Import  Result  Cache        Result
+         *              Value   Value   Value   Flags        Flags
+         */
+        CheckImportCoin(ABSENT, VALUE3, VALUE3, NO_ENTRY, 0);
+        CheckImportCoin(ABSENT, PRUNED, ABSENT, NO_ENTRY, NO_ENTRY);
+        CheckImportCoin(PRUNED, VALUE3, PRUNED, DIRTY, DIRTY);
+        CheckImportCoin(PRUNED, VALUE3, PRUNED, FRESH, FRESH);
+        CheckImportCoin(VALUE2, VALUE3, VALUE2, 0, 0);
+        CheckImportCoin(VALUE2, VALUE3, VALUE2, DIRTY, DIRTY);
+    }
+
     void CheckWriteCoins(CAmount parent_value, CAmount child_value, CAmount expected_value, char parent_flags, char child_flags, char expected_flags)
     {
         SingleEntryCacheTest test(ABSENT, parent_value, parent_flags);
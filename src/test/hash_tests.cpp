@@ -7,6 +7,7 @@
 #include "utilstrencodings.h"
 #include "test/test_raven.h"
 #include "consensus/merkle.h"
+#include "primitives/block.h"
 
 #include <vector>
 #include<iostream>
@@ -181,4 +182,38 @@ BOOST_FIXTURE_TEST_SUITE(hash_tests, BasicTestingSetup)
         }
     }
 
+    BOOST_AUTO_TEST_CASE(x16r_midstate_test)
+    {
+        BOOST_TEST_MESSAGE("Running X16R Midstate Test");
+
+        // Until every algorithm has been the first round at least once
+        bool fFirstAlgos[16] = {};
+        int nFirstAlgos = 0;
+        while (nFirstAlgos < 16) {
+            CBlockHeader header;
+            header.nVersion = InsecureRand32();
+            header.hashPrevBlock = InsecureRand256();
+            header.hashMerkleRoot = InsecureRand256();
+            header.nTime = InsecureRand32();
+            header.nBits = InsecureRand32();
+            header.nNonce = InsecureRand32();
+
+            int nFirstAlgo = GetHashSelection(header.hashPrevBlock, 0);
+            if (!fFirstAlgos[nFirstAlgo]) {
+                fFirstAlgos[nFirstAlgo] = true;
+                nFirstAlgos++;
+            }
+
+            CX16RMidstate midstate = header.GetX16RMidstate();
+            BOOST_CHECK(header.GetHash(midstate) == header.GetHash());
+
+            // The midstate stays valid while the last 16 bytes change
+            header.nNonce++;
+            header.nTime++;
+            header.nBits = InsecureRand32();
+            *(header.hashMerkleRoot.end() - 1) ^= 1;
+            BOOST_CHECK(header.GetHash(midstate) == header.GetHash());
+        }
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,222 @@
+// Copyright (c) 2018 The Raven Core developers
+// Distributed under the MIT software license, see the accompanying
+// file COPYING or http://www.opensource.org/licenses/mit-license.php.
+
+#include "txdb.h"
+#include "uint256.h"
+#include "random.h"
+#include "test/test_raven.h"
+
+#include <boost/test/unit_test.hpp>
+
+BOOST_FIXTURE_TEST_SUITE(indexdb_tests, BasicTestingSetup)
+
+    BOOST_AUTO_TEST_CASE(indexdb_migrate_test)
+    {
+        BOOST_TEST_MESSAGE("Running IndexDB Migrate Test");
+
+        CBlockTreeDB blocktree(1 << 20, true);
+        CIndexDB indexdb(1 << 20, true);
+
+        uint160 hashBytes = uint160(std::vector<unsigned char>(20, 0x42));
+        uint256 txid = InsecureRand256();
+        uint256 hashBestBlock = InsecureRand256();
+
+        // Entries as written to blocks/index by older versions
+        CAddressIndexKey addressKey(1, hashBytes, 100, 1, txid, 0, false);
+        CAddressUnspentKey unspentKey(1, hashBytes, txid, 0);
+        CAddressUnspentValue unspentValue(5000, CScript() << OP_TRUE, 100);
+        CSpentIndexKey spentKey(txid, 0);
+        CSpentIndexValue spentValue(InsecureRand256(), 0, 101, 5000, 1, hashBytes);
+        BOOST_CHECK(blocktree.Write(std::make_pair('a', addressKey), (CAmount)5000));
+        BOOST_CHECK(blocktree.Write(std::make_pair('u', unspentKey), unspentValue));
+        BOOST_CHECK(blocktree.Write(std::make_pair('p', spentKey), spentValue));
+        BOOST_CHECK(blocktree.Write(std::make_pair('s', CTimestampIndexKey(1234, hashBestBlock)), 0));
+        BOOST_CHECK(blocktree.Write(std::make_pair('z', CTimestampBlockIndexKey(hashBestBlock)), CTimestampBlockIndexValue(1234)));
+        BOOST_CHECK(blocktree.Write('I', hashBestBlock));
+        // Unrelated block tree data stays where it is
+        BOOST_CHECK(blocktree.WriteReindexing(true));
+
+        BOOST_CHECK(indexdb.MigrateFromBlockTree(blocktree));
+        BOOST_CHECK(indexdb.UpgradeAddressIndex());
+
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, addressIndex));
+        BOOST_CHECK_EQUAL(addressIndex.size(), 1);
+        BOOST_CHECK(addressIndex[0].first.txhash == txid);
+        BOOST_CHECK_EQUAL(addressIndex[0].second, 5000);
+
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+        BOOST_CHECK(indexdb.ReadAddressUnspentIndex(hashBytes, 1, RVN, unspentOutputs));
+        BOOST_CHECK_EQUAL(unspentOutputs.size(), 1);
+        BOOST_CHECK_EQUAL(unspentOutputs[0].second.satoshis, 5000);
+
+        CSpentIndexValue spentRead;
+        BOOST_CHECK(indexdb.ReadSpentIndex(spentKey, spentRead));
+        BOOST_CHECK(spentRead.txid == spentValue.txid);
+
+        unsigned int logicalTS = 0;
+        BOOST_CHECK(indexdb.ReadTimestampBlockIndex(hashBestBlock, logicalTS));
+        BOOST_CHECK_EQUAL(logicalTS, 1234);
+
+        uint256 hashRead;
+        BOOST_CHECK(indexdb.ReadIndexBestBlock(hashRead));
+        BOOST_CHECK(hashRead == hashBestBlock);
+
+        BOOST_CHECK(!blocktree.Exists(std::make_pair('a', addressKey)));
+        BOOST_CHECK(!blocktree.Exists(std::make_pair('u', unspentKey)));
+        BOOST_CHECK(!blocktree.Exists(std::make_pair('p', spentKey)));
+        BOOST_CHECK(!blocktree.Exists('I'));
+        bool fReindexing = false;
+        BOOST_CHECK(blocktree.ReadReindexing(fReindexing));
+        BOOST_CHECK(fReindexing);
+
+        // Nothing left to move
+        BOOST_CHECK(indexdb.MigrateFromBlockTree(blocktree));
+        BOOST_CHECK(indexdb.ReadIndexBestBlock(hashRead));
+        BOOST_CHECK(hashRead == hashBestBlock);
+    }
+
+    BOOST_AUTO_TEST_CASE(indexdb_address_height_range_test)
+    {
+        BOOST_TEST_MESSAGE("Running IndexDB Address Height Range Test");
+
+        CIndexDB indexdb(1 << 20, true);
+
+        uint160 hashBytes = uint160(std::vector<unsigned char>(20, 0x42));
+        uint160 otherHashBytes = uint160(std::vector<unsigned char>(20, 0x43));
+
+        std::vector<std::pair<CAddressIndexKey, CAmount> > vEntries;
+        for (int nHeight = 1; nHeight <= 10; nHeight++) {
+            vEntries.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, "RVN", nHeight, 1, InsecureRand256(), 0, false), (CAmount)nHeight));
+            vEntries.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, "ASSET_A", nHeight, 2, InsecureRand256(), 1, false), (CAmount)nHeight));
+            vEntries.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, "ASSET_B", nHeight, 3, InsecureRand256(), 1, true), -(CAmount)nHeight));
+            vEntries.push_back(std::make_pair(CAddressIndexKey(1, otherHashBytes, "RVN", nHeight, 1, InsecureRand256(), 0, false), (CAmount)nHeight));
+        }
+        BOOST_CHECK(indexdb.WriteAddressIndex(vEntries));
+
+        // All assets of the range, in height order
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, addressIndex, 4, 6));
+        BOOST_CHECK_EQUAL(addressIndex.size(), 9);
+        for (size_t i = 0; i < addressIndex.size(); i++) {
+            BOOST_CHECK(addressIndex[i].first.hashBytes == hashBytes);
+            BOOST_CHECK_EQUAL(addressIndex[i].first.blockHeight, 4 + (int)i / 3);
+        }
+        BOOST_CHECK_EQUAL(addressIndex[0].first.asset, "RVN");
+        BOOST_CHECK_EQUAL(addressIndex[1].first.asset, "ASSET_A");
+        BOOST_CHECK_EQUAL(addressIndex[2].first.asset, "ASSET_B");
+        BOOST_CHECK(addressIndex[2].first.spending);
+        BOOST_CHECK_EQUAL(addressIndex[2].second, -4);
+
+        // A single asset still reads from the asset ordered index
+        addressIndex.clear();
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, "ASSET_A", addressIndex, 4, 6));
+        BOOST_CHECK_EQUAL(addressIndex.size(), 3);
+
+        // Erasing removes the entries from both orderings
+        BOOST_CHECK(indexdb.EraseAddressIndex(vEntries));
+        addressIndex.clear();
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, addressIndex, 1, 10));
+        BOOST_CHECK(addressIndex.empty());
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, addressIndex));
+        BOOST_CHECK(addressIndex.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(indexdb_upgrade_address_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running IndexDB Upgrade Address Index Test");
+
+        CIndexDB indexdb(1 << 20, true);
+
+        uint160 hashBytes = uint160(std::vector<unsigned char>(20, 0x42));
+        uint256 txid = InsecureRand256();
+
+        // Entries with inline asset names, as written by older versions
+        CAddressIndexKey rvnKey(1, hashBytes, "RVN", 100, 1, txid, 0, false);
+        CAddressIndexKey assetKey(1, hashBytes, "ASSET_A", 101, 2, txid, 1, false);
+        CAddressUnspentKey unspentKey(1, hashBytes, "ASSET_A", txid, 1);
+        CAddressUnspentValue unspentValue(700, CScript() << OP_TRUE, 101);
+        BOOST_CHECK(indexdb.Write(std::make_pair('a', rvnKey), (CAmount)5000));
+        BOOST_CHECK(indexdb.Write(std::make_pair('a', assetKey), (CAmount)700));
+        BOOST_CHECK(indexdb.Write(std::make_pair('u', unspentKey), unspentValue));
+
+        BOOST_CHECK(indexdb.UpgradeAddressIndex());
+        BOOST_CHECK(!indexdb.Exists(std::make_pair('a', rvnKey)));
+        BOOST_CHECK(!indexdb.Exists(std::make_pair('a', assetKey)));
+        BOOST_CHECK(!indexdb.Exists(std::make_pair('u', unspentKey)));
+
+        std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, "ASSET_A", addressIndex));
+        BOOST_CHECK_EQUAL(addressIndex.size(), 1);
+        BOOST_CHECK_EQUAL(addressIndex[0].first.asset, "ASSET_A");
+        BOOST_CHECK_EQUAL(addressIndex[0].first.blockHeight, 101);
+        BOOST_CHECK_EQUAL(addressIndex[0].second, 700);
+
+        // The height ordered index is filled in as well
+        addressIndex.clear();
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, addressIndex, 100, 101));
+        BOOST_CHECK_EQUAL(addressIndex.size(), 2);
+        BOOST_CHECK_EQUAL(addressIndex[0].first.asset, "RVN");
+        BOOST_CHECK_EQUAL(addressIndex[1].first.asset, "ASSET_A");
+
+        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > unspentOutputs;
+        BOOST_CHECK(indexdb.ReadAddressUnspentIndex(hashBytes, 1, unspentOutputs));
+        BOOST_CHECK_EQUAL(unspentOutputs.size(), 1);
+        BOOST_CHECK_EQUAL(unspentOutputs[0].first.asset, "ASSET_A");
+        BOOST_CHECK_EQUAL(unspentOutputs[0].second.satoshis, 700);
+
+        // Unknown assets have no entries
+        addressIndex.clear();
+        BOOST_CHECK(indexdb.ReadAddressIndex(hashBytes, 1, "ASSET_B", addressIndex));
+        BOOST_CHECK(addressIndex.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(indexdb_timestamp_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running IndexDB Timestamp Index Test");
+
+        CIndexDB indexdb(1 << 20, true);
+
+        // Ten blocks an hour apart, the fourth one since disconnected
+        CIndexUpdate update;
+        std::vector<uint256> vHashes;
+        for (int i = 0; i < 10; i++) {
+            vHashes.push_back(InsecureRand256());
+            update.vTimestampIndex.push_back(std::make_pair(CTimestampIndexKey(7200 + i * 3600, vHashes.back()), CTimestampIndexValue(i != 3)));
+        }
+        BOOST_CHECK(indexdb.WriteIndexUpdate(update, vHashes.back()));
+        // An entry written by an older version, whose block is not in the block index
+        uint256 hashLegacy = InsecureRand256();
+        BOOST_CHECK(indexdb.Write(std::make_pair('s', CTimestampIndexKey(7200 + 10 * 3600, hashLegacy)), 0));
+
+        std::vector<std::pair<uint256, unsigned int> > hashes;
+        BOOST_CHECK(indexdb.ReadTimestampIndex(7200 + 11 * 3600, 0, false, hashes));
+        BOOST_CHECK_EQUAL(hashes.size(), 11);
+        BOOST_CHECK(hashes.back().first == hashLegacy);
+
+        hashes.clear();
+        BOOST_CHECK(indexdb.ReadTimestampIndex(7200 + 11 * 3600, 0, true, hashes));
+        BOOST_CHECK_EQUAL(hashes.size(), 9);
+        BOOST_CHECK(hashes[3].first == vHashes[4]);
+
+        // Offset and limit count the blocks passing the active chain filter
+        hashes.clear();
+        BOOST_CHECK(indexdb.ReadTimestampIndex(7200 + 11 * 3600, 0, true, hashes, 2, 3));
+        BOOST_CHECK_EQUAL(hashes.size(), 3);
+        BOOST_CHECK(hashes[0].first == vHashes[2]);
+        BOOST_CHECK(hashes[1].first == vHashes[4]);
+        BOOST_CHECK_EQUAL(hashes[2].second, 7200 + 5 * 3600);
+
+        // Two hour buckets
+        std::vector<std::pair<unsigned int, unsigned int> > buckets;
+        BOOST_CHECK(indexdb.ReadTimestampIndexSummary(7200 + 10 * 3600, 0, true, 7200, buckets));
+        BOOST_CHECK_EQUAL(buckets.size(), 5);
+        BOOST_CHECK_EQUAL(buckets[0].first, 7200);
+        BOOST_CHECK_EQUAL(buckets[0].second, 2);
+        BOOST_CHECK_EQUAL(buckets[1].first, 14400);
+        BOOST_CHECK_EQUAL(buckets[1].second, 1);
+        BOOST_CHECK(!indexdb.ReadTimestampIndexSummary(7200 + 10 * 3600, 0, true, 0, buckets));
+    }
+
+BOOST_AUTO_TEST_SUITE_END()
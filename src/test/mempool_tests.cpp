@@ -3,6 +3,7 @@
 // Distributed under the MIT software license, see the accompanying
 // file COPYING or http://www.opensource.org/licenses/mit-license.php.
 
+#include "assets/assets.h"
 #include "policy/policy.h"
 #include "txmempool.h"
 #include "util.h"
@@ -597,4 +598,240 @@ BOOST_FIXTURE_TEST_SUITE(mempool_tests, TestingSetup)
         SetMockTime(0);
     }
 
+    BOOST_AUTO_TEST_CASE(mempool_address_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Mempool Address Index Test");
+
+        CTxMemPool pool;
+        TestMemPoolEntryHelper entry;
+        CCoinsView viewDummy;
+        CCoinsViewCache view(&viewDummy);
+
+        uint160 hashA = uint160(std::vector<unsigned char>(20, 0x0a));
+        uint160 hashB = uint160(std::vector<unsigned char>(20, 0x0b));
+        CScript scriptA = CScript() << OP_DUP << OP_HASH160 << ToByteVector(hashA) << OP_EQUALVERIFY << OP_CHECKSIG;
+        CScript scriptB = CScript() << OP_DUP << OP_HASH160 << ToByteVector(hashB) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+        // tx1 pays from B to A, tx2 from A back to A
+        COutPoint prevout(InsecureRand256(), 0);
+        view.AddCoin(prevout, Coin(CTxOut(10000, scriptB), 1, false), false);
+        CMutableTransaction tx1;
+        tx1.vin.resize(1);
+        tx1.vin[0].prevout = prevout;
+        tx1.vout.resize(1);
+        tx1.vout[0] = CTxOut(9000, scriptA);
+        view.AddCoin(COutPoint(tx1.GetHash(), 0), Coin(tx1.vout[0], 1, false), false);
+        CMutableTransaction tx2;
+        tx2.vin.resize(1);
+        tx2.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+        tx2.vout.resize(1);
+        tx2.vout[0] = CTxOut(8000, scriptA);
+
+        pool.addAddressIndex(entry.FromTx(tx1), view);
+        pool.addAddressIndex(entry.FromTx(tx2), view);
+
+        std::vector<std::pair<uint160, int> > addresses;
+        addresses.push_back(std::make_pair(hashA, 1));
+        std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > results;
+        BOOST_CHECK(pool.getAddressIndex(addresses, results));
+        BOOST_CHECK_EQUAL(results.size(), 3);
+        CAmount nBalance = 0;
+        for (const auto& result : results)
+            nBalance += result.second.amount;
+        BOOST_CHECK_EQUAL(nBalance, 8000);
+
+        // Filtered on the asset, and on the address type
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addresses, "ASSET", results));
+        BOOST_CHECK(results.empty());
+        addresses[0].second = 2;
+        BOOST_CHECK(pool.getAddressIndex(addresses, results));
+        BOOST_CHECK(results.empty());
+
+        // Removing a transaction only removes its own deltas
+        addresses[0].second = 1;
+        pool.removeAddressIndex(tx1.GetHash());
+        BOOST_CHECK(pool.getAddressIndex(addresses, RVN, results));
+        BOOST_CHECK_EQUAL(results.size(), 2);
+        for (const auto& result : results)
+            BOOST_CHECK(result.first.txhash == tx2.GetHash());
+
+        // Removing moves the last deltas of an address into the freed slots, tx3's delta ends up
+        // where tx2's was and has to be found there when tx3 goes
+        COutPoint prevout3(InsecureRand256(), 0);
+        view.AddCoin(prevout3, Coin(CTxOut(10000, CScript() << OP_TRUE), 1, false), false);
+        CMutableTransaction tx3;
+        tx3.vin.resize(1);
+        tx3.vin[0].prevout = prevout3;
+        tx3.vout.resize(1);
+        tx3.vout[0] = CTxOut(7000, scriptA);
+        pool.addAddressIndex(entry.FromTx(tx3), view);
+
+        addresses.push_back(std::make_pair(hashB, 1));
+        pool.removeAddressIndex(tx2.GetHash());
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addresses, results));
+        BOOST_CHECK_EQUAL(results.size(), 1);
+        BOOST_CHECK(results[0].first.txhash == tx3.GetHash());
+        BOOST_CHECK_EQUAL(results[0].second.amount, 7000);
+
+        pool.removeAddressIndex(tx3.GetHash());
+        results.clear();
+        BOOST_CHECK(pool.getAddressIndex(addresses, results));
+        BOOST_CHECK(results.empty());
+    }
+
+    BOOST_AUTO_TEST_CASE(mempool_template_fees_test)
+    {
+        BOOST_TEST_MESSAGE("Running Mempool Template Fees Test");
+
+        CTxMemPool pool;
+        TestMemPoolEntryHelper entry;
+
+        std::vector<CMutableTransaction> txs(5);
+        for (size_t i = 0; i < txs.size(); i++) {
+            txs[i].vin.resize(1);
+            txs[i].vin[0].scriptSig = CScript() << (int64_t)i;
+            txs[i].vout.resize(1);
+            txs[i].vout[0].scriptPubKey = CScript() << OP_1 << OP_EQUAL;
+            txs[i].vout[0].nValue = 10 * COIN;
+        }
+
+        // Nothing is counted until a template is watched
+        pool.addUnchecked(txs[0].GetHash(), entry.Fee(100000LL).FromTx(txs[0]));
+        BOOST_CHECK(!pool.TemplateFeesImproved());
+
+        pool.WatchTemplateFees(CFeeRate(10000), 15000);
+        // Below the template fee rate
+        pool.addUnchecked(txs[1].GetHash(), entry.Fee(100LL).FromTx(txs[1]));
+        BOOST_CHECK(!pool.TemplateFeesImproved());
+        pool.addUnchecked(txs[2].GetHash(), entry.Fee(10000LL).FromTx(txs[2]));
+        BOOST_CHECK(!pool.TemplateFeesImproved());
+        BOOST_CHECK(!pool.TakeTemplateFeesNotify());
+        pool.addUnchecked(txs[3].GetHash(), entry.Fee(10000LL).FromTx(txs[3]));
+        BOOST_CHECK(pool.TemplateFeesImproved());
+
+        // Long-polls are woken once per crossing, more fees do not notify again
+        BOOST_CHECK(pool.TakeTemplateFeesNotify());
+        BOOST_CHECK(!pool.TakeTemplateFeesNotify());
+        pool.addUnchecked(txs[4].GetHash(), entry.Fee(100000LL).FromTx(txs[4]));
+        BOOST_CHECK(pool.TemplateFeesImproved());
+        BOOST_CHECK(!pool.TakeTemplateFeesNotify());
+
+        // A new template starts over, and a zero threshold stops watching
+        pool.WatchTemplateFees(CFeeRate(10000), 15000);
+        BOOST_CHECK(!pool.TemplateFeesImproved());
+        pool.WatchTemplateFees(CFeeRate(10000), 0);
+        BOOST_CHECK(!pool.TemplateFeesImproved());
+    }
+
+    BOOST_AUTO_TEST_CASE(mempool_asset_index_test)
+    {
+        BOOST_TEST_MESSAGE("Running Mempool Asset Index Test");
+
+        CTxMemPool pool;
+        TestMemPoolEntryHelper entry;
+        CScript scriptDest = CScript() << OP_DUP << OP_HASH160 << ToByteVector(uint160(std::vector<unsigned char>(20, 0x0a))) << OP_EQUALVERIFY << OP_CHECKSIG;
+
+        // tx1 issues NEWASSET, tx2 reissues REISSUED and tx3 spends tx1
+        CMutableTransaction tx1;
+        tx1.vin.resize(1);
+        tx1.vin[0].scriptSig = CScript() << OP_1;
+        tx1.vout.resize(1);
+        tx1.vout[0].scriptPubKey = scriptDest;
+        CNewAsset("NEWASSET", 1000 * COIN).ConstructTransaction(tx1.vout[0].scriptPubKey);
+        CMutableTransaction tx2;
+        tx2.vin.resize(1);
+        tx2.vin[0].scriptSig = CScript() << OP_2;
+        tx2.vout.resize(1);
+        tx2.vout[0].scriptPubKey = scriptDest;
+        CReissueAsset("REISSUED", 100 * COIN, 0, 1, "").ConstructTransaction(tx2.vout[0].scriptPubKey);
+        CMutableTransaction tx3;
+        tx3.vin.resize(1);
+        tx3.vin[0].prevout = COutPoint(tx1.GetHash(), 0);
+        tx3.vout.resize(1);
+        tx3.vout[0] = CTxOut(0, scriptDest);
+
+        pool.addUnchecked(tx1.GetHash(), entry.FromTx(tx1));
+        pool.addUnchecked(tx2.GetHash(), entry.FromTx(tx2));
+        pool.addUnchecked(tx3.GetHash(), entry.FromTx(tx3));
+
+        uint256 hash;
+        BOOST_CHECK(pool.existsAssetOp("NEWASSET", MemPoolAssetOp::NEW_ASSET, &hash));
+        BOOST_CHECK(hash == tx1.GetHash());
+        BOOST_CHECK(!pool.existsAssetOp("NEWASSET", MemPoolAssetOp::REISSUE));
+        BOOST_CHECK(pool.existsAssetOp("REISSUED", MemPoolAssetOp::REISSUE, &hash));
+        BOOST_CHECK(hash == tx2.GetHash());
+        BOOST_CHECK(pool.DynamicAssetUsage() > 0);
+
+        // A block issuing NEWASSET in another transaction evicts tx1 and its child
+        CMutableTransaction txBlock(tx1);
+        txBlock.vin[0].scriptSig = CScript() << OP_3;
+        std::vector<CTransactionRef> block;
+        block.push_back(MakeTransactionRef(txBlock));
+        pool.removeForBlock(block, 1);
+        BOOST_CHECK(!pool.exists(tx1.GetHash()));
+        BOOST_CHECK(!pool.exists(tx3.GetHash()));
+        BOOST_CHECK(!pool.existsAssetOp("NEWASSET", MemPoolAssetOp::NEW_ASSET));
+        BOOST_CHECK_EQUAL(pool.size(), 1);
+
+        // Removing tx2 releases its reissue
+        pool.removeRecursive(tx2);
+        BOOST_CHECK(!pool.existsAssetOp("REISSUED", MemPoolAssetOp::REISSUE));
+        BOOST_CHECK_EQUAL(pool.DynamicAssetUsage(), 0);
+    }
+
+    BOOST_AUTO_TEST_CASE(mempool_links_test)
+    {
+        BOOST_TEST_MESSAGE("Running Mempool Links Test");
+
+        CTxMemPool pool;
+        TestMemPoolEntryHelper entry;
+
+        CMutableTransaction txParent;
+        txParent.vin.resize(1);
+        txParent.vin[0].scriptSig = CScript() << OP_11;
+        txParent.vout.resize(3);
+        for (int i = 0; i < 3; i++) {
+            txParent.vout[i].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+            txParent.vout[i].nValue = 33000LL;
+        }
+        pool.addUnchecked(txParent.GetHash(), entry.FromTx(txParent));
+        size_t nParentUsage = pool.DynamicMemoryUsage();
+
+        // More children than the links store inline
+        std::vector<CMutableTransaction> txChildren(3);
+        for (int i = 0; i < 3; i++) {
+            txChildren[i].vin.resize(1);
+            txChildren[i].vin[0].prevout = COutPoint(txParent.GetHash(), i);
+            txChildren[i].vout.resize(1);
+            txChildren[i].vout[0].scriptPubKey = CScript() << OP_11 << OP_EQUAL;
+            txChildren[i].vout[0].nValue = 11000LL;
+            pool.addUnchecked(txChildren[i].GetHash(), entry.FromTx(txChildren[i]));
+        }
+        BOOST_CHECK(pool.DynamicMemoryUsage() > nParentUsage);
+
+        CTxMemPool::txiter parentIt = pool.mapTx.find(txParent.GetHash());
+        const CTxMemPool::linkEntries& children = pool.GetMemPoolChildren(parentIt);
+        BOOST_CHECK_EQUAL(children.size(), 3);
+        for (size_t i = 1; i < children.size(); i++)
+            BOOST_CHECK(children[i - 1]->GetTx().GetHash() < children[i]->GetTx().GetHash());
+        for (const auto& txChild : txChildren) {
+            const CTxMemPool::linkEntries& parents = pool.GetMemPoolParents(pool.mapTx.find(txChild.GetHash()));
+            BOOST_CHECK_EQUAL(parents.size(), 1);
+            BOOST_CHECK(parents[0] == parentIt);
+        }
+
+        // Removing a child unlinks it from the parent
+        size_t nUsage = pool.DynamicMemoryUsage();
+        pool.removeRecursive(txChildren[1]);
+        BOOST_CHECK(pool.DynamicMemoryUsage() < nUsage);
+        BOOST_CHECK_EQUAL(pool.GetMemPoolChildren(parentIt).size(), 2);
+        for (const CTxMemPool::txiter& child : pool.GetMemPoolChildren(parentIt))
+            BOOST_CHECK(child->GetTx().GetHash() != txChildren[1].GetHash());
+
+        pool.removeRecursive(txParent);
+        BOOST_CHECK_EQUAL(pool.size(), 0);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -281,6 +281,68 @@ BOOST_FIXTURE_TEST_SUITE(miner_tests, TestingSetup)
         BOOST_CHECK(pblocktemplate->block.vtx[8]->GetHash() == hashLowFeeTx2);
     }
 
+    // Test updating a template for mempool changes on the same tip, reusing
+    // the blockchain created in CreateNewBlock_validity.
+    void TestTemplateUpdate(const CChainParams &chainparams, CScript scriptPubKey, std::vector<CTransactionRef> &txFirst)
+    {
+        TestMemPoolEntryHelper entry;
+
+        // A low fee parent with a high fee child
+        CMutableTransaction tx;
+        tx.vin.resize(1);
+        tx.vin[0].scriptSig = CScript() << OP_1;
+        tx.vin[0].prevout.hash = txFirst[0]->GetHash();
+        tx.vin[0].prevout.n = 0;
+        tx.vout.resize(1);
+        tx.vout[0].nValue = 5000000000LL - 1000;
+        CTransaction parentTx(tx);
+        mempool.addUnchecked(parentTx.GetHash(), entry.Fee(1000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+
+        tx.vin[0].prevout.hash = parentTx.GetHash();
+        tx.vout[0].nValue = 5000000000LL - 1000 - 50000;
+        uint256 hashChildTx = tx.GetHash();
+        mempool.addUnchecked(hashChildTx, entry.Fee(50000).Time(GetTime()).SpendsCoinbase(false).FromTx(tx));
+
+        std::unique_ptr<CBlockTemplate> pblocktemplate = AssemblerForTest(chainparams).CreateNewBlock(scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 3);
+
+        // A new transaction is added after the kept ones
+        tx.vin[0].prevout.hash = txFirst[1]->GetHash();
+        tx.vout[0].nValue = 5000000000LL - 10000;
+        uint256 hashMediumFeeTx = tx.GetHash();
+        mempool.addUnchecked(hashMediumFeeTx, entry.Fee(10000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+
+        pblocktemplate = AssemblerForTest(chainparams).UpdateNewBlock(*pblocktemplate, scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 4);
+        BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == parentTx.GetHash());
+        BOOST_CHECK(pblocktemplate->block.vtx[2]->GetHash() == hashChildTx);
+        BOOST_CHECK(pblocktemplate->block.vtx[3]->GetHash() == hashMediumFeeTx);
+        BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[0], -61000);
+
+        // Transactions that left the mempool are dropped, with their descendants
+        mempool.removeRecursive(parentTx);
+        pblocktemplate = AssemblerForTest(chainparams).UpdateNewBlock(*pblocktemplate, scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+        BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashMediumFeeTx);
+        BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[0], -10000);
+
+        // In a block with room for one transaction, a better paying one displaces the kept one
+        BlockAssembler::Options options;
+        options.nBlockMaxWeight = 4000 + WITNESS_SCALE_FACTOR * ::GetSerializeSize(tx, SER_NETWORK, PROTOCOL_VERSION) * 3 / 2;
+        options.blockMinFeeRate = blockMinFeeRate;
+        tx.vin[0].prevout.hash = txFirst[2]->GetHash();
+        tx.vout[0].nValue = 5000000000LL - 100000;
+        uint256 hashHighFeeTx = tx.GetHash();
+        mempool.addUnchecked(hashHighFeeTx, entry.Fee(100000).Time(GetTime()).SpendsCoinbase(true).FromTx(tx));
+
+        pblocktemplate = BlockAssembler(chainparams, options).UpdateNewBlock(*pblocktemplate, scriptPubKey);
+        BOOST_CHECK_EQUAL(pblocktemplate->block.vtx.size(), 2);
+        BOOST_CHECK(pblocktemplate->block.vtx[1]->GetHash() == hashHighFeeTx);
+        BOOST_CHECK_EQUAL(pblocktemplate->vTxFees[0], -100000);
+
+        mempool.clear();
+    }
+
     // NOTE: These tests rely on CreateNewBlock doing its own self-validation!
     BOOST_AUTO_TEST_CASE(createnewblock_validity_test)
     {
@@ -654,6 +716,9 @@ BOOST_FIXTURE_TEST_SUITE(miner_tests, TestingSetup)
 
         TestPackageSelection(chainparams, scriptPubKey, txFirst);
 
+        mempool.clear();
+        TestTemplateUpdate(chainparams, scriptPubKey, txFirst);
+
         fCheckpointsEnabled = true;
     }
 
@@ -69,6 +69,40 @@ struct CTimestampIndexKey {
     }
 };
 
+/**
+ * Whether the block of a timestamp entry is in the active chain. Entries written by older
+ * versions have a 4 byte placeholder value instead, and are looked up in the block index.
+ */
+struct CTimestampIndexValue {
+    bool fActive;
+
+    size_t GetSerializeSize() const {
+        return 1;
+    }
+
+    template<typename Stream>
+    void Serialize(Stream& s) const {
+        ser_writedata8(s, fActive ? 1 : 0);
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream& s) {
+        fActive = ser_readdata8(s) != 0;
+    }
+
+    CTimestampIndexValue(bool active) {
+        fActive = active;
+    }
+
+    CTimestampIndexValue() {
+        SetNull();
+    }
+
+    void SetNull() {
+        fActive = false;
+    }
+};
+
 struct CTimestampBlockIndexKey {
     uint256 blockHash;
 
@@ -24,11 +24,18 @@ static const char DB_COIN = 'C';
 static const char DB_COINS = 'c';
 static const char DB_BLOCK_FILES = 'f';
 static const char DB_TXINDEX = 't';
-static const char DB_ADDRESSINDEX = 'a';
-static const char DB_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_ADDRESSINDEX = 'A';
+static const char DB_ADDRESSUNSPENTINDEX = 'U';
+static const char DB_ADDRESSHEIGHTINDEX = 'E';
+static const char DB_ASSET_ID = 'n';
+// Address index entries with inline asset names, as written by older versions
+static const char DB_LEGACY_ADDRESSINDEX = 'a';
+static const char DB_LEGACY_ADDRESSUNSPENTINDEX = 'u';
+static const char DB_LEGACY_ADDRESSHEIGHTINDEX = 'h';
 static const char DB_TIMESTAMPINDEX = 's';
 static const char DB_BLOCKHASHINDEX = 'z';
 static const char DB_SPENTINDEX = 'p';
+static const char DB_BLOCKFILTERINDEX = 'G';
 static const char DB_BLOCK_INDEX = 'b';
 
 static const char DB_BEST_BLOCK = 'B';
@@ -36,6 +43,7 @@ static const char DB_HEAD_BLOCKS = 'H';
 static const char DB_FLAG = 'F';
 static const char DB_REINDEX_FLAG = 'R';
 static const char DB_LAST_BLOCK = 'l';
+static const char DB_INDEX_BEST_BLOCK = 'I';
 
 namespace {
 
@@ -254,11 +262,137 @@ bool CBlockTreeDB::WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos>
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
+bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
+    return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
+}
+
+bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
+    char ch;
+    if (!Read(std::make_pair(DB_FLAG, name), ch))
+        return false;
+    fValue = ch == '1';
+    return true;
+}
+
+bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+{
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+
+    // Load mapBlockIndex
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, uint256> key;
+        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
+            CDiskBlockIndex diskindex;
+            if (pcursor->GetValue(diskindex)) {
+                // Construct block index object
+                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
+                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
+                pindexNew->nHeight        = diskindex.nHeight;
+                pindexNew->nFile          = diskindex.nFile;
+                pindexNew->nDataPos       = diskindex.nDataPos;
+                pindexNew->nUndoPos       = diskindex.nUndoPos;
+                pindexNew->nVersion       = diskindex.nVersion;
+                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
+                pindexNew->nTime          = diskindex.nTime;
+                pindexNew->nBits          = diskindex.nBits;
+                pindexNew->nNonce         = diskindex.nNonce;
+                pindexNew->nStatus        = diskindex.nStatus;
+                pindexNew->nTx            = diskindex.nTx;
+
+                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
+                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+
+                pcursor->Next();
+            } else {
+                return error("%s: failed to read value", __func__);
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+CIndexDB::CIndexDB(size_t nCacheSize, bool fMemory, bool fWipe, size_t maxFileSize) : CDBWrapper(GetDataDir() / "indexes", nCacheSize, fMemory, fWipe, false, maxFileSize), fAssetIdsLoaded(false) {
+}
+
+bool CIndexDB::LoadAssetIds() {
+    AssertLockHeld(cs_assetIds);
+    if (fAssetIdsLoaded)
+        return true;
+
+    mapAssetIds.clear();
+    vAssetNames.assign(1, RVN);
+    mapAssetIds[RVN] = 0;
+
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    pcursor->Seek(std::make_pair(DB_ASSET_ID, std::string()));
+    while (pcursor->Valid()) {
+        std::pair<char, std::string> key;
+        if (!pcursor->GetKey(key) || key.first != DB_ASSET_ID)
+            break;
+        uint32_t assetId;
+        if (!pcursor->GetValue(assetId) || assetId == 0)
+            return error("%s: cannot parse asset id of %s", __func__, key.second);
+        if (assetId >= vAssetNames.size())
+            vAssetNames.resize(assetId + 1);
+        vAssetNames[assetId] = key.second;
+        mapAssetIds[key.second] = assetId;
+        pcursor->Next();
+    }
+    fAssetIdsLoaded = true;
+    return true;
+}
+
+bool CIndexDB::LookupAssetId(const std::string &assetName, uint32_t &assetId) {
+    LOCK(cs_assetIds);
+    if (!LoadAssetIds())
+        return false;
+    std::map<std::string, uint32_t>::const_iterator it = mapAssetIds.find(assetName);
+    if (it == mapAssetIds.end())
+        return false;
+    assetId = it->second;
+    return true;
+}
+
+bool CIndexDB::LookupAssetName(uint32_t assetId, std::string &assetName) {
+    LOCK(cs_assetIds);
+    if (!LoadAssetIds())
+        return false;
+    if (assetId >= vAssetNames.size() || vAssetNames[assetId].empty())
+        return false;
+    assetName = vAssetNames[assetId];
+    return true;
+}
+
+bool CIndexDB::GetOrAssignAssetId(const std::string &assetName, uint32_t &assetId) {
+    LOCK(cs_assetIds);
+    if (!LoadAssetIds())
+        return false;
+    std::map<std::string, uint32_t>::const_iterator it = mapAssetIds.find(assetName);
+    if (it != mapAssetIds.end()) {
+        assetId = it->second;
+        return true;
+    }
+
+    // The id is on disk before any entry using it is written
+    assetId = vAssetNames.size();
+    if (!Write(std::make_pair(DB_ASSET_ID, assetName), assetId, true))
+        return error("%s: failed to write the id of asset %s", __func__, assetName);
+    vAssetNames.push_back(assetName);
+    mapAssetIds[assetName] = assetId;
+    return true;
+}
+
+bool CIndexDB::ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value) {
     return Read(std::make_pair(DB_SPENTINDEX, key), value);
 }
 
-bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
+bool CIndexDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CSpentIndexKey,CSpentIndexValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
         if (it->second.IsNull()) {
@@ -270,61 +404,84 @@ bool CBlockTreeDB::UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey,
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
+bool CIndexDB::UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect) {
     CDBBatch batch(*this);
     for (std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        uint32_t assetId;
         if (it->second.IsNull()) {
-            batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first));
+            if (LookupAssetId(it->first.asset, assetId))
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, CCompactAddressUnspentKey(it->first, assetId)));
         } else {
-            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, it->first), it->second);
+            if (!GetOrAssignAssetId(it->first.asset, assetId))
+                return false;
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CCompactAddressUnspentKey(it->first, assetId)), it->second);
         }
     }
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
+bool CIndexDB::ReadAddressUnspentIndex(uint160 addressHash, int type, std::string assetName,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
-    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+    return ReadAddressUnspentIndexPage(addressHash, type, assetName, nullptr, 0, unspentOutputs);
+}
 
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+bool CIndexDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
+                                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
-    while (pcursor->Valid()) {
-        boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
-            CAddressUnspentValue nValue;
-            if (pcursor->GetValue(nValue)) {
-                unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                pcursor->Next();
-            } else {
-                return error("failed to get address unspent value");
-            }
-        } else {
-            break;
-        }
-    }
+    return ReadAddressUnspentIndexPage(addressHash, type, "", nullptr, 0, unspentOutputs);
+}
 
-    return true;
+/** Position the cursor on the first key following keyAfter */
+template <typename K>
+static void SeekAfter(CDBIterator &cursor, const std::pair<char, K> &keyAfter)
+{
+    cursor.Seek(keyAfter);
+    std::pair<char, K> key;
+    if (!cursor.Valid() || !cursor.GetKey(key))
+        return;
+    CDataStream ssKey(SER_DISK, CLIENT_VERSION), ssKeyAfter(SER_DISK, CLIENT_VERSION);
+    ssKey << key;
+    ssKeyAfter << keyAfter;
+    if (ssKey.str() == ssKeyAfter.str())
+        cursor.Next();
 }
 
-bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
+bool CIndexDB::ReadAddressUnspentIndexPage(uint160 addressHash, int type, std::string assetName,
+                                           const CAddressUnspentKey *pkeyAfter, size_t nLimit,
                                            std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs) {
 
+    uint32_t assetId = 0;
+    if (!assetName.empty() && !LookupAssetId(assetName, assetId))
+        return true;
+
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
-    pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorKey(type, addressHash)));
+    if (pkeyAfter) {
+        uint32_t assetIdAfter;
+        if (!LookupAssetId(pkeyAfter->asset, assetIdAfter))
+            return error("%s: unknown asset %s", __func__, pkeyAfter->asset);
+        SeekAfter(*pcursor, std::make_pair(DB_ADDRESSUNSPENTINDEX, CCompactAddressUnspentKey(*pkeyAfter, assetIdAfter)));
+    } else if (!assetName.empty()) {
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetId)));
+    } else {
+        // RVN has id 0, so the assets of the address start right after its RVN outputs
+        pcursor->Seek(std::make_pair(DB_ADDRESSUNSPENTINDEX, CAddressIndexIteratorAssetKey(type, addressHash, 1)));
+    }
 
-    while (pcursor->Valid()) {
+    size_t nRead = 0;
+    while (pcursor->Valid() && (nLimit == 0 || nRead < nLimit)) {
         boost::this_thread::interruption_point();
-        std::pair<char,CAddressUnspentKey> key;
-        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash) {
+        std::pair<char,CCompactAddressUnspentKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSUNSPENTINDEX && key.second.hashBytes == addressHash
+                && (assetName.empty() ? key.second.assetId != 0 : key.second.assetId == assetId)) {
+            std::string entryAssetName = assetName;
+            if (entryAssetName.empty() && !LookupAssetName(key.second.assetId, entryAssetName))
+                return error("%s: unknown asset id %u", __func__, key.second.assetId);
             CAddressUnspentValue nValue;
             if (pcursor->GetValue(nValue)) {
-                if (key.second.asset != "RVN") {
-                    unspentOutputs.push_back(std::make_pair(key.second, nValue));
-                }
+                unspentOutputs.push_back(std::make_pair(key.second.ToAddressUnspentKey(entryAssetName), nValue));
+                nRead++;
                 pcursor->Next();
             } else {
                 return error("failed to get address unspent value");
@@ -337,46 +494,88 @@ bool CBlockTreeDB::ReadAddressUnspentIndex(uint160 addressHash, int type,
     return true;
 }
 
-bool CBlockTreeDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CIndexDB::WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Write(std::make_pair(DB_ADDRESSINDEX, it->first), it->second);
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        uint32_t assetId;
+        if (!GetOrAssignAssetId(it->first.asset, assetId))
+            return false;
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, CCompactAddressIndexKey(it->first, assetId)), it->second);
+        batch.Write(std::make_pair(DB_ADDRESSHEIGHTINDEX, CCompactAddressHeightIndexKey(it->first, assetId)), it->second);
+    }
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
+bool CIndexDB::EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount > >&vect) {
     CDBBatch batch(*this);
-    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++)
-        batch.Erase(std::make_pair(DB_ADDRESSINDEX, it->first));
+    for (std::vector<std::pair<CAddressIndexKey, CAmount> >::const_iterator it=vect.begin(); it!=vect.end(); it++) {
+        uint32_t assetId;
+        if (!LookupAssetId(it->first.asset, assetId))
+            continue;
+        batch.Erase(std::make_pair(DB_ADDRESSINDEX, CCompactAddressIndexKey(it->first, assetId)));
+        batch.Erase(std::make_pair(DB_ADDRESSHEIGHTINDEX, CCompactAddressHeightIndexKey(it->first, assetId)));
+    }
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
+bool CIndexDB::ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
                                     std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                                     int start, int end) {
 
+    return ReadAddressIndexPage(addressHash, type, assetName, start, end, nullptr, 0, addressIndex);
+}
+
+bool CIndexDB::ReadAddressIndex(uint160 addressHash, int type,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                    int start, int end) {
+
+    return ReadAddressIndex(addressHash, type, "", addressIndex, start, end);
+}
+
+bool CIndexDB::ReadAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                                    const CAddressIndexKey *pkeyAfter, size_t nLimit,
+                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex) {
+
+    // A block range across all assets is read in height order from its own index
+    if (assetName.empty() && end > 0)
+        return ReadAddressHeightIndex(addressHash, type, addressIndex, start, end, pkeyAfter, nLimit);
+
+    uint32_t assetId = 0;
+    if (!assetName.empty() && !LookupAssetId(assetName, assetId))
+        return true;
+
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
-    if (!assetName.empty() && start > 0 && end > 0) {
+    if (pkeyAfter) {
+        uint32_t assetIdAfter;
+        if (!LookupAssetId(pkeyAfter->asset, assetIdAfter))
+            return error("%s: unknown asset %s", __func__, pkeyAfter->asset);
+        SeekAfter(*pcursor, std::make_pair(DB_ADDRESSINDEX, CCompactAddressIndexKey(*pkeyAfter, assetIdAfter)));
+    } else if (!assetName.empty() && start > 0 && end > 0) {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX,
-                                     CAddressIndexIteratorHeightKey(type, addressHash, assetName, start)));
+                                     CAddressIndexIteratorHeightKey(type, addressHash, assetId, start)));
     } else if (!assetName.empty()) {
-        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetName)));
+        pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorAssetKey(type, addressHash, assetId)));
     } else {
         pcursor->Seek(std::make_pair(DB_ADDRESSINDEX, CAddressIndexIteratorKey(type, addressHash)));
     }
 
-    while (pcursor->Valid()) {
+    size_t nRead = 0;
+    while (pcursor->Valid() && (nLimit == 0 || nRead < nLimit)) {
         boost::this_thread::interruption_point();
-        std::pair<char,CAddressIndexKey> key;
+        std::pair<char,CCompactAddressIndexKey> key;
         if (pcursor->GetKey(key) && key.first == DB_ADDRESSINDEX && key.second.hashBytes == addressHash
-                && (assetName.empty() || key.second.asset == assetName)) {
+                && (assetName.empty() || key.second.assetId == assetId)) {
             if (end > 0 && key.second.blockHeight > end) {
                 break;
             }
+            std::string entryAssetName = assetName;
+            if (entryAssetName.empty() && !LookupAssetName(key.second.assetId, entryAssetName))
+                return error("%s: unknown asset id %u", __func__, key.second.assetId);
             CAmount nValue;
             if (pcursor->GetValue(nValue)) {
-                addressIndex.push_back(std::make_pair(key.second, nValue));
+                addressIndex.push_back(std::make_pair(key.second.ToAddressIndexKey(entryAssetName), nValue));
+                nRead++;
                 pcursor->Next();
             } else {
                 return error("failed to get address index value");
@@ -389,35 +588,82 @@ bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type, std::string a
     return true;
 }
 
-bool CBlockTreeDB::ReadAddressIndex(uint160 addressHash, int type,
-                                    std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
-                                    int start, int end) {
+bool CIndexDB::ReadAddressHeightIndex(uint160 addressHash, int type,
+                                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                      int start, int end, const CAddressIndexKey *pkeyAfter, size_t nLimit) {
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
-    return CBlockTreeDB::ReadAddressIndex(addressHash, type, "", addressIndex, start, end);
+    if (pkeyAfter) {
+        uint32_t assetIdAfter;
+        if (!LookupAssetId(pkeyAfter->asset, assetIdAfter))
+            return error("%s: unknown asset %s", __func__, pkeyAfter->asset);
+        SeekAfter(*pcursor, std::make_pair(DB_ADDRESSHEIGHTINDEX, CCompactAddressHeightIndexKey(*pkeyAfter, assetIdAfter)));
+    } else {
+        pcursor->Seek(std::make_pair(DB_ADDRESSHEIGHTINDEX, CAddressHeightIndexIteratorKey(type, addressHash, start)));
+    }
+
+    size_t nRead = 0;
+    while (pcursor->Valid() && (nLimit == 0 || nRead < nLimit)) {
+        boost::this_thread::interruption_point();
+        std::pair<char,CCompactAddressHeightIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_ADDRESSHEIGHTINDEX && key.second.type == (unsigned int)type
+                && key.second.hashBytes == addressHash && key.second.blockHeight <= end) {
+            std::string assetName;
+            if (!LookupAssetName(key.second.assetId, assetName))
+                return error("%s: unknown asset id %u", __func__, key.second.assetId);
+            CAmount nValue;
+            if (pcursor->GetValue(nValue)) {
+                addressIndex.push_back(std::make_pair(key.second.ToAddressIndexKey(assetName), nValue));
+                nRead++;
+                pcursor->Next();
+            } else {
+                return error("failed to get address height index value");
+            }
+        } else {
+            break;
+        }
+    }
+
+    return true;
 }
 
-bool CBlockTreeDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
+bool CIndexDB::WriteTimestampIndex(const CTimestampIndexKey &timestampIndex) {
     CDBBatch batch(*this);
-    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), 0);
+    batch.Write(std::make_pair(DB_TIMESTAMPINDEX, timestampIndex), CTimestampIndexValue(true));
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes) {
+/** Whether the block of the timestamp entry at the cursor is in the active chain */
+static bool IsTimestampEntryActive(CDBIterator &cursor, const CTimestampIndexKey &key) {
+    CTimestampIndexValue value;
+    if (cursor.GetValueSize() == value.GetSerializeSize() && cursor.GetValue(value))
+        return value.fActive;
+
+    // Written by an older version
+    LOCK(cs_main);
+    return HashOnchainActive(key.blockHash);
+}
+
+bool CIndexDB::ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes,
+                                  size_t nOffset, size_t nLimit) {
 
     boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
 
     pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
 
-    while (pcursor->Valid()) {
+    size_t nRead = 0;
+    while (pcursor->Valid() && (nLimit == 0 || nRead < nLimit)) {
         boost::this_thread::interruption_point();
         std::pair<char, CTimestampIndexKey> key;
         if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
-            if (fActiveOnly) {
-                if (HashOnchainActive(key.second.blockHash)) {
+            if (!fActiveOnly || IsTimestampEntryActive(*pcursor, key.second)) {
+                if (nOffset > 0) {
+                    nOffset--;
+                } else {
                     hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
+                    nRead++;
                 }
-            } else {
-                hashes.push_back(std::make_pair(key.second.blockHash, key.second.timestamp));
             }
 
             pcursor->Next();
@@ -429,13 +675,43 @@ bool CBlockTreeDB::ReadTimestampIndex(const unsigned int &high, const unsigned i
     return true;
 }
 
-bool CBlockTreeDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
+bool CIndexDB::ReadTimestampIndexSummary(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, unsigned int nBucketSize,
+                                         std::vector<std::pair<unsigned int, unsigned int> > &buckets) {
+
+    if (nBucketSize == 0)
+        return error("%s: empty bucket size", __func__);
+
+    boost::scoped_ptr<CDBIterator> pcursor(NewIterator());
+
+    pcursor->Seek(std::make_pair(DB_TIMESTAMPINDEX, CTimestampIndexIteratorKey(low)));
+
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        std::pair<char, CTimestampIndexKey> key;
+        if (pcursor->GetKey(key) && key.first == DB_TIMESTAMPINDEX && key.second.timestamp < high) {
+            if (!fActiveOnly || IsTimestampEntryActive(*pcursor, key.second)) {
+                unsigned int nBucket = key.second.timestamp - key.second.timestamp % nBucketSize;
+                if (buckets.empty() || buckets.back().first != nBucket)
+                    buckets.push_back(std::make_pair(nBucket, 0));
+                buckets.back().second++;
+            }
+
+            pcursor->Next();
+        } else {
+            break;
+        }
+    }
+
+    return true;
+}
+
+bool CIndexDB::WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts) {
     CDBBatch batch(*this);
     batch.Write(std::make_pair(DB_BLOCKHASHINDEX, blockhashIndex), logicalts);
     return WriteBatch(batch);
 }
 
-bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
+bool CIndexDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &ltimestamp) {
 
     CTimestampBlockIndexValue(lts);
     if (!Read(std::make_pair(DB_BLOCKHASHINDEX, hash), lts))
@@ -445,11 +721,65 @@ bool CBlockTreeDB::ReadTimestampBlockIndex(const uint256 &hash, unsigned int &lt
     return true;
 }
 
-bool CBlockTreeDB::WriteFlag(const std::string &name, bool fValue) {
+bool CIndexDB::ReadBlockFilter(const uint256 &hash, CBlockFilterIndexValue &value) {
+    return Read(std::make_pair(DB_BLOCKFILTERINDEX, hash), value);
+}
+
+bool CIndexDB::WriteIndexUpdate(const CIndexUpdate &update, const uint256 &hashIndexBestBlock) {
+    CDBBatch batch(*this);
+    uint32_t assetId;
+    for (const auto& entry : update.vAddressIndex) {
+        if (update.fEraseAddressIndex) {
+            if (!LookupAssetId(entry.first.asset, assetId))
+                continue;
+            batch.Erase(std::make_pair(DB_ADDRESSINDEX, CCompactAddressIndexKey(entry.first, assetId)));
+            batch.Erase(std::make_pair(DB_ADDRESSHEIGHTINDEX, CCompactAddressHeightIndexKey(entry.first, assetId)));
+        } else {
+            if (!GetOrAssignAssetId(entry.first.asset, assetId))
+                return false;
+            batch.Write(std::make_pair(DB_ADDRESSINDEX, CCompactAddressIndexKey(entry.first, assetId)), entry.second);
+            batch.Write(std::make_pair(DB_ADDRESSHEIGHTINDEX, CCompactAddressHeightIndexKey(entry.first, assetId)), entry.second);
+        }
+    }
+    for (const auto& entry : update.vAddressUnspentIndex) {
+        if (entry.second.IsNull()) {
+            if (LookupAssetId(entry.first.asset, assetId))
+                batch.Erase(std::make_pair(DB_ADDRESSUNSPENTINDEX, CCompactAddressUnspentKey(entry.first, assetId)));
+        } else {
+            if (!GetOrAssignAssetId(entry.first.asset, assetId))
+                return false;
+            batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CCompactAddressUnspentKey(entry.first, assetId)), entry.second);
+        }
+    }
+    for (const auto& entry : update.vSpentIndex) {
+        if (entry.second.IsNull())
+            batch.Erase(std::make_pair(DB_SPENTINDEX, entry.first));
+        else
+            batch.Write(std::make_pair(DB_SPENTINDEX, entry.first), entry.second);
+    }
+    for (const auto& entry : update.vTimestampIndex) {
+        batch.Write(std::make_pair(DB_TIMESTAMPINDEX, entry.first), entry.second);
+        batch.Write(std::make_pair(DB_BLOCKHASHINDEX, CTimestampBlockIndexKey(entry.first.blockHash)), CTimestampBlockIndexValue(entry.first.timestamp));
+    }
+    for (const auto& entry : update.vBlockFilterIndex)
+        batch.Write(std::make_pair(DB_BLOCKFILTERINDEX, entry.first), entry.second);
+    batch.Write(DB_INDEX_BEST_BLOCK, hashIndexBestBlock);
+    return WriteBatch(batch);
+}
+
+bool CIndexDB::ReadIndexBestBlock(uint256 &hashIndexBestBlock) {
+    return Read(DB_INDEX_BEST_BLOCK, hashIndexBestBlock);
+}
+
+bool CIndexDB::WriteIndexBestBlock(const uint256 &hashIndexBestBlock) {
+    return Write(DB_INDEX_BEST_BLOCK, hashIndexBestBlock, true);
+}
+
+bool CIndexDB::WriteFlag(const std::string &name, bool fValue) {
     return Write(std::make_pair(DB_FLAG, name), fValue ? '1' : '0');
 }
 
-bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
+bool CIndexDB::ReadFlag(const std::string &name, bool &fValue) {
     char ch;
     if (!Read(std::make_pair(DB_FLAG, name), ch))
         return false;
@@ -457,49 +787,173 @@ bool CBlockTreeDB::ReadFlag(const std::string &name, bool &fValue) {
     return true;
 }
 
-bool CBlockTreeDB::LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex)
+/** Move all entries of one index from the block tree database to the index database */
+template <typename K, typename V>
+static bool MoveIndexEntries(CBlockTreeDB &blocktree, CIndexDB &indexdb, char prefix, int64_t &nMoved)
 {
-    std::unique_ptr<CDBIterator> pcursor(NewIterator());
-
-    pcursor->Seek(std::make_pair(DB_BLOCK_INDEX, uint256()));
+    std::unique_ptr<CDBIterator> pcursor(blocktree.NewIterator());
+    pcursor->Seek(prefix);
 
-    // Load mapBlockIndex
+    CDBBatch batchWrite(indexdb);
+    CDBBatch batchErase(blocktree);
+    std::pair<char, K> key;
     while (pcursor->Valid()) {
         boost::this_thread::interruption_point();
-        std::pair<char, uint256> key;
-        if (pcursor->GetKey(key) && key.first == DB_BLOCK_INDEX) {
-            CDiskBlockIndex diskindex;
-            if (pcursor->GetValue(diskindex)) {
-                // Construct block index object
-                CBlockIndex* pindexNew = insertBlockIndex(diskindex.GetBlockHash());
-                pindexNew->pprev          = insertBlockIndex(diskindex.hashPrev);
-                pindexNew->nHeight        = diskindex.nHeight;
-                pindexNew->nFile          = diskindex.nFile;
-                pindexNew->nDataPos       = diskindex.nDataPos;
-                pindexNew->nUndoPos       = diskindex.nUndoPos;
-                pindexNew->nVersion       = diskindex.nVersion;
-                pindexNew->hashMerkleRoot = diskindex.hashMerkleRoot;
-                pindexNew->nTime          = diskindex.nTime;
-                pindexNew->nBits          = diskindex.nBits;
-                pindexNew->nNonce         = diskindex.nNonce;
-                pindexNew->nStatus        = diskindex.nStatus;
-                pindexNew->nTx            = diskindex.nTx;
+        if (ShutdownRequested())
+            break;
+        if (!pcursor->GetKey(key) || key.first != prefix)
+            break;
+        V value;
+        if (!pcursor->GetValue(value))
+            return error("%s: cannot parse index record", __func__);
+        batchWrite.Write(key, value);
+        batchErase.Erase(key);
+        if (batchWrite.SizeEstimate() > (size_t)nDefaultDbBatchSize) {
+            // The copy must be on disk before the originals are erased
+            if (!indexdb.WriteBatch(batchWrite, true) || !blocktree.WriteBatch(batchErase))
+                return false;
+            batchWrite.Clear();
+            batchErase.Clear();
+        }
+        nMoved++;
+        pcursor->Next();
+    }
+    if (!indexdb.WriteBatch(batchWrite, true) || !blocktree.WriteBatch(batchErase))
+        return false;
+    blocktree.CompactRange(prefix, (char)(prefix + 1));
+    return true;
+}
 
-                if (!CheckProofOfWork(pindexNew->GetBlockHash(), pindexNew->nBits, consensusParams))
-                    return error("%s: CheckProofOfWork failed: %s", __func__, pindexNew->ToString());
+bool CIndexDB::MigrateFromBlockTree(CBlockTreeDB &blocktree) {
+    int64_t nMoved = 0;
+    bool fOk = MoveIndexEntries<CAddressIndexKey, CAmount>(blocktree, *this, DB_LEGACY_ADDRESSINDEX, nMoved) &&
+               MoveIndexEntries<CAddressUnspentKey, CAddressUnspentValue>(blocktree, *this, DB_LEGACY_ADDRESSUNSPENTINDEX, nMoved) &&
+               MoveIndexEntries<CSpentIndexKey, CSpentIndexValue>(blocktree, *this, DB_SPENTINDEX, nMoved) &&
+               MoveIndexEntries<CTimestampIndexKey, int>(blocktree, *this, DB_TIMESTAMPINDEX, nMoved) &&
+               MoveIndexEntries<CTimestampBlockIndexKey, CTimestampBlockIndexValue>(blocktree, *this, DB_BLOCKHASHINDEX, nMoved);
+    if (!fOk)
+        return error("%s: failed to move index entries", __func__);
+    if (nMoved > 0)
+        LogPrintf("Moved %d address, spent and timestamp index entries to indexes/ [%s].\n", nMoved, ShutdownRequested() ? "CANCELLED" : "DONE");
+    if (ShutdownRequested())
+        return false;
 
-                pcursor->Next();
-            } else {
-                return error("%s: failed to read value", __func__);
-            }
-        } else {
+    // Databases from before the indexes recorded their own flags only have them in the block tree
+    for (const char* pszIndex : {"addressindex", "spentindex", "timestampindex", "blockfilterindex"}) {
+        bool fValue;
+        if (!ReadFlag(pszIndex, fValue) && blocktree.ReadFlag(pszIndex, fValue) && !WriteFlag(pszIndex, fValue))
+            return error("%s: failed to copy the %s flag", __func__, pszIndex);
+    }
+
+    // The best block marker goes last, once all entries are in place
+    uint256 hashIndexBestBlock;
+    if (blocktree.Read(DB_INDEX_BEST_BLOCK, hashIndexBestBlock)) {
+        if (!Write(DB_INDEX_BEST_BLOCK, hashIndexBestBlock, true) || !blocktree.Erase(DB_INDEX_BEST_BLOCK))
+            return error("%s: failed to move the index best block", __func__);
+    }
+    return true;
+}
+
+/** The remainder of a database key, kept as raw bytes */
+struct CRawKeyData
+{
+    std::vector<char> data;
+
+    template<typename Stream>
+    void Serialize(Stream &s) const {
+        s.write(data.data(), data.size());
+    }
+
+    template<typename Stream>
+    void Unserialize(Stream &s) {
+        data.resize(s.size());
+        s.read(data.data(), data.size());
+    }
+};
+
+/** Rewrite all entries of one legacy index through convert, in batches that each erase the originals they replace */
+template <typename K, typename V, typename F>
+static bool UpgradeIndexEntries(CIndexDB &indexdb, char prefix, F convert, int64_t &nUpgraded)
+{
+    std::unique_ptr<CDBIterator> pcursor(indexdb.NewIterator());
+    pcursor->Seek(prefix);
+
+    CDBBatch batch(indexdb);
+    std::pair<char, K> key;
+    while (pcursor->Valid()) {
+        boost::this_thread::interruption_point();
+        if (ShutdownRequested())
             break;
+        if (!pcursor->GetKey(key) || key.first != prefix)
+            break;
+        V value;
+        if (!pcursor->GetValue(value))
+            return error("%s: cannot parse index record", __func__);
+        if (!convert(key.second, value, batch))
+            return false;
+        batch.Erase(key);
+        if (batch.SizeEstimate() > (size_t)nDefaultDbBatchSize) {
+            if (!indexdb.WriteBatch(batch))
+                return false;
+            batch.Clear();
         }
+        nUpgraded++;
+        pcursor->Next();
     }
-
+    if (!indexdb.WriteBatch(batch))
+        return false;
+    indexdb.CompactRange(prefix, (char)(prefix + 1));
     return true;
 }
 
+bool CIndexDB::UpgradeAddressIndex() {
+    std::unique_ptr<CDBIterator> pcursor(NewIterator());
+    bool fLegacy = false;
+    for (char prefix : {DB_LEGACY_ADDRESSINDEX, DB_LEGACY_ADDRESSUNSPENTINDEX, DB_LEGACY_ADDRESSHEIGHTINDEX}) {
+        pcursor->Seek(prefix);
+        char chKey;
+        if (pcursor->Valid() && pcursor->GetKey(chKey) && chKey == prefix)
+            fLegacy = true;
+    }
+    pcursor.reset();
+    if (!fLegacy)
+        return true;
+
+    LogPrintf("Upgrading address index database...\n");
+    uiInterface.ShowProgress(_("Upgrading address index database"), 0, false);
+    int64_t nUpgraded = 0;
+
+    // Each entry goes to both the asset and the height ordered index
+    auto convertAddressIndex = [this](const CAddressIndexKey& key, const CAmount& nValue, CDBBatch& batch) {
+        uint32_t assetId;
+        if (!GetOrAssignAssetId(key.asset, assetId))
+            return false;
+        batch.Write(std::make_pair(DB_ADDRESSINDEX, CCompactAddressIndexKey(key, assetId)), nValue);
+        batch.Write(std::make_pair(DB_ADDRESSHEIGHTINDEX, CCompactAddressHeightIndexKey(key, assetId)), nValue);
+        return true;
+    };
+    auto convertAddressUnspentIndex = [this](const CAddressUnspentKey& key, const CAddressUnspentValue& value, CDBBatch& batch) {
+        uint32_t assetId;
+        if (!GetOrAssignAssetId(key.asset, assetId))
+            return false;
+        batch.Write(std::make_pair(DB_ADDRESSUNSPENTINDEX, CCompactAddressUnspentKey(key, assetId)), value);
+        return true;
+    };
+    // The height ordered entries are recreated from the address index entries
+    auto dropEntry = [](const CRawKeyData& key, const CAmount& nValue, CDBBatch& batch) {
+        return true;
+    };
+
+    bool fOk = UpgradeIndexEntries<CAddressIndexKey, CAmount>(*this, DB_LEGACY_ADDRESSINDEX, convertAddressIndex, nUpgraded) &&
+               UpgradeIndexEntries<CAddressUnspentKey, CAddressUnspentValue>(*this, DB_LEGACY_ADDRESSUNSPENTINDEX, convertAddressUnspentIndex, nUpgraded) &&
+               UpgradeIndexEntries<CRawKeyData, CAmount>(*this, DB_LEGACY_ADDRESSHEIGHTINDEX, dropEntry, nUpgraded);
+    uiInterface.ShowProgress("", 100, false);
+    if (!fOk)
+        return error("%s: failed to upgrade address index entries", __func__);
+    LogPrintf("Upgraded %d address index entries [%s].\n", nUpgraded, ShutdownRequested() ? "CANCELLED" : "DONE");
+    return !ShutdownRequested();
+}
+
 namespace {
 
 //! Legacy class to deserialize pre-pertxout database entries without reindex.
@@ -11,7 +11,9 @@
 #include "dbwrapper.h"
 #include "chain.h"
 #include "addressindex.h"
+#include "blockfilter.h"
 #include "spentindex.h"
+#include "sync.h"
 #include "timestampindex.h"
 
 #include <map>
@@ -41,6 +43,10 @@ static const int64_t nMaxBlockDBCache = 2;
 static const int64_t nMaxBlockDBAndTxIndexCache = 1024;
 //! Max memory allocated to coin DB specific cache (MiB)
 static const int64_t nMaxCoinsDBCache = 8;
+//! -indexdbcache default, used when the address, spent or timestamp index is enabled (MiB)
+static const int64_t nDefaultIndexDBCache = 256;
+//! Memory allocated to the index DB cache when none of its indexes is enabled (MiB)
+static const int64_t nMinIndexDBCache = 2;
 
 struct CDiskTxPos : public CDiskBlockPos
 {
@@ -109,6 +115,25 @@ private:
     friend class CCoinsViewDB;
 };
 
+/**
+ * Changes a connected or disconnected block makes to the address, spent and
+ * timestamp indexes. Unspent and spent entries with a null value are erased.
+ */
+struct CIndexUpdate
+{
+    std::vector<std::pair<CAddressIndexKey, CAmount> > vAddressIndex;
+    //! Erase the vAddressIndex keys instead of writing them (disconnect)
+    bool fEraseAddressIndex;
+    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > vAddressUnspentIndex;
+    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > vSpentIndex;
+    //! Logical timestamp entries, also recorded per block hash, and whether their block is in the active chain
+    std::vector<std::pair<CTimestampIndexKey, CTimestampIndexValue> > vTimestampIndex;
+    //! Filter of a connected block by block hash, its header is filled in when written in chain order
+    std::vector<std::pair<uint256, CBlockFilterIndexValue> > vBlockFilterIndex;
+
+    CIndexUpdate() : fEraseAddressIndex(false) {}
+};
+
 /** Access to the block database (blocks/index/) */
 class CBlockTreeDB : public CDBWrapper
 {
@@ -125,6 +150,38 @@ public:
     bool ReadReindexing(bool &fReindexing);
     bool ReadTxIndex(const uint256 &txid, CDiskTxPos &pos);
     bool WriteTxIndex(const std::vector<std::pair<uint256, CDiskTxPos> > &vect);
+    bool WriteFlag(const std::string &name, bool fValue);
+    bool ReadFlag(const std::string &name, bool &fValue);
+    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+};
+
+/**
+ * Access to the optional address, spent, timestamp and block filter indexes (indexes/)
+ *
+ * Address index keys store assets by a numeric id instead of their name. The ids are
+ * assigned in order of first use, kept in this database and cached in memory.
+ */
+class CIndexDB : public CDBWrapper
+{
+private:
+    CCriticalSection cs_assetIds;
+    bool fAssetIdsLoaded;
+    std::map<std::string, uint32_t> mapAssetIds;
+    //! Asset names by id, starting with RVN
+    std::vector<std::string> vAssetNames;
+
+    bool LoadAssetIds();
+    bool LookupAssetId(const std::string &assetName, uint32_t &assetId);
+    bool LookupAssetName(uint32_t assetId, std::string &assetName);
+    //! Look up the id of an asset, assigning (and durably recording) a new one if it was never seen
+    bool GetOrAssignAssetId(const std::string &assetName, uint32_t &assetId);
+
+public:
+    explicit CIndexDB(size_t nCacheSize, bool fMemory = false, bool fWipe = false, size_t maxFileSize = 2 << 20);
+
+    CIndexDB(const CIndexDB&) = delete;
+    CIndexDB& operator=(const CIndexDB&) = delete;
+
     bool ReadSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
     bool UpdateSpentIndex(const std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> >&vect);
     bool UpdateAddressUnspentIndex(const std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue > >&vect);
@@ -132,6 +189,11 @@ public:
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
     bool ReadAddressUnspentIndex(uint160 addressHash, int type,
                                  std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
+    //! Read at most nLimit (0 for no limit) unspent outputs following pkeyAfter, or from the first one if null.
+    //! An empty asset name reads the outputs of all assets other than RVN.
+    bool ReadAddressUnspentIndexPage(uint160 addressHash, int type, std::string assetName,
+                                     const CAddressUnspentKey *pkeyAfter, size_t nLimit,
+                                     std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &vect);
     bool WriteAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool EraseAddressIndex(const std::vector<std::pair<CAddressIndexKey, CAmount> > &vect);
     bool ReadAddressIndex(uint160 addressHash, int type, std::string assetName,
@@ -140,13 +202,35 @@ public:
     bool ReadAddressIndex(uint160 addressHash, int type,
                           std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
                           int start = 0, int end = 0);
+    //! Read at most nLimit (0 for no limit) entries of the history read by ReadAddressIndex following pkeyAfter,
+    //! or from the first one if null
+    bool ReadAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                              const CAddressIndexKey *pkeyAfter, size_t nLimit,
+                              std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex);
+    //! Read the history of an address between two heights across all assets, in height order
+    bool ReadAddressHeightIndex(uint160 addressHash, int type,
+                                std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                                int start, int end, const CAddressIndexKey *pkeyAfter = nullptr, size_t nLimit = 0);
     bool WriteTimestampIndex(const CTimestampIndexKey &timestampIndex);
-    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect);
+    bool ReadTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &vect,
+                            size_t nOffset = 0, size_t nLimit = 0);
+    /** Count the blocks of the range in buckets of nBucketSize seconds, as (start of the bucket, number of blocks) */
+    bool ReadTimestampIndexSummary(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, unsigned int nBucketSize,
+                                   std::vector<std::pair<unsigned int, unsigned int> > &buckets);
     bool WriteTimestampBlockIndex(const CTimestampBlockIndexKey &blockhashIndex, const CTimestampBlockIndexValue &logicalts);
     bool ReadTimestampBlockIndex(const uint256 &hash, unsigned int &logicalTS);
+    bool ReadBlockFilter(const uint256 &hash, CBlockFilterIndexValue &value);
+    bool WriteIndexUpdate(const CIndexUpdate &update, const uint256 &hashIndexBestBlock);
+    bool ReadIndexBestBlock(uint256 &hashIndexBestBlock);
+    bool WriteIndexBestBlock(const uint256 &hashIndexBestBlock);
+    //! Which indexes this database holds, kept here as well as in the block tree so they survive -reindex-index
     bool WriteFlag(const std::string &name, bool fValue);
     bool ReadFlag(const std::string &name, bool &fValue);
-    bool LoadBlockIndexGuts(const Consensus::Params& consensusParams, std::function<CBlockIndex*(const uint256&)> insertBlockIndex);
+
+    //! Move index entries and flags left in the block tree database by older versions. Returns false on failure.
+    bool MigrateFromBlockTree(CBlockTreeDB &blocktree);
+    //! Convert address index entries written by older versions to the compact key format
+    bool UpgradeAddressIndex();
 };
 
 #endif // RAVEN_TXDB_H
@@ -63,14 +63,14 @@ size_t CTxMemPoolEntry::GetTxSize() const
 // descendants.
 void CTxMemPool::UpdateForDescendants(txiter updateIt, cacheMap &cachedDescendants, const std::set<uint256> &setExclude)
 {
-    setEntries stageEntries, setAllDescendants;
-    stageEntries = GetMemPoolChildren(updateIt);
+    const linkEntries &updateChildren = GetMemPoolChildren(updateIt);
+    setEntries stageEntries(updateChildren.begin(), updateChildren.end()), setAllDescendants;
 
     while (!stageEntries.empty()) {
         const txiter cit = *stageEntries.begin();
         setAllDescendants.insert(cit);
         stageEntries.erase(cit);
-        const setEntries &setChildren = GetMemPoolChildren(cit);
+        const linkEntries &setChildren = GetMemPoolChildren(cit);
         for (const txiter childEntry : setChildren) {
             cacheMap::iterator cacheIt = cachedDescendants.find(childEntry);
             if (cacheIt != cachedDescendants.end()) {
@@ -176,7 +176,8 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
         // If we're not searching for parents, we require this to be an
         // entry in the mempool already.
         txiter it = mapTx.iterator_to(entry);
-        parentHashes = GetMemPoolParents(it);
+        const linkEntries &parents = GetMemPoolParents(it);
+        parentHashes.insert(parents.begin(), parents.end());
     }
 
     size_t totalSizeWithAncestors = entry.GetTxSize();
@@ -199,7 +200,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
             return false;
         }
 
-        const setEntries & setMemPoolParents = GetMemPoolParents(stageit);
+        const linkEntries & setMemPoolParents = GetMemPoolParents(stageit);
         for (const txiter &phash : setMemPoolParents) {
             // If this is a new ancestor, add it.
             if (setAncestors.count(phash) == 0) {
@@ -217,7 +218,7 @@ bool CTxMemPool::CalculateMemPoolAncestors(const CTxMemPoolEntry &entry, setEntr
 
 void CTxMemPool::UpdateAncestorsOf(bool add, txiter it, setEntries &setAncestors)
 {
-    setEntries parentIters = GetMemPoolParents(it);
+    const linkEntries parentIters = GetMemPoolParents(it);
     // add or remove this tx as a child of each parent
     for (txiter piter : parentIters) {
         UpdateChild(piter, it, add);
@@ -246,7 +247,7 @@ void CTxMemPool::UpdateEntryForAncestors(txiter it, const setEntries &setAncesto
 
 void CTxMemPool::UpdateChildrenForRemoval(txiter it)
 {
-    const setEntries &setMemPoolChildren = GetMemPoolChildren(it);
+    const linkEntries &setMemPoolChildren = GetMemPoolChildren(it);
     for (txiter updateIt : setMemPoolChildren) {
         UpdateParent(updateIt, it, false);
     }
@@ -331,9 +332,12 @@ void CTxMemPoolEntry::UpdateAncestorState(int64_t modifySize, CAmount modifyFee,
 }
 
 CTxMemPool::CTxMemPool(CBlockPolicyEstimator* estimator) :
-    nTransactionsUpdated(0), minerPolicyEstimator(estimator)
+    nTransactionsUpdated(0), minerPolicyEstimator(estimator),
+    mapTx(MemPoolAllocator<CTxMemPoolEntry>(&memPoolResource)),
+    mapLinks(CompareIteratorByHash(), MemPoolAllocator<std::pair<const txiter, TxLinks> >(&memPoolResource))
 {
     _clear(); //lock free clear
+    nEmptyPoolUsage = memPoolResource.InUseBytes();
 
     // Sanity checks off by default for performance, because otherwise
     // accepting transactions becomes O(N^2) where N is the number
@@ -359,6 +363,66 @@ void CTxMemPool::AddTransactionsUpdated(unsigned int n)
     nTransactionsUpdated += n;
 }
 
+void CTxMemPool::WatchTemplateFees(const CFeeRate& minFeeRate, CAmount nThreshold)
+{
+    LOCK(cs);
+    templateMinFeeRate = minFeeRate;
+    nTemplateFeeThreshold = nThreshold;
+    nTemplateFeeGain = 0;
+    fTemplateFeesImproved = false;
+    fTemplateFeesNotify = false;
+}
+
+bool CTxMemPool::TemplateFeesImproved() const
+{
+    LOCK(cs);
+    return fTemplateFeesImproved;
+}
+
+bool CTxMemPool::TakeTemplateFeesNotify()
+{
+    LOCK(cs);
+    bool fNotify = fTemplateFeesNotify;
+    fTemplateFeesNotify = false;
+    return fNotify;
+}
+
+/** RVN START */
+// The asset names a transaction reserves while it is in the mempool
+static std::vector<std::pair<std::string, MemPoolAssetOp> > GetMemPoolAssetOps(const CTransaction& tx)
+{
+    std::vector<std::pair<std::string, MemPoolAssetOp> > vAssetOps;
+    for (const CTxOut& txout : tx.vout) {
+        int nType = 0;
+        bool fIsOwner = false;
+        if (!txout.scriptPubKey.IsAssetScript(nType, fIsOwner))
+            continue;
+
+        std::string strAddress;
+        if (nType == TX_NEW_ASSET && !fIsOwner) {
+            CNewAsset asset;
+            if (AssetFromScript(txout.scriptPubKey, asset, strAddress))
+                vAssetOps.emplace_back(asset.strName, MemPoolAssetOp::NEW_ASSET);
+        } else if (nType == TX_REISSUE_ASSET) {
+            CReissueAsset reissue;
+            if (ReissueAssetFromScript(txout.scriptPubKey, reissue, strAddress))
+                vAssetOps.emplace_back(reissue.strName, MemPoolAssetOp::REISSUE);
+        }
+    }
+    return vAssetOps;
+}
+
+// Estimate the memory of an asset index entry as 6 pointers + an allocation, plus the name
+// when it is too long for the string's inline buffer (15 characters in libstdc++)
+static size_t AssetEntryUsage(const CMemPoolAssetEntry& assetEntry)
+{
+    size_t nUsage = memusage::MallocUsage(sizeof(CMemPoolAssetEntry) + 6 * sizeof(void*));
+    if (assetEntry.strName.capacity() > 15)
+        nUsage += memusage::MallocUsage(assetEntry.strName.capacity() + 1);
+    return nUsage;
+}
+/** RVN END */
+
 bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry, setEntries &setAncestors, bool validFeeEstimate)
 {
     NotifyEntryAdded(entry.GetSharedTx());
@@ -408,6 +472,16 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     UpdateAncestorsOf(true, newit, setAncestors);
     UpdateEntryForAncestors(newit, setAncestors);
 
+    if (nTemplateFeeThreshold > 0 && newit->GetModFeesWithAncestors() >= templateMinFeeRate.GetFee(newit->GetSizeWithAncestors())) {
+        nTemplateFeeGain += newit->GetModifiedFee();
+        if (nTemplateFeeGain >= nTemplateFeeThreshold) {
+            // Stop watching until a new template is made, so the crossing is reported once
+            nTemplateFeeThreshold = 0;
+            fTemplateFeesImproved = true;
+            fTemplateFeesNotify = true;
+        }
+    }
+
     nTransactionsUpdated++;
     totalTxSize += entry.GetTxSize();
     if (minerPolicyEstimator) {minerPolicyEstimator->processTransaction(entry, validFeeEstimate);}
@@ -415,6 +489,14 @@ bool CTxMemPool::addUnchecked(const uint256& hash, const CTxMemPoolEntry &entry,
     vTxHashes.emplace_back(tx.GetWitnessHash(), newit);
     newit->vTxHashesIdx = vTxHashes.size() - 1;
 
+    /** RVN START */
+    for (const auto& assetOp : GetMemPoolAssetOps(tx)) {
+        auto ret = mapAssetOps.insert(CMemPoolAssetEntry(assetOp.first, assetOp.second, hash));
+        if (ret.second)
+            cachedAssetUsage += AssetEntryUsage(*ret.first);
+    }
+    /** RVN END */
+
     return true;
 }
 
@@ -422,7 +504,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
 {
     LOCK(cs);
     const CTransaction& tx = entry.GetTx();
-    std::vector<CMempoolAddressDeltaKey> inserted;
+    std::vector<addressDeltaPos> inserted;
 
     uint256 txhash = tx.GetHash();
     for (unsigned int j = 0; j < tx.vin.size(); j++) {
@@ -432,20 +514,17 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), RVN, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            addAddressDelta(key, delta, inserted);
         } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), RVN, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            addAddressDelta(key, delta, inserted);
         } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
             CMempoolAddressDeltaKey key(1, hashBytes, RVN, txhash, j, 1);
             CMempoolAddressDelta delta(entry.GetTime(), prevout.nValue * -1, input.prevout.hash, input.prevout.n);
-            mapAddress.insert(std::make_pair(key, delta));
-            inserted.push_back(key);
+            addAddressDelta(key, delta, inserted);
         } else {
             /** RVN START */
             if (AreAssetsDeployed()) {
@@ -455,8 +534,7 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
                 if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
                     CMempoolAddressDeltaKey key(1, hashBytes, assetName, txhash, j, 1);
                     CMempoolAddressDelta delta(entry.GetTime(), assetAmount * -1, input.prevout.hash, input.prevout.n);
-                    mapAddress.insert(std::make_pair(key, delta));
-                    inserted.push_back(key);
+                    addAddressDelta(key, delta, inserted);
                 }
             }
             /** RVN END */
@@ -468,20 +546,15 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
         if (out.scriptPubKey.IsPayToScriptHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
             CMempoolAddressDeltaKey key(2, uint160(hashBytes), RVN, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            addAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), out.nValue), inserted);
         } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
             std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, uint160(hashBytes), RVN, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            addAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), out.nValue), inserted);
         } else if (out.scriptPubKey.IsPayToPublicKey()) {
             uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-            std::pair<addressDeltaMap::iterator,bool> ret;
             CMempoolAddressDeltaKey key(1, hashBytes, RVN, txhash, k, 0);
-            mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), out.nValue)));
-            inserted.push_back(key);
+            addAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), out.nValue), inserted);
         } else {
             /** RVN START */
             if (AreAssetsDeployed()) {
@@ -489,10 +562,8 @@ void CTxMemPool::addAddressIndex(const CTxMemPoolEntry &entry, const CCoinsViewC
                 std::string assetName;
                 CAmount assetAmount;
                 if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                    std::pair<addressDeltaMap::iterator, bool> ret;
                     CMempoolAddressDeltaKey key(1, hashBytes, assetName, txhash, k, 0);
-                    mapAddress.insert(std::make_pair(key, CMempoolAddressDelta(entry.GetTime(), assetAmount)));
-                    inserted.push_back(key);
+                    addAddressDelta(key, CMempoolAddressDelta(entry.GetTime(), assetAmount), inserted);
                 }
             }
             /** RVN END */
@@ -506,13 +577,13 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
 {
     LOCK(cs);
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first,
-                                                                                       assetName));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second
-                && (*ait).first.asset == assetName) {
-            results.push_back(*ait);
-            ait++;
+    for (const std::pair<uint160, int>& address : addresses) {
+        addressDeltaMap::const_iterator it = mapAddress.find(address);
+        if (it == mapAddress.end())
+            continue;
+        for (const auto& delta : it->second) {
+            if (delta.first.asset == assetName)
+                results.push_back(delta);
         }
     }
     return true;
@@ -522,25 +593,54 @@ bool CTxMemPool::getAddressIndex(std::vector<std::pair<uint160, int> > &addresse
                                  std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > &results)
 {
     LOCK(cs);
-    for (std::vector<std::pair<uint160, int> >::iterator it = addresses.begin(); it != addresses.end(); it++) {
-        addressDeltaMap::iterator ait = mapAddress.lower_bound(CMempoolAddressDeltaKey((*it).second, (*it).first));
-        while (ait != mapAddress.end() && (*ait).first.addressBytes == (*it).first && (*ait).first.type == (*it).second) {
-            results.push_back(*ait);
-            ait++;
-        }
+    for (const std::pair<uint160, int>& address : addresses) {
+        addressDeltaMap::const_iterator it = mapAddress.find(address);
+        if (it != mapAddress.end())
+            results.insert(results.end(), it->second.begin(), it->second.end());
     }
     return true;
 }
 
+void CTxMemPool::addAddressDelta(const CMempoolAddressDeltaKey &key, const CMempoolAddressDelta &delta,
+                                 std::vector<addressDeltaPos> &inserted)
+{
+    std::pair<uint160, int> address(key.addressBytes, key.type);
+    addressDeltas& deltas = mapAddress[address];
+    deltas.emplace_back(key, delta);
+    inserted.emplace_back(address, deltas.size() - 1);
+}
+
 bool CTxMemPool::removeAddressIndex(const uint256 txhash)
 {
     LOCK(cs);
     addressDeltaMapInserted::iterator it = mapAddressInserted.find(txhash);
 
     if (it != mapAddressInserted.end()) {
-        std::vector<CMempoolAddressDeltaKey> keys = (*it).second;
-        for (std::vector<CMempoolAddressDeltaKey>::iterator mit = keys.begin(); mit != keys.end(); mit++) {
-            mapAddress.erase(*mit);
+        // Positions are read as we go, the transaction's own later deltas may be moved too
+        std::vector<addressDeltaPos>& vPos = it->second;
+        for (size_t i = 0; i < vPos.size(); i++) {
+            addressDeltaMap::iterator ait = mapAddress.find(vPos[i].first);
+            if (ait == mapAddress.end())
+                continue;
+            addressDeltas& deltas = ait->second;
+            size_t nPos = vPos[i].second;
+            size_t nLast = deltas.size() - 1;
+            if (nPos != nLast) {
+                // Move the last delta into the hole and record its new position with its transaction
+                deltas[nPos] = std::move(deltas[nLast]);
+                addressDeltaMapInserted::iterator mit = mapAddressInserted.find(deltas[nPos].first.txhash);
+                if (mit != mapAddressInserted.end()) {
+                    for (addressDeltaPos& pos : mit->second) {
+                        if (pos.second == nLast && pos.first == vPos[i].first) {
+                            pos.second = nPos;
+                            break;
+                        }
+                    }
+                }
+            }
+            deltas.pop_back();
+            if (deltas.empty())
+                mapAddress.erase(ait);
         }
         mapAddressInserted.erase(it);
     }
@@ -643,19 +743,12 @@ void CTxMemPool::removeUnchecked(txiter it, MemPoolRemovalReason reason)
     removeSpentIndex(hash);
 
     /** RVN START */
-    // If the transaction being removed from the mempool is locking other reissues. Free them
-    if (mapReissuedTx.count(hash)) {
-        if (mapReissuedAssets.count(mapReissuedTx.at(hash))) {
-            mapReissuedAssets.erase(mapReissuedTx.at((hash)));
-            mapReissuedTx.erase(hash);
-        }
-    }
-
-    // Erase from the asset mempool maps if they match txid
-    if (mapHashToAsset.count(hash)) {
-        mapAssetToHash.erase(mapHashToAsset.at(hash));
-        mapHashToAsset.erase(hash);
-    }
+    // Release the asset names the transaction reserved
+    auto& assetsByTxid = mapAssetOps.get<asset_txid>();
+    auto assetRange = assetsByTxid.equal_range(hash);
+    for (auto ait = assetRange.first; ait != assetRange.second; ++ait)
+        cachedAssetUsage -= AssetEntryUsage(*ait);
+    assetsByTxid.erase(assetRange.first, assetRange.second);
     /** RVN END */
 }
 
@@ -679,7 +772,7 @@ void CTxMemPool::CalculateDescendants(txiter entryit, setEntries &setDescendants
         setDescendants.insert(it);
         stage.erase(it);
 
-        const setEntries &setChildren = GetMemPoolChildren(it);
+        const linkEntries &setChildren = GetMemPoolChildren(it);
         for (const txiter &childiter : setChildren) {
             if (!setDescendants.count(childiter)) {
                 stage.insert(childiter);
@@ -779,15 +872,6 @@ void CTxMemPool::removeConflicts(const CTransaction &tx)
  * Called when a block is connected. Removes from mempool and updates the miner fee estimator.
  */
 void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight)
-{
-    std::set<CAssetCacheNewAsset> set;
-    removeForBlock(vtx, nBlockHeight, set);
-}
-
-/**
- * Called when a block is connected. Removes from mempool and updates the miner fee estimator.
- */
-void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, std::set<CAssetCacheNewAsset>& setNewAssets)
 {
     LOCK(cs);
     std::vector<const CTxMemPoolEntry*> entries;
@@ -800,20 +884,6 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
             entries.push_back(&*i);
     }
 
-    /** RVN START */
-    // Get the newly added assets, and make sure they are in the entries
-    std::vector<CTransaction> trans;
-    for (auto it : setNewAssets) {
-        if (mapAssetToHash.count(it.asset.strName)) {
-            indexed_transaction_set::iterator i = mapTx.find(mapAssetToHash.at(it.asset.strName));
-            if (i != mapTx.end()) {
-                entries.push_back(&*i);
-                trans.emplace_back(i->GetTx());
-            }
-        }
-    }
-    /** RVN END */
-
     // Before the txs in the new block have been removed from the mempool, update policy estimates
     if (minerPolicyEstimator) {minerPolicyEstimator->processBlock(nBlockHeight, entries);}
     for (const auto& tx : vtx)
@@ -829,17 +899,20 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     }
 
     /** RVN START */
-    // Remove newly added asset issue transactions from the mempool if they haven't been removed already
-    for (auto tx : trans)
+    // A mempool transaction that issues or reissues an asset the block already did conflicts with it
+    for (const auto& tx : vtx)
     {
-        txiter it = mapTx.find(tx.GetHash());
-        if (it != mapTx.end()) {
-            setEntries stage;
-            stage.insert(it);
-            RemoveStaged(stage, true, MemPoolRemovalReason::BLOCK);
+        for (const auto& assetOp : GetMemPoolAssetOps(*tx)) {
+            uint256 hash;
+            if (!existsAssetOp(assetOp.first, assetOp.second, &hash))
+                continue;
+            txiter it = mapTx.find(hash);
+            if (it != mapTx.end()) {
+                const CTransactionRef ptx = it->GetSharedTx();
+                removeRecursive(*ptx, MemPoolRemovalReason::CONFLICT);
+                ClearPrioritisation(hash);
+            }
         }
-        removeConflicts(tx);
-        ClearPrioritisation(tx.GetHash());
     }
     /** RVN END */
 
@@ -847,6 +920,18 @@ void CTxMemPool::removeForBlock(const std::vector<CTransactionRef>& vtx, unsigne
     blockSinceLastRollingFeeBump = true;
 }
 
+bool CTxMemPool::existsAssetOp(const std::string& strName, MemPoolAssetOp op, uint256* pHash) const
+{
+    LOCK(cs);
+    const auto& assetsByName = mapAssetOps.get<asset_name>();
+    auto it = assetsByName.find(boost::make_tuple(strName, op));
+    if (it == assetsByName.end())
+        return false;
+    if (pHash)
+        *pHash = it->txid;
+    return true;
+}
+
 void CTxMemPool::_clear()
 {
     mapLinks.clear();
@@ -858,8 +943,12 @@ void CTxMemPool::_clear()
     blockSinceLastRollingFeeBump = false;
     rollingMinimumFeeRate = 0;
     ++nTransactionsUpdated;
-    mapAssetToHash.clear();
-    mapHashToAsset.clear();
+    nTemplateFeeThreshold = 0;
+    nTemplateFeeGain = 0;
+    fTemplateFeesImproved = false;
+    fTemplateFeesNotify = false;
+    mapAssetOps.clear();
+    cachedAssetUsage = 0;
 }
 
 void CTxMemPool::clear()
@@ -874,8 +963,7 @@ static void CheckInputsAndUpdateCoins(const CTransaction& tx, CCoinsViewCache& m
     bool fCheckResult = tx.IsCoinBase() || Consensus::CheckTxInputs(tx, state, mempoolDuplicate, spendheight, txfee);
     /** RVN START */
     if (AreAssetsDeployed()) {
-        std::vector<std::pair<std::string, uint256>> vReissueAssets;
-        bool fCheckAssets = Consensus::CheckTxAssets(tx, state, mempoolDuplicate, vReissueAssets);
+        bool fCheckAssets = Consensus::CheckTxAssets(tx, state, mempoolDuplicate);
         assert(fCheckResult && fCheckAssets);
     } else
         assert(fCheckResult);
@@ -935,7 +1023,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
             assert(it3->second == &tx);
             i++;
         }
-        assert(setParentCheck == GetMemPoolParents(it));
+        assert(setParentCheck == setEntries(links.parents.begin(), links.parents.end()));
         // Verify ancestor state is correct.
         setEntries setAncestors;
         uint64_t nNoLimit = std::numeric_limits<uint64_t>::max();
@@ -968,7 +1056,7 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
                 childSizes += childit->GetTxSize();
             }
         }
-        assert(setChildrenCheck == GetMemPoolChildren(it));
+        assert(setChildrenCheck == setEntries(links.children.begin(), links.children.end()));
         // Also check to make sure size is greater than sum with immediate children.
         // just a sanity check, not definitive that this calc is correct...
         assert(it->GetSizeWithDescendants() >= childSizes + it->GetTxSize());
@@ -1003,6 +1091,15 @@ void CTxMemPool::check(const CCoinsViewCache *pcoins) const
 
     assert(totalTxSize == checkTotal);
     assert(innerUsage == cachedInnerUsage);
+
+    /** RVN START */
+    uint64_t assetUsage = 0;
+    for (const CMemPoolAssetEntry& assetEntry : mapAssetOps) {
+        assert(mapTx.count(assetEntry.txid));
+        assetUsage += AssetEntryUsage(assetEntry);
+    }
+    assert(assetUsage == cachedAssetUsage);
+    /** RVN END */
 }
 
 bool CTxMemPool::CompareDepthAndScore(const uint256& hasha, const uint256& hashb)
@@ -1173,8 +1270,14 @@ bool CCoinsViewMemPool::GetCoin(const COutPoint &outpoint, Coin &coin) const {
 
 size_t CTxMemPool::DynamicMemoryUsage() const {
     LOCK(cs);
-    // Estimate the overhead of mapTx to be 15 pointers + an allocation, as no exact formula for boost::multi_index_contained is implemented.
-    return memusage::MallocUsage(sizeof(CTxMemPoolEntry) + 15 * sizeof(void*)) * mapTx.size() + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(mapLinks) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage;
+    // The nodes of mapTx and mapLinks, and the bucket array of mapTx, are all allocated from memPoolResource, which counts them exactly.
+    // What the empty containers hold is left out, as it does not shrink when transactions are evicted.
+    return memPoolResource.InUseBytes() - nEmptyPoolUsage + memusage::DynamicUsage(mapNextTx) + memusage::DynamicUsage(mapDeltas) + memusage::DynamicUsage(vTxHashes) + cachedInnerUsage + DynamicAssetUsage();
+}
+
+size_t CTxMemPool::DynamicAssetUsage() const {
+    LOCK(cs);
+    return cachedAssetUsage;
 }
 
 void CTxMemPool::RemoveStaged(setEntries &stage, bool updateDescendants, MemPoolRemovalReason reason) {
@@ -1211,27 +1314,32 @@ bool CTxMemPool::addUnchecked(const uint256&hash, const CTxMemPoolEntry &entry,
     return addUnchecked(hash, entry, setAncestors, validFeeEstimate);
 }
 
+// Add or remove link in the sorted links, keeping cachedUsage in step with any heap storage they use
+static void UpdateLink(CTxMemPool::linkEntries& links, CTxMemPool::txiter link, bool add, uint64_t& cachedUsage)
+{
+    CTxMemPool::linkEntries::iterator pos = std::lower_bound(links.begin(), links.end(), link, CTxMemPool::CompareIteratorByHash());
+    const bool fFound = pos != links.end() && *pos == link;
+    if (add == fFound)
+        return;
+    cachedUsage -= memusage::DynamicUsage(links);
+    if (add)
+        links.insert(pos, link);
+    else
+        links.erase(pos);
+    cachedUsage += memusage::DynamicUsage(links);
+}
+
 void CTxMemPool::UpdateChild(txiter entry, txiter child, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].children.insert(child).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].children.erase(child)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
-    }
+    UpdateLink(mapLinks[entry].children, child, add, cachedInnerUsage);
 }
 
 void CTxMemPool::UpdateParent(txiter entry, txiter parent, bool add)
 {
-    setEntries s;
-    if (add && mapLinks[entry].parents.insert(parent).second) {
-        cachedInnerUsage += memusage::IncrementalDynamicUsage(s);
-    } else if (!add && mapLinks[entry].parents.erase(parent)) {
-        cachedInnerUsage -= memusage::IncrementalDynamicUsage(s);
-    }
+    UpdateLink(mapLinks[entry].parents, parent, add, cachedInnerUsage);
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
+const CTxMemPool::linkEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
 {
     assert (entry != mapTx.end());
     txlinksMap::const_iterator it = mapLinks.find(entry);
@@ -1239,7 +1347,7 @@ const CTxMemPool::setEntries & CTxMemPool::GetMemPoolParents(txiter entry) const
     return it->second.parents;
 }
 
-const CTxMemPool::setEntries & CTxMemPool::GetMemPoolChildren(txiter entry) const
+const CTxMemPool::linkEntries & CTxMemPool::GetMemPoolChildren(txiter entry) const
 {
     assert (entry != mapTx.end());
     txlinksMap::const_iterator it = mapLinks.find(entry);
@@ -1330,3 +1438,5 @@ bool CTxMemPool::TransactionWithinChainLimit(const uint256& txid, size_t chainLi
 }
 
 SaltedTxidHasher::SaltedTxidHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
+
+SaltedAddressHasher::SaltedAddressHasher() : k0(GetRand(std::numeric_limits<uint64_t>::max())), k1(GetRand(std::numeric_limits<uint64_t>::max())) {}
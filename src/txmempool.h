@@ -10,6 +10,7 @@
 #include <memory>
 #include <set>
 #include <map>
+#include <unordered_map>
 #include <vector>
 #include <utility>
 #include <string>
@@ -18,14 +19,19 @@
 #include "spentindex.h"
 #include "amount.h"
 #include "coins.h"
+#include "hash.h"
 #include "indirectmap.h"
 #include "policy/feerate.h"
+#include "prevector.h"
 #include "primitives/transaction.h"
+#include "support/allocators/pool.h"
 #include "sync.h"
 #include "random.h"
 
 #include <boost/multi_index_container.hpp>
+#include <boost/multi_index/composite_key.hpp>
 #include <boost/multi_index/hashed_index.hpp>
+#include <boost/multi_index/member.hpp>
 #include <boost/multi_index/ordered_index.hpp>
 #include <boost/multi_index/sequenced_index.hpp>
 #include <boost/signals2/signal.hpp>
@@ -340,6 +346,72 @@ public:
     }
 };
 
+/** RVN START */
+/** Asset operations of which the mempool holds at most one per asset name */
+enum class MemPoolAssetOp {
+    NEW_ASSET,   //! Issues a new (non-owner) asset
+    REISSUE,     //! Reissues an existing asset
+};
+
+/** An asset name reserved by a mempool transaction */
+struct CMemPoolAssetEntry
+{
+    std::string strName;
+    MemPoolAssetOp op;
+    uint256 txid;
+
+    CMemPoolAssetEntry(const std::string& strNameIn, MemPoolAssetOp opIn, const uint256& txidIn) : strName(strNameIn), op(opIn), txid(txidIn) {}
+};
+
+// multi_index tags for the mempool asset index
+struct asset_name {};
+struct asset_txid {};
+
+typedef boost::multi_index_container<
+    CMemPoolAssetEntry,
+    boost::multi_index::indexed_by<
+        // sorted by asset name and operation
+        boost::multi_index::ordered_unique<
+            boost::multi_index::tag<asset_name>,
+            boost::multi_index::composite_key<
+                CMemPoolAssetEntry,
+                boost::multi_index::member<CMemPoolAssetEntry, std::string, &CMemPoolAssetEntry::strName>,
+                boost::multi_index::member<CMemPoolAssetEntry, MemPoolAssetOp, &CMemPoolAssetEntry::op>
+            >
+        >,
+        // hashed by the transaction holding the name
+        boost::multi_index::hashed_non_unique<
+            boost::multi_index::tag<asset_txid>,
+            boost::multi_index::member<CMemPoolAssetEntry, uint256, &CMemPoolAssetEntry::txid>,
+            SaltedTxidHasher
+        >
+    >
+> indexed_asset_set;
+/** RVN END */
+
+class SaltedAddressHasher
+{
+private:
+    /** Salt */
+    const uint64_t k0, k1;
+
+public:
+    SaltedAddressHasher();
+
+    size_t operator()(const std::pair<uint160, int>& address) const {
+        // CSipHasher can only take a whole word before any odd-sized bytes, so the type goes first
+        return CSipHasher(k0, k1).Write(address.second).Write(address.first.begin(), address.first.size()).Finalize();
+    }
+};
+
+/** Largest block served from the mempool's pool: a mapTx node, i.e. an entry plus the links of its indexes */
+static const size_t MEMPOOL_POOL_BLOCK_SIZE = sizeof(CTxMemPoolEntry) + 16 * sizeof(void*);
+
+/** Backs the nodes of mapTx and mapLinks, so entries and their links share chunks instead of separate heap allocations */
+typedef PoolResource<MEMPOOL_POOL_BLOCK_SIZE, alignof(void*)> MemPoolResource;
+template <class T>
+using MemPoolAllocator = PoolAllocator<T, MEMPOOL_POOL_BLOCK_SIZE, alignof(void*)>;
+
 /**
  * CTxMemPool stores valid-according-to-the-current-best-chain transactions
  * that may be included in the next block.
@@ -418,6 +490,8 @@ private:
     uint32_t nCheckFrequency; //!< Value n means that n times in 2^32 we check.
     unsigned int nTransactionsUpdated; //!< Used by getblocktemplate to trigger CreateNewBlock() invocation
     CBlockPolicyEstimator* minerPolicyEstimator;
+    MemPoolResource memPoolResource; //!< Must be declared before (and so outlive) mapTx and mapLinks
+    size_t nEmptyPoolUsage;          //!< What memPoolResource holds for the empty containers, which trimming cannot free
 
     uint64_t totalTxSize;      //!< sum of all mempool tx's virtual sizes. Differs from serialized tx size since witness data is discounted. Defined in BIP 141.
     uint64_t cachedInnerUsage; //!< sum of dynamic memory usage of all the map elements (NOT the maps themselves)
@@ -426,6 +500,12 @@ private:
     mutable bool blockSinceLastRollingFeeBump;
     mutable double rollingMinimumFeeRate; //!< minimum fee to get into the pool, decreases exponentially
 
+    CFeeRate templateMinFeeRate;   //!< Lowest ancestor fee rate at which new transactions improve the last block template
+    CAmount nTemplateFeeThreshold; //!< Fees new transactions must add to the last block template to make it stale (0: not watching)
+    CAmount nTemplateFeeGain;      //!< Fees the transactions added since the last block template would add to it
+    bool fTemplateFeesImproved;    //!< The fee gain reached the threshold, which disarmed the watch until the next template
+    bool fTemplateFeesNotify;      //!< The fee gain reached the threshold and long-polls were not woken for it yet
+
     void trackPackageRemoved(const CFeeRate& rate);
 
 public:
@@ -461,15 +541,13 @@ public:
                 boost::multi_index::identity<CTxMemPoolEntry>,
                 CompareTxMemPoolEntryByAncestorFee
             >
-        >
+        >,
+        MemPoolAllocator<CTxMemPoolEntry>
     > indexed_transaction_set;
 
     mutable CCriticalSection cs;
     indexed_transaction_set mapTx;
 
-    std::map<std::string, uint256> mapAssetToHash;
-    std::map<uint256, std::string> mapHashToAsset;
-
     typedef indexed_transaction_set::nth_index<0>::type::iterator txiter;
     std::vector<std::pair<uint256, txiter> > vTxHashes; //!< All tx witness hashes/entries in mapTx, in random order
 
@@ -479,32 +557,48 @@ public:
         }
     };
     typedef std::set<txiter, CompareIteratorByHash> setEntries;
+    /** Direct parents or children of an entry, sorted like setEntries but in a flat vector
+     *  that holds the usual one or two links without a heap allocation. prevector is packed:
+     *  the 64 bit size keeps the inline links aligned as long as the prevector itself is. */
+    typedef prevector<2, txiter, uint64_t, int64_t> linkEntries;
 
-    const setEntries & GetMemPoolParents(txiter entry) const;
-    const setEntries & GetMemPoolChildren(txiter entry) const;
+    const linkEntries & GetMemPoolParents(txiter entry) const;
+    const linkEntries & GetMemPoolChildren(txiter entry) const;
 private:
     typedef std::map<txiter, setEntries, CompareIteratorByHash> cacheMap;
 
-    struct TxLinks {
-        setEntries parents;
-        setEntries children;
+    struct alignas(txiter) TxLinks {
+        linkEntries parents;
+        linkEntries children;
     };
 
-    typedef std::map<txiter, TxLinks, CompareIteratorByHash> txlinksMap;
+    typedef std::map<txiter, TxLinks, CompareIteratorByHash, MemPoolAllocator<std::pair<const txiter, TxLinks> > > txlinksMap;
     txlinksMap mapLinks;
 
-    typedef std::map<CMempoolAddressDeltaKey, CMempoolAddressDelta, CMempoolAddressDeltaKeyCompare> addressDeltaMap;
+    //! The deltas of every address (hash and type), in no particular order
+    typedef std::vector<std::pair<CMempoolAddressDeltaKey, CMempoolAddressDelta> > addressDeltas;
+    typedef std::unordered_map<std::pair<uint160, int>, addressDeltas, SaltedAddressHasher> addressDeltaMap;
     addressDeltaMap mapAddress;
 
-    typedef std::map<uint256, std::vector<CMempoolAddressDeltaKey> > addressDeltaMapInserted;
+    //! Where the deltas of every transaction are, as address and position in its deltas,
+    //! so a transaction's deltas are removed by swapping them with the last ones
+    typedef std::pair<std::pair<uint160, int>, size_t> addressDeltaPos;
+    typedef std::unordered_map<uint256, std::vector<addressDeltaPos>, SaltedTxidHasher> addressDeltaMapInserted;
     addressDeltaMapInserted mapAddressInserted;
 
+    void addAddressDelta(const CMempoolAddressDeltaKey &key, const CMempoolAddressDelta &delta,
+                         std::vector<addressDeltaPos> &inserted);
+
     typedef std::map<CSpentIndexKey, CSpentIndexValue, CSpentIndexKeyCompare> mapSpentIndex;
     mapSpentIndex mapSpent;
 
     typedef std::map<uint256, std::vector<CSpentIndexKey> > mapSpentIndexInserted;
     mapSpentIndexInserted mapSpentInserted;
 
+    //! The asset names reserved by mempool transactions, maintained by addUnchecked and removeUnchecked
+    indexed_asset_set mapAssetOps;
+    uint64_t cachedAssetUsage; //!< Estimated memory of mapAssetOps, see AssetEntryUsage()
+
     void UpdateParent(txiter entry, txiter parent, bool add);
     void UpdateChild(txiter entry, txiter child, bool add);
 
@@ -548,9 +642,11 @@ public:
     void removeRecursive(const CTransaction &tx, MemPoolRemovalReason reason = MemPoolRemovalReason::UNKNOWN);
     void removeForReorg(const CCoinsViewCache *pcoins, unsigned int nMemPoolHeight, int flags);
     void removeConflicts(const CTransaction &tx);
-    void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight, std::set<CAssetCacheNewAsset>& setNewAssets );
     void removeForBlock(const std::vector<CTransactionRef>& vtx, unsigned int nBlockHeight);
 
+    /** Whether a mempool transaction performs op on asset strName, optionally returning its txid */
+    bool existsAssetOp(const std::string& strName, MemPoolAssetOp op, uint256* pHash = nullptr) const;
+
     void clear();
     void _clear(); //lock free
     bool CompareDepthAndScore(const uint256& hasha, const uint256& hashb);
@@ -558,6 +654,12 @@ public:
     bool isSpent(const COutPoint& outpoint);
     unsigned int GetTransactionsUpdated() const;
     void AddTransactionsUpdated(unsigned int n);
+    /** Start counting the fees of new transactions paying at least minFeeRate, for a block template that was just made */
+    void WatchTemplateFees(const CFeeRate& minFeeRate, CAmount nThreshold);
+    /** Whether the transactions added since WatchTemplateFees() add at least its threshold in fees */
+    bool TemplateFeesImproved() const;
+    /** Whether the fees reached the threshold since the last call, so long-polls are woken once per crossing */
+    bool TakeTemplateFeesNotify();
     /**
      * Check that none of this transactions inputs are in the mempool, and thus
      * the tx is not dependent on other mempool transactions to be included in a block.
@@ -650,6 +752,8 @@ public:
     std::vector<TxMempoolInfo> infoAll() const;
 
     size_t DynamicMemoryUsage() const;
+    /** Estimated memory used by the asset name index, which DynamicMemoryUsage includes */
+    size_t DynamicAssetUsage() const;
 
     boost::signals2::signal<void (CTransactionRef)> NotifyEntryAdded;
     boost::signals2::signal<void (CTransactionRef, MemPoolRemovalReason)> NotifyEntryRemoved;
@@ -7,6 +7,7 @@
 #include "validation.h"
 
 #include "arith_uint256.h"
+#include "blockconnectstats.h"
 #include "chain.h"
 #include "chainparams.h"
 #include "checkpoints.h"
@@ -44,8 +45,12 @@
 #include "warnings.h"
 #include "net.h"
 
+#include <algorithm>
 #include <atomic>
+#include <queue>
 #include <sstream>
+#include <thread>
+#include <tuple>
 
 #include <boost/algorithm/string/replace.hpp>
 #include <boost/algorithm/string/join.hpp>
@@ -76,12 +81,16 @@ CBlockIndex *pindexBestHeader = nullptr;
 CWaitableCriticalSection csBestBlock;
 CConditionVariable cvBlockChange;
 int nScriptCheckThreads = 0;
+bool fParallelConnect = DEFAULT_PARALLEL_CONNECT;
+int nBlockPrefetchThreads = 0;
+int nAddressQueryThreads = DEFAULT_ADDRESS_QUERY_THREADS;
 std::atomic_bool fImporting(false);
 std::atomic_bool fReindex(false);
 bool fTxIndex = false;
 bool fAssetIndex = false;
 bool fAddressIndex = false;
 bool fTimestampIndex = false;
+bool fBlockFilterIndex = false;
 bool fSpentIndex = false;
 bool fHavePruned = false;
 bool fPruneMode = false;
@@ -196,6 +205,7 @@ CBlockIndex* FindForkInGlobalIndex(const CChain& chain, const CBlockLocator& loc
 CCoinsViewDB *pcoinsdbview = nullptr;
 CCoinsViewCache *pcoinsTip = nullptr;
 CBlockTreeDB *pblocktree = nullptr;
+CIndexDB *pindexdb = nullptr;
 
 CAssetsDB *passetsdb = nullptr;
 CAssetsCache *passets = nullptr;
@@ -388,10 +398,29 @@ static bool IsCurrentForFeeEstimation()
  * and instead just erase from the mempool as needed.
  */
 
+/** The script verification flags transactions are accepted to the mempool with */
+static unsigned int GetMempoolScriptVerifyFlags(const CChainParams& chainparams)
+{
+    unsigned int flags = STANDARD_SCRIPT_VERIFY_FLAGS;
+    if (!chainparams.RequireStandard()) {
+        flags = gArgs.GetArg("-promiscuousmempoolflags", flags);
+    }
+    return flags;
+}
+
+static bool RunScriptChecks(std::vector<CScriptCheck>& vChecks);
+static void PrecheckReorgTransactionScripts(const std::vector<CTransactionRef>& vtx);
+
 void UpdateMempoolForReorg(DisconnectedBlockTransactions &disconnectpool, bool fAddToMempool)
 {
     AssertLockHeld(cs_main);
     std::vector<uint256> vHashUpdate;
+    if (fAddToMempool) {
+        std::vector<CTransactionRef> vtx;
+        for (auto it = disconnectpool.queuedTx.get<insertion_order>().rbegin(); it != disconnectpool.queuedTx.get<insertion_order>().rend(); ++it)
+            vtx.push_back(*it);
+        PrecheckReorgTransactionScripts(vtx);
+    }
     // disconnectpool's insertion_order index sorts the entries from
     // oldest to newest, but the oldest entry will be the last tx from the
     // latest mined block that was disconnected.
@@ -463,6 +492,22 @@ static bool CheckInputsFromMempoolAndCache(const CTransaction& tx, CValidationSt
     return CheckInputs(tx, state, view, true, flags, cacheSigStore, true, txdata);
 }
 
+/** RVN START */
+/** Whether tx reissues an asset that a different transaction in the pool already reissues */
+static bool HasMempoolReissueConflict(const CTxMemPool& pool, const CTransaction& tx)
+{
+    for (const auto& out : tx.vout) {
+        CReissueAsset reissue;
+        std::string strAddress;
+        uint256 hashReissue;
+        if (out.scriptPubKey.IsReissueAsset() && ReissueAssetFromScript(out.scriptPubKey, reissue, strAddress) &&
+                pool.existsAssetOp(reissue.strName, MemPoolAssetOp::REISSUE, &hashReissue) && hashReissue != tx.GetHash())
+            return true;
+    }
+    return false;
+}
+/** RVN END */
+
 static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool& pool, CValidationState& state, const CTransactionRef& ptx,
                               bool* pfMissingInputs, int64_t nAcceptTime, std::list<CTransactionRef>* plTxnReplaced,
                               bool bypass_limits, const CAmount& nAbsurdFee, std::vector<COutPoint>& coins_to_uncache)
@@ -471,7 +516,6 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
     const uint256 hash = tx.GetHash();
 
     /** RVN START */
-    std::vector<std::pair<std::string, uint256>> vReissueAssets;
     AssertLockHeld(cs_main);
     if (pfMissingInputs)
         *pfMissingInputs = false;
@@ -612,9 +656,14 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
         }
 
         if (AreAssetsDeployed()) {
-            if (!Consensus::CheckTxAssets(tx, state, view, vReissueAssets))
+            if (!Consensus::CheckTxAssets(tx, state, view))
                 return error("%s: Consensus::CheckTxAssets: %s, %s", __func__, tx.GetHash().ToString(),
                              FormatStateMessage(state));
+
+            // Only one reissue of an asset may be in the mempool at a time. The peer may
+            // simply not have seen the other one yet, so this is not its fault.
+            if (HasMempoolReissueConflict(pool, tx))
+                return state.DoS(0, false, REJECT_DUPLICATE, "txn-mempool-conflict");
         }
         /** RVN END */
 
@@ -826,10 +875,7 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             }
         }
 
-        unsigned int scriptVerifyFlags = STANDARD_SCRIPT_VERIFY_FLAGS;
-        if (!chainparams.RequireStandard()) {
-            scriptVerifyFlags = gArgs.GetArg("-promiscuousmempoolflags", scriptVerifyFlags);
-        }
+        unsigned int scriptVerifyFlags = GetMempoolScriptVerifyFlags(chainparams);
 
         // Check against previous transactions
         // This is done last to help prevent CPU exhaustion denial-of-service attacks.
@@ -920,25 +966,6 @@ static bool AcceptToMemoryPoolWorker(const CChainParams& chainparams, CTxMemPool
             if (!pool.exists(hash))
                 return state.DoS(0, false, REJECT_INSUFFICIENTFEE, "mempool full");
         }
-
-        for (auto out : vReissueAssets) {
-            mapReissuedAssets.insert(out);
-            mapReissuedTx.insert(std::make_pair(out.second, out.first));
-        }
-
-        if (AreAssetsDeployed()) {
-            for (auto out : tx.vout) {
-                if (out.scriptPubKey.IsAssetScript()) {
-                    CAssetOutputEntry data;
-                    if (!GetAssetData(out.scriptPubKey, data))
-                        continue;
-                    if (data.type == TX_NEW_ASSET && !IsAssetNameAnOwner(data.assetName)) {
-                        pool.mapAssetToHash[data.assetName] = hash;
-                        pool.mapHashToAsset[hash] = data.assetName;
-                    }
-                }
-            }
-        }
     }
 
     GetMainSignals().TransactionAddedToMempool(ptx);
@@ -956,6 +983,11 @@ static bool AcceptToMemoryPoolWithTime(const CChainParams& chainparams, CTxMemPo
     if (!res) {
         for (const COutPoint& hashTx : coins_to_uncache)
             pcoinsTip->Uncache(hashTx);
+    } else if (pool.TakeTemplateFeesNotify()) {
+        // Wake up long-polling getblocktemplate calls. Taking csBestBlock makes sure
+        // a waiter is either past its check of the mempool or already waiting.
+        { boost::unique_lock<boost::mutex> lock(csBestBlock); }
+        cvBlockChange.notify_all();
     }
     // After we've (potentially) uncached entries, ensure our coins cache is still within its size limits
     CValidationState stateDummy;
@@ -971,17 +1003,30 @@ bool AcceptToMemoryPool(CTxMemPool& pool, CValidationState &state, const CTransa
     return AcceptToMemoryPoolWithTime(chainparams, pool, state, tx, pfMissingInputs, GetTime(), plTxnReplaced, bypass_limits, nAbsurdFee);
 }
 
-bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes)
+bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes,
+                       size_t nOffset, size_t nLimit)
 {
     if (!fTimestampIndex)
         return error("Timestamp index not enabled");
 
-    if (!pblocktree->ReadTimestampIndex(high, low, fActiveOnly, hashes))
+    if (!pindexdb->ReadTimestampIndex(high, low, fActiveOnly, hashes, nOffset, nLimit))
         return error("Unable to get hashes for timestamps");
 
     return true;
 }
 
+bool GetTimestampIndexSummary(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, unsigned int nBucketSize,
+                              std::vector<std::pair<unsigned int, unsigned int> > &buckets)
+{
+    if (!fTimestampIndex)
+        return error("Timestamp index not enabled");
+
+    if (!pindexdb->ReadTimestampIndexSummary(high, low, fActiveOnly, nBucketSize, buckets))
+        return error("Unable to summarize timestamps");
+
+    return true;
+}
+
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
 {
     if (!fSpentIndex)
@@ -990,17 +1035,25 @@ bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value)
     if (mempool.getSpentIndex(key, value))
         return true;
 
-    if (!pblocktree->ReadSpentIndex(key, value))
+    if (!pindexdb->ReadSpentIndex(key, value))
         return false;
 
     return true;
 }
 
+bool GetBlockFilter(const uint256 &hash, CBlockFilterIndexValue &value)
+{
+    if (!fBlockFilterIndex)
+        return error("block filter index not enabled");
+
+    return pindexdb->ReadBlockFilter(hash, value);
+}
+
 bool HashOnchainActive(const uint256 &hash)
 {
-    CBlockIndex* pblockindex = mapBlockIndex[hash];
+    BlockMap::const_iterator mi = mapBlockIndex.find(hash);
 
-    if (!chainActive.Contains(pblockindex)) {
+    if (mi == mapBlockIndex.end() || !chainActive.Contains(mi->second)) {
         return false;
     }
 
@@ -1013,7 +1066,7 @@ bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end))
+    if (!pindexdb->ReadAddressIndex(addressHash, type, assetName, addressIndex, start, end))
         return error("unable to get txids for address");
 
     return true;
@@ -1025,7 +1078,7 @@ bool GetAddressIndex(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressIndex(addressHash, type, addressIndex, start, end))
+    if (!pindexdb->ReadAddressIndex(addressHash, type, addressIndex, start, end))
         return error("unable to get txids for address");
 
     return true;
@@ -1037,7 +1090,7 @@ bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs))
+    if (!pindexdb->ReadAddressUnspentIndex(addressHash, type, assetName, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
@@ -1049,7 +1102,158 @@ bool GetAddressUnspent(uint160 addressHash, int type,
     if (!fAddressIndex)
         return error("address index not enabled");
 
-    if (!pblocktree->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+    if (!pindexdb->ReadAddressUnspentIndex(addressHash, type, unspentOutputs))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+/**
+ * Run read(address, results) for every address, on up to nAddressQueryThreads threads (including
+ * the calling one), and k-way merge the per address results, each sorted with less, into vMerged.
+ */
+template <typename T, typename Read, typename Less>
+static bool ReadAddressesParallel(const std::vector<std::pair<uint160, int> > &addresses, Read read, Less less, std::vector<T> &vMerged)
+{
+    std::vector<std::vector<T> > vResults(addresses.size());
+    std::vector<char> vOk(addresses.size(), false);
+    std::atomic<size_t> nNext(0);
+
+    auto worker = [&]() {
+        size_t i;
+        while ((i = nNext++) < addresses.size()) {
+            try {
+                vOk[i] = read(addresses[i], vResults[i]);
+            } catch (const std::exception& e) {
+                LogPrintf("%s: %s\n", __func__, e.what());
+            }
+            if (vOk[i] && !std::is_sorted(vResults[i].begin(), vResults[i].end(), less))
+                std::stable_sort(vResults[i].begin(), vResults[i].end(), less);
+        }
+    };
+
+    std::vector<std::thread> vThreads;
+    size_t nThreads = std::min<size_t>(std::max(nAddressQueryThreads, 1), addresses.size());
+    for (size_t i = 1; i < nThreads; i++)
+        vThreads.emplace_back(worker);
+    worker();
+    for (std::thread& thread : vThreads)
+        thread.join();
+
+    if (std::find(vOk.begin(), vOk.end(), false) != vOk.end())
+        return false;
+
+    // Merge on the next entry of every address, taking equal entries in the order of the addresses
+    typedef std::pair<size_t, size_t> Position;
+    auto greater = [&](const Position& a, const Position& b) {
+        const T& entryA = vResults[a.first][a.second];
+        const T& entryB = vResults[b.first][b.second];
+        if (less(entryB, entryA))
+            return true;
+        return !less(entryA, entryB) && a.first > b.first;
+    };
+    std::priority_queue<Position, std::vector<Position>, decltype(greater)> heap(greater);
+    size_t nTotal = 0;
+    for (size_t i = 0; i < vResults.size(); i++) {
+        nTotal += vResults[i].size();
+        if (!vResults[i].empty())
+            heap.push(Position(i, 0));
+    }
+    vMerged.reserve(vMerged.size() + nTotal);
+    while (!heap.empty()) {
+        Position pos = heap.top();
+        heap.pop();
+        vMerged.push_back(std::move(vResults[pos.first][pos.second]));
+        if (++pos.second < vResults[pos.first].size())
+            heap.push(pos);
+    }
+    return true;
+}
+
+bool GetAddressesIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                       std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, int start, int end)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    return ReadAddressesParallel(addresses,
+        [&assetName, start, end](const std::pair<uint160, int>& address, std::vector<std::pair<CAddressIndexKey, CAmount> >& entries) {
+            return GetAddressIndex(address.first, address.second, assetName, entries, start, end);
+        },
+        [](const std::pair<CAddressIndexKey, CAmount>& a, const std::pair<CAddressIndexKey, CAmount>& b) {
+            if (a.first.blockHeight != b.first.blockHeight)
+                return a.first.blockHeight < b.first.blockHeight;
+            return a.first.txindex < b.first.txindex;
+        },
+        addressIndex);
+}
+
+bool GetAddressesUnspent(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                         std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    return ReadAddressesParallel(addresses,
+        [&assetName](const std::pair<uint160, int>& address, std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> >& entries) {
+            return GetAddressUnspent(address.first, address.second, assetName, entries);
+        },
+        [](const std::pair<CAddressUnspentKey, CAddressUnspentValue>& a, const std::pair<CAddressUnspentKey, CAddressUnspentValue>& b) {
+            return a.second.blockHeight < b.second.blockHeight;
+        },
+        unspentOutputs);
+}
+
+void GetAddressIndexTxids(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, std::vector<uint256> &txids)
+{
+    // Compared in binary, the entries of a transaction share its height and position in the block
+    typedef std::tuple<int, unsigned int, const uint256*> TxPosition;
+    auto less = [](const TxPosition& a, const TxPosition& b) {
+        if (std::get<0>(a) != std::get<0>(b))
+            return std::get<0>(a) < std::get<0>(b);
+        if (std::get<1>(a) != std::get<1>(b))
+            return std::get<1>(a) < std::get<1>(b);
+        return *std::get<2>(a) < *std::get<2>(b);
+    };
+    auto equal = [](const TxPosition& a, const TxPosition& b) {
+        return std::get<0>(a) == std::get<0>(b) && std::get<1>(a) == std::get<1>(b) && *std::get<2>(a) == *std::get<2>(b);
+    };
+
+    std::vector<TxPosition> vPositions;
+    vPositions.reserve(addressIndex.size());
+    for (const auto& entry : addressIndex)
+        vPositions.emplace_back(entry.first.blockHeight, entry.first.txindex, &entry.first.txhash);
+    // Entries merged by GetAddressesIndex are already in order
+    if (!std::is_sorted(vPositions.begin(), vPositions.end(), less))
+        std::sort(vPositions.begin(), vPositions.end(), less);
+    vPositions.erase(std::unique(vPositions.begin(), vPositions.end(), equal), vPositions.end());
+
+    txids.reserve(txids.size() + vPositions.size());
+    for (const TxPosition& position : vPositions)
+        txids.push_back(*std::get<2>(position));
+}
+
+bool GetAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                         const CAddressIndexKey *pkeyAfter, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pindexdb->ReadAddressIndexPage(addressHash, type, assetName, start, end, pkeyAfter, nLimit, addressIndex))
+        return error("unable to get txids for address");
+
+    return true;
+}
+
+bool GetAddressUnspentPage(uint160 addressHash, int type, std::string assetName,
+                           const CAddressUnspentKey *pkeyAfter, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs)
+{
+    if (!fAddressIndex)
+        return error("address index not enabled");
+
+    if (!pindexdb->ReadAddressUnspentIndexPage(addressHash, type, assetName, pkeyAfter, nLimit, unspentOutputs))
         return error("unable to get txids for address");
 
     return true;
@@ -1425,6 +1629,17 @@ int GetSpendHeight(const CCoinsViewCache& inputs)
 static CuckooCache::cache<uint256, SignatureCacheHasher> scriptExecutionCache;
 static uint256 scriptExecutionCacheNonce(GetRandHash());
 
+/** The key of a transaction's scripts checked with the given flags in scriptExecutionCache */
+static uint256 GetScriptExecutionCacheEntry(const CTransaction& tx, unsigned int flags)
+{
+    uint256 hashCacheEntry;
+    // We only use the first 19 bytes of nonce to avoid a second SHA
+    // round - giving us 19 + 32 + 4 = 55 bytes (+ 8 + 1 = 64)
+    static_assert(55 - sizeof(flags) - 32 >= 128/8, "Want at least 128 bits of nonce for script execution cache");
+    CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+    return hashCacheEntry;
+}
+
 void InitScriptExecutionCache() {
     // nMaxCacheSize is unsigned. If -maxsigcachesize is set to zero,
     // setup_bytes creates the minimum possible cache (2 elements).
@@ -1470,11 +1685,7 @@ bool CheckInputs(const CTransaction& tx, CValidationState &state, const CCoinsVi
             // correct (ie that the transaction hash which is in tx's prevouts
             // properly commits to the scriptPubKey in the inputs view of that
             // transaction).
-            uint256 hashCacheEntry;
-            // We only use the first 19 bytes of nonce to avoid a second SHA
-            // round - giving us 19 + 32 + 4 = 55 bytes (+ 8 + 1 = 64)
-            static_assert(55 - sizeof(flags) - 32 >= 128/8, "Want at least 128 bits of nonce for script execution cache");
-            CSHA256().Write(scriptExecutionCacheNonce.begin(), 55 - sizeof(flags) - 32).Write(tx.GetWitnessHash().begin(), 32).Write((unsigned char*)&flags, sizeof(flags)).Finalize(hashCacheEntry.begin());
+            uint256 hashCacheEntry = GetScriptExecutionCacheEntry(tx, flags);
             AssertLockHeld(cs_main); //TODO: Remove this requirement by making CuckooCache not require external locks
             if (scriptExecutionCache.contains(hashCacheEntry, !cacheFullScriptStore)) {
                 return true;
@@ -1561,6 +1772,8 @@ bool UndoWriteToDisk(const CBlockUndo& blockundo, CDiskBlockPos& pos, const uint
     return true;
 }
 
+} // namespace
+
 bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock)
 {
     // Open history file to read
@@ -1587,6 +1800,8 @@ bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uin
     return true;
 }
 
+namespace {
+
 /** Abort with a message */
 bool AbortNode(const std::string& strMessage, const std::string& userMessage="")
 {
@@ -1670,7 +1885,7 @@ int ApplyTxInUndo(Coin&& undo, CCoinsViewCache& view, const COutPoint& out, CAss
 
 /** Undo the effects of this block (with given index) on the UTXO set represented by coins.
  *  When FAILED is returned, view is left in an indeterminate state. */
-static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAssetsCache* assetsCache = nullptr, bool ignoreAddressIndex = false)
+static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex* pindex, CCoinsViewCache& view, CAssetsCache* assetsCache = nullptr)
 {
     bool fClean = true;
 
@@ -1695,10 +1910,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
         error("DisconnectBlock(): block asset undo data inconsistent");
         return DISCONNECT_FAILED;
     }
-    
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
 
     // undo transactions in reverse order
     CAssetsCache tempCache(*assetsCache);
@@ -1708,61 +1919,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
         bool is_coinbase = tx.IsCoinBase();
 
         std::vector<int> vAssetTxIndex;
-        if (fAddressIndex) {
-
-            for (unsigned int k = tx.vout.size(); k-- > 0;) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // undo receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, k, false), out.nValue));
-
-                    // undo unspent index
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), hash, k), CAddressUnspentValue()));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin()+1, out.scriptPubKey.end()-1));
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, k, false), out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, k), CAddressUnspentValue()));
-                } else {
-                    /** RVN START */
-                    if (AreAssetsDeployed()) {
-                        std::string assetName;
-                        CAmount assetAmount;
-                        uint160 hashBytes;
-
-                        if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << hash.GetHex() << ", " << k << ", " << "true" << ", " << assetAmount << std::endl;
-
-                            // undo receiving activity
-                            addressIndex.push_back(std::make_pair(
-                                    CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, k,
-                                                     false), assetAmount));
-
-                            // undo unspent index
-                            addressUnspentIndex.push_back(
-                                    std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), assetName, hash, k),
-                                                   CAddressUnspentValue()));
-                        } else {
-                            continue;
-                        }
-                    }
-                    /** RVN END */
-                }
-            }
-        }
 
         // Check that all outputs are available and match the outputs in the block itself
         // exactly.
@@ -1891,67 +2047,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
                 int res = ApplyTxInUndo(std::move(undo), view, out, assetsCache); /** RVN START */ /* Pass assetsCache into ApplyTxInUndo function */ /** RVN END */
                 if (res == DISCONNECT_FAILED) return DISCONNECT_FAILED;
                 fClean = fClean && res != DISCONNECT_UNCLEAN;
-
-                const CTxIn input = tx.vin[j];
-
-                if (fSpentIndex) {
-                    // undo and delete the spent index
-                    spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue()));
-                }
-
-                if (fAddressIndex) {
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
-
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        std::vector<unsigned char> hashBytes(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23);
-
-                        // undo spending activity
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, hash, j, true), prevout.nValue * -1));
-
-                        // restore unspent index
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), input.prevout.hash, input.prevout.n), CAddressUnspentValue(prevout.nValue, prevout.scriptPubKey, undo.nHeight)));
-
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        uint160 hashBytes(Hash160(prevout.scriptPubKey.begin()+1, prevout.scriptPubKey.end()-1));
-                        addressIndex.push_back(std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, hash, j, false), prevout.nValue));
-                        addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, hash, j), CAddressUnspentValue()));
-                    } else {
-                        /** RVN START */
-                        if (AreAssetsDeployed()) {
-                            std::string assetName;
-                            CAmount assetAmount;
-                            uint160 hashBytes;
-
-                            if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                                std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                          << ", " << i << ", " << hash.GetHex() << ", " << j << ", " << "true" << ", " << assetAmount * -1 << std::endl;
-
-                                // undo spending activity
-                                addressIndex.push_back(std::make_pair(
-                                        CAddressIndexKey(1, uint160(hashBytes), assetName, pindex->nHeight, i, hash, j,
-                                                         true), assetAmount * -1));
-
-                                // restore unspent index
-                                addressUnspentIndex.push_back(std::make_pair(
-                                        CAddressUnspentKey(1, uint160(hashBytes), assetName, input.prevout.hash,
-                                                           input.prevout.n),
-                                        CAddressUnspentValue(assetAmount, prevout.scriptPubKey, undo.nHeight)));
-                            } else {
-                                continue;
-                            }
-                        }
-                        /** RVN END */
-                    }
-                }
             }
             // At this point, all of txundo.vprevout should have been moved out.
         }
@@ -1961,17 +2056,6 @@ static DisconnectResult DisconnectBlock(const CBlock& block, const CBlockIndex*
     // move best block pointer to prevout block
     view.SetBestBlock(pindex->pprev->GetBlockHash());
 
-    if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->EraseAddressIndex(addressIndex)) {
-            error("Failed to delete address index");
-            return DISCONNECT_FAILED;
-        }
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            error("Failed to write address unspent index");
-            return DISCONNECT_FAILED;
-        }
-    }
-
     return fClean ? DISCONNECT_OK : DISCONNECT_UNCLEAN;
 }
 
@@ -2007,6 +2091,128 @@ void ThreadScriptCheck() {
     scriptcheckqueue.Thread();
 }
 
+/** Run the script checks of a transaction outside of ConnectBlock. Needs cs_main, like ConnectBlock's use of the queue. */
+static bool RunScriptChecks(std::vector<CScriptCheck>& vChecks)
+{
+    AssertLockHeld(cs_main);
+    CCheckQueueControl<CScriptCheck> control(&scriptcheckqueue);
+    control.Add(vChecks);
+    return control.Wait();
+}
+
+/**
+ * Verify the scripts of the transactions of disconnected blocks that are about
+ * to go back through AcceptToMemoryPool one by one, on the script check threads
+ * and across transactions. Relayed transactions are not batched: they reach
+ * AcceptToMemoryPool one at a time under cs_main. Inputs may come from the chain, the mempool or an earlier
+ * transaction of the batch. When the whole batch passes, each transaction is
+ * added to the script execution cache with the mempool flags, so its
+ * CheckInputs in AcceptToMemoryPool does not run the scripts again. When any
+ * check fails nothing is cached and the transactions are checked one by one.
+ */
+static void PrecheckReorgTransactionScripts(const std::vector<CTransactionRef>& vtx)
+{
+    AssertLockHeld(cs_main);
+    if (!nScriptCheckThreads || vtx.size() < 2)
+        return;
+
+    const unsigned int flags = GetMempoolScriptVerifyFlags(Params());
+    LOCK(mempool.cs);
+    CCoinsViewMemPool viewMemPool(pcoinsTip, mempool);
+    CCoinsViewCache view(&viewMemPool);
+    std::vector<PrecomputedTransactionData> vTxData;
+    vTxData.reserve(vtx.size());
+    std::vector<CScriptCheck> vChecks;
+    std::vector<const CTransaction*> vChecked;
+    for (const CTransactionRef& ptx : vtx) {
+        const CTransaction& tx = *ptx;
+        if (tx.IsCoinBase())
+            continue;
+        bool fHaveInputs = true;
+        for (const CTxIn& txin : tx.vin) {
+            if (!view.HaveCoin(txin.prevout)) {
+                fHaveInputs = false;
+                break;
+            }
+        }
+        if (fHaveInputs) {
+            vTxData.emplace_back(tx);
+            for (unsigned int i = 0; i < tx.vin.size(); i++)
+                vChecks.emplace_back(view.AccessCoin(tx.vin[i].prevout).out, tx, i, flags, true, &vTxData.back());
+            vChecked.push_back(&tx);
+        }
+        AddCoins(view, tx, MEMPOOL_HEIGHT, uint256(), true);
+    }
+    if (!RunScriptChecks(vChecks))
+        return;
+    for (const CTransaction* ptx : vChecked)
+        scriptExecutionCache.insert(GetScriptExecutionCacheEntry(*ptx, flags));
+}
+
+static CCheckQueue<CTxInputsCheck> inputcheckqueue(128);
+
+void ThreadInputCheck() {
+    RenameThread("raven-inputch");
+    inputcheckqueue.Thread();
+}
+
+bool CTxInputsCheck::operator()() {
+    const CTransaction &tx = *ptxTo;
+    CTxInputsCheckResult &result = *pResult;
+
+    // Private view over the snapshotted coins, the shared caches are only touched by the validation thread
+    CCoinsView viewDummy;
+    CCoinsViewCache view(&viewDummy);
+    std::vector<int> prevheights(tx.vin.size());
+    for (size_t j = 0; j < tx.vin.size(); j++) {
+        prevheights[j] = vCoins[j].nHeight;
+        if (!vCoins[j].IsSpent())
+            view.AddCoin(tx.vin[j].prevout, std::move(vCoins[j]), true);
+    }
+
+    result.fDone = true;
+    if (!Consensus::CheckTxInputs(tx, result.state, view, pindex->nHeight, result.nFee)) {
+        result.failed = CTxInputsCheckResult::INPUTS;
+        return true;
+    }
+
+    if (fCheckAssets) {
+        result.fAssetsChecked = true;
+        if (!Consensus::CheckTxAssets(tx, result.state, view)) {
+            result.failed = CTxInputsCheckResult::ASSETS;
+            return true;
+        }
+    }
+
+    if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, *pindex)) {
+        result.failed = CTxInputsCheckResult::SEQUENCE_LOCKS;
+        return true;
+    }
+
+    result.nSigOpsCost = GetTransactionSigOpCost(tx, view, nFlags);
+    return true;
+}
+
+std::vector<bool> FindIndependentBlockTransactions(const CBlock& block)
+{
+    std::vector<bool> vIndependent(block.vtx.size(), false);
+    std::set<uint256> setBlockTxids;
+    std::set<COutPoint> setSpent;
+    for (unsigned int i = 0; i < block.vtx.size(); i++) {
+        const CTransaction &tx = *(block.vtx[i]);
+        if (!tx.IsCoinBase()) {
+            bool fIndependent = true;
+            for (const CTxIn& txin : tx.vin) {
+                if (setBlockTxids.count(txin.prevout.hash) || !setSpent.insert(txin.prevout).second)
+                    fIndependent = false;
+            }
+            vIndependent[i] = fIndependent;
+        }
+        setBlockTxids.insert(tx.GetHash());
+    }
+    return vIndependent;
+}
+
 // Protected by cs_main
 VersionBitsCache versionbitscache;
 
@@ -2104,7 +2310,8 @@ static int64_t nBlocksTotal = 0;
  *  Validity checks that depend on the UTXO set are also done; ConnectBlock()
  *  can fail if those validity checks fail (among other reasons). */
 static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockIndex* pindex,
-                  CCoinsViewCache& view, const CChainParams& chainparams, CAssetsCache* assetsCache = nullptr, bool fJustCheck = false, bool ignoreAddressIndex = false)
+                  CCoinsViewCache& view, const CChainParams& chainparams, CAssetsCache* assetsCache = nullptr, bool fJustCheck = false,
+                  bool fCheckBlock = true)
 {
 
     AssertLockHeld(cs_main);
@@ -2115,7 +2322,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     int64_t nTimeStart = GetTimeMicros();
 
     // Check it again in case a previous version let a bad block in
-    if (!CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck, !fJustCheck,
+    // (TestBlockValidity has just run the full CheckBlock itself)
+    if (fCheckBlock && !CheckBlock(block, state, chainparams.GetConsensus(), !fJustCheck, !fJustCheck, !fJustCheck,
                     !fJustCheck)) // Force the check of asset duplicates when connecting the block
         return error("%s: Consensus::CheckBlock: %s", __func__, FormatStateMessage(state));
 
@@ -2160,6 +2368,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     }
 
     int64_t nTime1 = GetTimeMicros(); nTimeCheck += nTime1 - nTimeStart;
+    blockConnectStats.Record(CONNECT_STAGE_SANITY_CHECKS, nTime1 - nTimeStart);
     LogPrint(BCLog::BENCH, "    - Sanity checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime1 - nTimeStart), nTimeCheck * MICRO, nTimeCheck * MILLI / nBlocksTotal);
 
     // Do not allow blocks that contain transactions which 'overwrite' older transactions,
@@ -2210,6 +2419,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     unsigned int flags = GetBlockScriptFlags(pindex, chainparams.GetConsensus());
 
     int64_t nTime2 = GetTimeMicros(); nTimeForks += nTime2 - nTime1;
+    blockConnectStats.Record(CONNECT_STAGE_FORK_CHECKS, nTime2 - nTime1);
     LogPrint(BCLog::BENCH, "    - Fork checks: %.2fms [%.2fs (%.2fms/blk)]\n", MILLI * (nTime2 - nTime1), nTimeForks * MICRO, nTimeForks * MILLI / nBlocksTotal);
 
     CBlockUndo blockundo;
@@ -2228,21 +2438,57 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     std::vector<PrecomputedTransactionData> txdata;
     txdata.reserve(block.vtx.size()); // Required so that pointers to individual PrecomputedTransactionData don't get invalidated
 
-    std::vector<std::pair<CAddressIndexKey, CAmount> > addressIndex;
-    std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > addressUnspentIndex;
-    std::vector<std::pair<CSpentIndexKey, CSpentIndexValue> > spentIndex;
+    // With -parallelconnect the input checks of transactions that only spend coins from before
+    // this block are run on the check threads up front. Their coins are snapshotted here as the
+    // view is not thread-safe; everything touching the view or the asset caches stays in the loop below.
+    int64_t nTimeAssetChecks = 0;
+    std::vector<CTxInputsCheckResult> vInputsResults;
+    if (fParallelConnect && nScriptCheckThreads && block.vtx.size() > 2) {
+        vInputsResults.resize(block.vtx.size());
+        std::vector<bool> vIndependent = FindIndependentBlockTransactions(block);
+        std::vector<CTxInputsCheck> vInputsChecks;
+        vInputsChecks.reserve(block.vtx.size());
+        for (unsigned int i = 0; i < block.vtx.size(); i++) {
+            if (!vIndependent[i])
+                continue;
+            const CTransaction &tx = *(block.vtx[i]);
+            std::vector<Coin> vCoins;
+            vCoins.reserve(tx.vin.size());
+            for (const CTxIn& txin : tx.vin)
+                vCoins.push_back(view.AccessCoin(txin.prevout));
+
+            // Transfers and reissues are checked against the current asset cache, keep those serial
+            bool fCheckAssets = AreAssetsDeployed();
+            for (const CTxOut& out : tx.vout) {
+                if (out.scriptPubKey.IsTransferAsset() || out.scriptPubKey.IsReissueAsset()) {
+                    fCheckAssets = false;
+                    break;
+                }
+            }
+            vInputsChecks.emplace_back(tx, std::move(vCoins), pindex, nLockTimeFlags, flags, fCheckAssets, &vInputsResults[i]);
+        }
+        CCheckQueueControl<CTxInputsCheck> inputscontrol(&inputcheckqueue);
+        inputscontrol.Add(vInputsChecks);
+        inputscontrol.Wait();
+    }
 
     for (unsigned int i = 0; i < block.vtx.size(); i++)
     {
         const CTransaction &tx = *(block.vtx[i]);
-        const uint256 txhash = tx.GetHash();
+        const CTxInputsCheckResult* pInputsResult = (!vInputsResults.empty() && vInputsResults[i].fDone) ? &vInputsResults[i] : nullptr;
 
         nInputs += tx.vin.size();
 
         if (!tx.IsCoinBase())
         {
             CAmount txfee = 0;
-            if (!Consensus::CheckTxInputs(tx, state, view, pindex->nHeight, txfee)) {
+            if (pInputsResult) {
+                if (pInputsResult->failed == CTxInputsCheckResult::INPUTS) {
+                    state = pInputsResult->state;
+                    return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
+                }
+                txfee = pInputsResult->nFee;
+            } else if (!Consensus::CheckTxInputs(tx, state, view, pindex->nHeight, txfee)) {
                 return error("%s: Consensus::CheckTxInputs: %s, %s", __func__, tx.GetHash().ToString(), FormatStateMessage(state));
             }
             nFees += txfee;
@@ -2259,99 +2505,51 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             }
 
             if (AreAssetsDeployed()) {
-                std::vector<std::pair<std::string, uint256>> vReissueAssets;
-                if (!Consensus::CheckTxAssets(tx, state, view, vReissueAssets)) {
-                    return error("%s: Consensus::CheckTxAssets: %s, %s", __func__, tx.GetHash().ToString(),
-                                 FormatStateMessage(state));
+                if (pInputsResult && pInputsResult->fAssetsChecked) {
+                    if (pInputsResult->failed == CTxInputsCheckResult::ASSETS) {
+                        state = pInputsResult->state;
+                        return error("%s: Consensus::CheckTxAssets: %s, %s", __func__, tx.GetHash().ToString(),
+                                     FormatStateMessage(state));
+                    }
+                } else {
+                    if (!Consensus::CheckTxAssets(tx, state, view)) {
+                        return error("%s: Consensus::CheckTxAssets: %s, %s", __func__, tx.GetHash().ToString(),
+                                     FormatStateMessage(state));
+                    }
                 }
+
+                // A reissue may not be chained onto a different reissue of the same asset in the mempool
+                if (HasMempoolReissueConflict(mempool, tx))
+                    return state.DoS(100, error("%s: reissue of %s conflicts with a reissue in the mempool", __func__, tx.GetHash().ToString()),
+                                     REJECT_INVALID, "bad-tx-reissue-chaining-not-allowed");
             }
             /** RVN END */
 
             // Check that transaction is BIP68 final
             // BIP68 lock checks (as opposed to nLockTime checks) must
             // be in ConnectBlock because they require the UTXO set
-            prevheights.resize(tx.vin.size());
-            for (size_t j = 0; j < tx.vin.size(); j++) {
-                prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
+            bool fSequenceLocks;
+            if (pInputsResult) {
+                fSequenceLocks = pInputsResult->failed != CTxInputsCheckResult::SEQUENCE_LOCKS;
+            } else {
+                prevheights.resize(tx.vin.size());
+                for (size_t j = 0; j < tx.vin.size(); j++) {
+                    prevheights[j] = view.AccessCoin(tx.vin[j].prevout).nHeight;
+                }
+                fSequenceLocks = SequenceLocks(tx, nLockTimeFlags, &prevheights, *pindex);
             }
 
-            if (!SequenceLocks(tx, nLockTimeFlags, &prevheights, *pindex)) {
+            if (!fSequenceLocks) {
                 return state.DoS(100, error("%s: contains a non-BIP68-final transaction", __func__),
                                  REJECT_INVALID, "bad-txns-nonfinal");
             }
-
-            if (fAddressIndex || fSpentIndex)
-            {
-                for (size_t j = 0; j < tx.vin.size(); j++) {
-
-                    const CTxIn input = tx.vin[j];
-                    const CTxOut &prevout = view.AccessCoin(tx.vin[j].prevout).out;
-                    uint160 hashBytes;
-                    int addressType;
-                    bool isAsset = false;
-                    std::string assetName;
-                    CAmount assetAmount;
-
-                    if (prevout.scriptPubKey.IsPayToScriptHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+2, prevout.scriptPubKey.begin()+22));
-                        addressType = 2;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKeyHash()) {
-                        hashBytes = uint160(std::vector <unsigned char>(prevout.scriptPubKey.begin()+3, prevout.scriptPubKey.begin()+23));
-                        addressType = 1;
-                    } else if (prevout.scriptPubKey.IsPayToPublicKey()) {
-                        hashBytes = Hash160(prevout.scriptPubKey.begin() + 1, prevout.scriptPubKey.end() - 1);
-                        addressType = 1;
-                    } else {
-                        /** RVN START */
-                        if (AreAssetsDeployed()) {
-                            hashBytes.SetNull();
-                            addressType = 0;
-
-                            if (ParseAssetScript(prevout.scriptPubKey, hashBytes, assetName, assetAmount)) {
-                                addressType = 1;
-                                isAsset = true;
-                            }
-                        }
-                        /** RVN END */
-                    }
-
-                    if (fAddressIndex && addressType > 0) {
-                        /** RVN START */
-                        if (isAsset) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << j << ", " << "true" << ", " << assetAmount * -1 << std::endl;
-
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, assetName, pindex->nHeight, i, txhash, j, true), assetAmount * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, assetName, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        /** RVN END */
-                        } else {
-                            // record spending activity
-                            addressIndex.push_back(std::make_pair(CAddressIndexKey(addressType, hashBytes, pindex->nHeight, i, txhash, j, true), prevout.nValue * -1));
-
-                            // remove address from unspent index
-                            addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(addressType, hashBytes, input.prevout.hash, input.prevout.n), CAddressUnspentValue()));
-                        }
-                    }
-                    /** RVN END */
-
-                    if (fSpentIndex) {
-                        // add the spent index to determine the txid and input that spent an output
-                        // and to find the amount and address from an input
-                        spentIndex.push_back(std::make_pair(CSpentIndexKey(input.prevout.hash, input.prevout.n), CSpentIndexValue(txhash, j, pindex->nHeight, prevout.nValue, addressType, hashBytes)));
-                    }
-                }
-
-            }
         }
 
         // GetTransactionSigOpCost counts 3 types of sigops:
         // * legacy (always)
         // * p2sh (when P2SH enabled in flags and excludes coinbase)
         // * witness (when witness enabled in flags and excludes coinbase)
-        nSigOpsCost += GetTransactionSigOpCost(tx, view, flags);
+        nSigOpsCost += pInputsResult ? pInputsResult->nSigOpsCost : GetTransactionSigOpCost(tx, view, flags);
         if (nSigOpsCost > MAX_BLOCK_SIGOPS_COST)
             return state.DoS(100, error("ConnectBlock(): too many sigops"),
                              REJECT_INVALID, "bad-blk-sigops");
@@ -2368,6 +2566,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         }
 
         /** RVN START */
+        int64_t nTimeAssetChecksStart = GetTimeMicros();
         if (assetsCache) {
             if (tx.IsNewAsset())
             {
@@ -2433,67 +2632,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
                 }
             }
         }
+        nTimeAssetChecks += GetTimeMicros() - nTimeAssetChecksStart;
         /** RVN END */
-        if (fAddressIndex) {
-            for (unsigned int k = 0; k < tx.vout.size(); k++) {
-                const CTxOut &out = tx.vout[k];
-
-                if (out.scriptPubKey.IsPayToScriptHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+2, out.scriptPubKey.begin()+22);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(2, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(2, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKeyHash()) {
-                    std::vector<unsigned char> hashBytes(out.scriptPubKey.begin()+3, out.scriptPubKey.begin()+23);
-
-                    // record receiving activity
-                    addressIndex.push_back(std::make_pair(CAddressIndexKey(1, uint160(hashBytes), pindex->nHeight, i, txhash, k, false), out.nValue));
-
-                    // record unspent output
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, uint160(hashBytes), txhash, k), CAddressUnspentValue(out.nValue, out.scriptPubKey, pindex->nHeight)));
-
-                } else if (out.scriptPubKey.IsPayToPublicKey()) {
-                    uint160 hashBytes(Hash160(out.scriptPubKey.begin() + 1, out.scriptPubKey.end() - 1));
-                    addressIndex.push_back(
-                            std::make_pair(CAddressIndexKey(1, hashBytes, pindex->nHeight, i, txhash, k, false),
-                                           out.nValue));
-                    addressUnspentIndex.push_back(std::make_pair(CAddressUnspentKey(1, hashBytes, txhash, k),
-                                                                 CAddressUnspentValue(out.nValue, out.scriptPubKey,
-                                                                                      pindex->nHeight)));
-                } else {
-                    /** RVN START */
-                    if (AreAssetsDeployed()) {
-                        std::string assetName;
-                        CAmount assetAmount;
-                        uint160 hashBytes;
-
-                        if (ParseAssetScript(out.scriptPubKey, hashBytes, assetName, assetAmount)) {
-//                            std::cout << "ConnectBlock(): pushing assets onto addressIndex: " << "1" << ", " << hashBytes.GetHex() << ", " << assetName << ", " << pindex->nHeight
-//                                      << ", " << i << ", " << txhash.GetHex() << ", " << k << ", " << "true" << ", " << assetAmount << std::endl;
-
-                            // record receiving activity
-                            addressIndex.push_back(std::make_pair(
-                                    CAddressIndexKey(1, hashBytes, assetName, pindex->nHeight, i, txhash, k, false),
-                                    assetAmount));
-
-                            // record unspent output
-                            addressUnspentIndex.push_back(
-                                    std::make_pair(CAddressUnspentKey(1, hashBytes, assetName, txhash, k),
-                                                   CAddressUnspentValue(assetAmount, out.scriptPubKey,
-                                                                        pindex->nHeight)));
-                        }
-                    } else {
-                        continue;
-                    }
-                    /** RVN END */
-                }
-            }
-        }
-
         CTxUndo undoDummy;
         if (i > 0) {
             blockundo.vtxundo.push_back(CTxUndo());
@@ -2516,6 +2656,8 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
         pos.nTxOffset += ::GetSerializeSize(tx, SER_DISK, CLIENT_VERSION);
     }
     int64_t nTime3 = GetTimeMicros(); nTimeConnect += nTime3 - nTime2;
+    blockConnectStats.Record(CONNECT_STAGE_CONNECT_TXS, nTime3 - nTime2);
+    blockConnectStats.Record(CONNECT_STAGE_ASSET_CHECKS, nTimeAssetChecks);
     LogPrint(BCLog::BENCH, "      - Connect %u transactions: %.2fms (%.3fms/tx, %.3fms/txin) [%.2fs (%.2fms/blk)]\n", (unsigned)block.vtx.size(), MILLI * (nTime3 - nTime2), MILLI * (nTime3 - nTime2) / block.vtx.size(), nInputs <= 1 ? 0 : MILLI * (nTime3 - nTime2) / (nInputs-1), nTimeConnect * MICRO, nTimeConnect * MILLI / nBlocksTotal);
 
     CAmount blockReward = nFees + GetBlockSubsidy(pindex->nHeight, chainparams.GetConsensus());
@@ -2528,6 +2670,7 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
     if (!control.Wait())
         return state.DoS(100, error("%s: CheckQueue failed", __func__), REJECT_INVALID, "block-validation-failed");
     int64_t nTime4 = GetTimeMicros(); nTimeVerify += nTime4 - nTime2;
+    blockConnectStats.Record(CONNECT_STAGE_VERIFY_SCRIPTS, nTime4 - nTime2);
     LogPrint(BCLog::BENCH, "    - Verify %u txins: %.2fms (%.3fms/txin) [%.2fs (%.2fms/blk)]\n", nInputs - 1, MILLI * (nTime4 - nTime2), nInputs <= 1 ? 0 : MILLI * (nTime4 - nTime2) / (nInputs-1), nTimeVerify * MICRO, nTimeVerify * MILLI / nBlocksTotal);
 
     if (fJustCheck)
@@ -2547,54 +2690,25 @@ static bool ConnectBlock(const CBlock& block, CValidationState& state, CBlockInd
             pindex->nUndoPos = _pos.nPos;
             pindex->nStatus |= BLOCK_HAVE_UNDO;
         }
+        int64_t nTimeUndoDone = GetTimeMicros();
+        blockConnectStats.Record(CONNECT_STAGE_UNDO_WRITE, nTimeUndoDone - nTime4);
 
         if (vUndoAssetData.size()) {
             if (!passetsdb->WriteBlockUndoAssetData(block.GetHash(), vUndoAssetData))
                 return AbortNode(state, "Failed to write asset undo data");
         }
+        blockConnectStats.Record(CONNECT_STAGE_ASSET_UNDO_WRITE, GetTimeMicros() - nTimeUndoDone);
 
         pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
         setDirtyBlockIndex.insert(pindex);
     }
 
+    int64_t nTimeIndexStart = GetTimeMicros();
     if (fTxIndex)
         if (!pblocktree->WriteTxIndex(vPos))
             return AbortNode(state, "Failed to write transaction index");
+    blockConnectStats.Record(CONNECT_STAGE_TXINDEX_WRITE, GetTimeMicros() - nTimeIndexStart);
 
-    if (!ignoreAddressIndex && fAddressIndex) {
-        if (!pblocktree->WriteAddressIndex(addressIndex)) {
-            return AbortNode(state, "Failed to write address index");
-        }
-
-        if (!pblocktree->UpdateAddressUnspentIndex(addressUnspentIndex)) {
-            return AbortNode(state, "Failed to write address unspent index");
-        }
-    }
-
-    if (!ignoreAddressIndex && fSpentIndex)
-        if (!pblocktree->UpdateSpentIndex(spentIndex))
-            return AbortNode(state, "Failed to write transaction index");
-
-    if (!ignoreAddressIndex && fTimestampIndex) {
-        unsigned int logicalTS = pindex->nTime;
-        unsigned int prevLogicalTS = 0;
-
-        // retrieve logical timestamp of the previous block
-        if (pindex->pprev)
-            if (!pblocktree->ReadTimestampBlockIndex(pindex->pprev->GetBlockHash(), prevLogicalTS))
-                LogPrintf("%s: Failed to read previous block's logical timestamp\n", __func__);
-
-        if (logicalTS <= prevLogicalTS) {
-            logicalTS = prevLogicalTS + 1;
-            LogPrintf("%s: Previous logical timestamp is newer Actual[%d] prevLogical[%d] Logical[%d]\n", __func__, pindex->nTime, prevLogicalTS, logicalTS);
-        }
-
-        if (!pblocktree->WriteTimestampIndex(CTimestampIndexKey(logicalTS, pindex->GetBlockHash())))
-            return AbortNode(state, "Failed to write timestamp index");
-
-        if (!pblocktree->WriteTimestampBlockIndex(CTimestampBlockIndexKey(pindex->GetBlockHash()), CTimestampBlockIndexValue(logicalTS)))
-            return AbortNode(state, "Failed to write blockhash index");
-    }
     assert(pindex->phashBlock);
     // add this block to the view's block chain
     view.SetBestBlock(pindex->GetBlockHash());
@@ -2746,9 +2860,6 @@ bool static FlushStateToDisk(const CChainParams& chainparams, CValidationState &
                 }
             }
 
-            // Write the reissue mempool data to database
-            if (passetsdb)
-                passetsdb->WriteReissuedMempoolState();
             /** RVN END */
 
             nLastFlush = nNow;
@@ -2905,10 +3016,10 @@ bool static DisconnectTip(CValidationState& state, const CChainParams& chainpara
 }
 
 static int64_t nTimeReadFromDisk = 0;
+static int64_t nTimePrefetch = 0;
 static int64_t nTimeConnectTotal = 0;
 static int64_t nTimeFlush = 0;
 static int64_t nTimeAssetFlush = 0;
-static int64_t nTimeAssetTasks = 0;
 static int64_t nTimeChainState = 0;
 static int64_t nTimePostConnect = 0;
 
@@ -2977,6 +3088,86 @@ public:
     }
 };
 
+namespace {
+/** Closure reading one coin from the chainstate database into a slot owned by the caller */
+class CCoinPrefetch
+{
+private:
+    const CCoinsView *pview;
+    COutPoint outpoint;
+    Coin *pcoin;
+
+public:
+    CCoinPrefetch(): pview(nullptr), pcoin(nullptr) {}
+    CCoinPrefetch(const CCoinsView* pviewIn, const COutPoint& outpointIn, Coin* pcoinIn) : pview(pviewIn), outpoint(outpointIn), pcoin(pcoinIn) {}
+
+    bool operator()() {
+        // A failed read leaves the slot spent; the validation thread will then read
+        // the coin itself and handle database errors as usual. Nothing may be thrown
+        // from a worker thread, so database errors count as a miss here.
+        try {
+            pview->GetCoin(outpoint, *pcoin);
+        } catch (const dbwrapper_error& e) {
+            pcoin->Clear();
+        }
+        return true;
+    }
+
+    void swap(CCoinPrefetch &prefetch) {
+        std::swap(pview, prefetch.pview);
+        std::swap(outpoint, prefetch.outpoint);
+        std::swap(pcoin, prefetch.pcoin);
+    }
+};
+} // namespace
+
+static CCheckQueue<CCoinPrefetch> prefetchqueue(16);
+
+void ThreadInputPrefetch() {
+    RenameThread("raven-prefetch");
+    prefetchqueue.Thread();
+}
+
+/**
+ * Warm pcoinsTip with the coins spent by a block that are not cached yet, reading them
+ * from the chainstate database on the prefetch threads. LevelDB reads are thread-safe,
+ * the cache itself is only written here, on the validation thread.
+ */
+static void PrefetchBlockInputs(const CBlock& block)
+{
+    AssertLockHeld(cs_main);
+    if (!nBlockPrefetchThreads || !pcoinsdbview)
+        return;
+
+    std::set<uint256> setBlockTxids;
+    std::vector<COutPoint> vOutPoints;
+    for (const auto& ptx : block.vtx) {
+        if (!ptx->IsCoinBase()) {
+            for (const CTxIn& txin : ptx->vin) {
+                if (!setBlockTxids.count(txin.prevout.hash) && !pcoinsTip->HaveCoinInCache(txin.prevout))
+                    vOutPoints.push_back(txin.prevout);
+            }
+        }
+        setBlockTxids.insert(ptx->GetHash());
+    }
+    if (vOutPoints.empty())
+        return;
+
+    std::vector<Coin> vCoins(vOutPoints.size());
+    {
+        std::vector<CCoinPrefetch> vPrefetch;
+        vPrefetch.reserve(vOutPoints.size());
+        for (size_t i = 0; i < vOutPoints.size(); i++)
+            vPrefetch.emplace_back(pcoinsdbview, vOutPoints[i], &vCoins[i]);
+        CCheckQueueControl<CCoinPrefetch> control(&prefetchqueue);
+        control.Add(vPrefetch);
+        control.Wait();
+    }
+
+    for (size_t i = 0; i < vOutPoints.size(); i++)
+        pcoinsTip->ImportCoin(vOutPoints[i], std::move(vCoins[i]));
+}
+
 /**
  * Connect a new block to chainActive. pblock is either nullptr or a pointer to a CBlock
  * corresponding to pindexNew, to bypass loading it again from disk.
@@ -2986,6 +3177,7 @@ public:
 bool static ConnectTip(CValidationState& state, const CChainParams& chainparams, CBlockIndex* pindexNew, const std::shared_ptr<const CBlock>& pblock, ConnectTrace& connectTrace, DisconnectedBlockTransactions &disconnectpool)
 {
     assert(pindexNew->pprev == chainActive.Tip());
+    blockConnectStats.BeginBlock();
     // Read block from disk.
     int64_t nTime1 = GetTimeMicros();
     std::shared_ptr<const CBlock> pthisBlock;
@@ -3004,11 +3196,12 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime4;
     int64_t nTimeAssetsFlush;
     LogPrint(BCLog::BENCH, "  - Load block from disk: %.2fms [%.2fs]\n", (nTime2 - nTime1) * MILLI, nTimeReadFromDisk * MICRO);
+    blockConnectStats.Record(CONNECT_STAGE_LOAD_BLOCK, nTime2 - nTime1);
 
-    /** RVN START */
-    // Initialize sets used from removing asset entries from the mempool
-    std::set<CAssetCacheNewAsset> setNewAssetsAddedInBlock;
-    /** RVN END */
+    PrefetchBlockInputs(blockConnecting);
+    int64_t nTimePrefetchDone = GetTimeMicros(); nTimePrefetch += nTimePrefetchDone - nTime2;
+    LogPrint(BCLog::BENCH, "  - Prefetch inputs: %.2fms [%.2fs]\n", (nTimePrefetchDone - nTime2) * MILLI, nTimePrefetch * MICRO);
+    blockConnectStats.Record(CONNECT_STAGE_PREFETCH_INPUTS, nTimePrefetchDone - nTime2);
 
     {
         CCoinsViewCache view(pcoinsTip);
@@ -3031,34 +3224,12 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         int64_t nTimeConnectDone = GetTimeMicros();
         LogPrint(BCLog::BENCH, "  - Connect Block only time: %.2fms [%.2fs (%.2fms/blk)]\n", (nTimeConnectDone - nTimeConnectStart) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
 
-
-        int64_t nTimeAssetsStart = GetTimeMicros();
-        /** RVN START */
-        // Get the newly created assets, from the connectblock assetCache so we can remove the correct assets from the mempool
-        setNewAssetsAddedInBlock = assetCache.setNewAssetsToAdd;
-        for (auto it : passets->setNewAssetsToAdd) {
-            if (setNewAssetsAddedInBlock.count(it))
-                setNewAssetsAddedInBlock.erase(it);
-        }
-
-        // Remove all tx hashes, that were marked as reissued script from the mapReissuedTx.
-        // Without this check, you wouldn't be able to reissue for those assets again, as this maps block it
-        for (auto tx : blockConnecting.vtx) {
-            uint256 txHash = tx->GetHash();
-            if (mapReissuedTx.count(txHash)) {
-                mapReissuedAssets.erase(mapReissuedTx.at(txHash));
-                mapReissuedTx.erase(txHash);
-            }
-        }
-        int64_t nTimeAssetsEnd = GetTimeMicros(); nTimeAssetTasks += nTimeAssetsEnd - nTimeAssetsStart;
-        LogPrint(BCLog::BENCH, "  - Compute Asset Tasks total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTimeAssetsEnd - nTimeAssetsStart) * MILLI, nTimeAssetsEnd * MICRO, nTimeAssetsEnd * MILLI / nBlocksTotal);
-        /** RVN END */
-
         nTime3 = GetTimeMicros(); nTimeConnectTotal += nTime3 - nTime2;
         LogPrint(BCLog::BENCH, "  - Connect total: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime3 - nTime2) * MILLI, nTimeConnectTotal * MICRO, nTimeConnectTotal * MILLI / nBlocksTotal);
         bool flushed = view.Flush();
         assert(flushed);
         nTime4 = GetTimeMicros(); nTimeFlush += nTime4 - nTime3;
+        blockConnectStats.Record(CONNECT_STAGE_FLUSH_COINS, nTime4 - nTime3);
         LogPrint(BCLog::BENCH, "  - Flush RVN: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime4 - nTime3) * MILLI, nTimeFlush * MICRO, nTimeFlush * MILLI / nBlocksTotal);
 
         /** RVN START */
@@ -3066,17 +3237,20 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
         bool assetFlushed = assetCache.Flush();
         assert(assetFlushed);
         int64_t nTimeAssetFlushFinished = GetTimeMicros(); nTimeAssetFlush += nTimeAssetFlushFinished - nTimeAssetsFlush;
+        blockConnectStats.Record(CONNECT_STAGE_FLUSH_ASSETS, nTimeAssetFlushFinished - nTimeAssetsFlush);
         LogPrint(BCLog::BENCH, "  - Flush Assets: %.2fms [%.2fs (%.2fms/blk)]\n", (nTimeAssetFlushFinished - nTimeAssetsFlush) * MILLI, nTimeAssetFlush * MICRO, nTimeAssetFlush * MILLI / nBlocksTotal);
         /** RVN END */
     }
 
     // Write the chain state to disk, if necessary.
+    int64_t nTimeFlushStateStart = GetTimeMicros();
     if (!FlushStateToDisk(chainparams, state, FLUSH_STATE_IF_NEEDED))
         return false;
     int64_t nTime5 = GetTimeMicros(); nTimeChainState += nTime5 - nTime4;
+    blockConnectStats.Record(CONNECT_STAGE_WRITE_CHAINSTATE, nTime5 - nTimeFlushStateStart);
     LogPrint(BCLog::BENCH, "  - Writing chainstate: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime5 - nTime4) * MILLI, nTimeChainState * MICRO, nTimeChainState * MILLI / nBlocksTotal);
     // Remove conflicting transactions from the mempool.;
-    mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight, setNewAssetsAddedInBlock);
+    mempool.removeForBlock(blockConnecting.vtx, pindexNew->nHeight);
     disconnectpool.removeForBlock(blockConnecting.vtx);
     // Update chainActive & related variables.
     UpdateTip(pindexNew, chainparams);
@@ -3084,6 +3258,9 @@ bool static ConnectTip(CValidationState& state, const CChainParams& chainparams,
     int64_t nTime6 = GetTimeMicros(); nTimePostConnect += nTime6 - nTime5; nTimeTotal += nTime6 - nTime1;
     LogPrint(BCLog::BENCH, "  - Connect postprocess: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime5) * MILLI, nTimePostConnect * MICRO, nTimePostConnect * MILLI / nBlocksTotal);
     LogPrint(BCLog::BENCH, "- Connect block: %.2fms [%.2fs (%.2fms/blk)]\n", (nTime6 - nTime1) * MILLI, nTimeTotal * MICRO, nTimeTotal * MILLI / nBlocksTotal);
+    blockConnectStats.Record(CONNECT_STAGE_POSTPROCESS, nTime6 - nTime5);
+    blockConnectStats.Record(CONNECT_STAGE_TOTAL, nTime6 - nTime1);
+    blockConnectStats.CommitBlock();
 
     connectTrace.BlockConnected(pindexNew, std::move(pthisBlock));
     return true;
@@ -4127,7 +4304,7 @@ bool TestBlockValidity(CValidationState& state, const CChainParams& chainparams,
         return error("%s: Consensus::CheckBlock: %s", __func__, FormatStateMessage(state));
     if (!ContextualCheckBlock(block, state, chainparams.GetConsensus(), pindexPrev, &assetCache))
         return error("%s: Consensus::ContextualCheckBlock: %s", __func__, FormatStateMessage(state));
-    if (!ConnectBlock(block, state, &indexDummy, viewNew, chainparams, &assetCache, true)) /** RVN START */ /*Add asset to function */ /** RVN END*/
+    if (!ConnectBlock(block, state, &indexDummy, viewNew, chainparams, &assetCache, true, false)) /** RVN START */ /*Add asset to function */ /** RVN END*/
         return error("%s: Consensus::ConnectBlock: %s", __func__, FormatStateMessage(state));
     assert(state.IsValid());
 
@@ -4461,6 +4638,10 @@ bool static LoadBlockIndexDB(const CChainParams& chainparams)
     // Check whether we have a spent index
     pblocktree->ReadFlag("spentindex", fSpentIndex);
     LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
+
+    // Check whether we have a block filter index
+    pblocktree->ReadFlag("blockfilterindex", fBlockFilterIndex);
+    LogPrintf("%s: block filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
     return true;
 }
 
@@ -4561,7 +4742,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
         // check level 3: check for inconsistencies during memory-only disconnect of tip blocks
         if (nCheckLevel >= 3 && pindex == pindexState && (coins.DynamicMemoryUsage() + pcoinsTip->DynamicMemoryUsage()) <= nCoinCacheUsage) {
             assert(coins.GetBestBlock() == pindex->GetBlockHash());
-            DisconnectResult res = DisconnectBlock(block, pindex, coins, &assetCache, true);
+            DisconnectResult res = DisconnectBlock(block, pindex, coins, &assetCache);
             if (res == DISCONNECT_FAILED) {
                 return error("VerifyDB(): *** irrecoverable inconsistency in block data at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
             }
@@ -4589,7 +4770,7 @@ bool CVerifyDB::VerifyDB(const CChainParams& chainparams, CCoinsView *coinsview,
             CBlock block;
             if (!ReadBlockFromDisk(block, pindex, chainparams.GetConsensus()))
                 return error("VerifyDB(): *** ReadBlockFromDisk failed at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
-            if (!ConnectBlock(block, state, pindex, coins, chainparams, &assetCache, false, true))
+            if (!ConnectBlock(block, state, pindex, coins, chainparams, &assetCache))
                 return error("VerifyDB(): *** found unconnectable block at %d, hash=%s", pindex->nHeight, pindex->GetBlockHash().ToString());
         }
     }
@@ -4838,23 +5019,33 @@ bool LoadBlockIndex(const CChainParams& chainparams)
         // Use the provided setting for -assetindex in the new database
         fAssetIndex = gArgs.GetBoolArg("-assetindex", DEFAULT_ASSETINDEX);
         pblocktree->WriteFlag("assetindex", fAssetIndex);
+        passetsdb->WriteFlag("assetindex", fAssetIndex);
         LogPrintf("%s: asset index %s\n", __func__, fAssetIndex ? "enabled" : "disabled");
 
         // Use the provided setting for -addressindex in the new database
         fAddressIndex = gArgs.GetBoolArg("-addressindex", DEFAULT_ADDRESSINDEX);
         pblocktree->WriteFlag("addressindex", fAddressIndex);
+        pindexdb->WriteFlag("addressindex", fAddressIndex);
         LogPrintf("%s: address index %s\n", __func__, fAddressIndex ? "enabled" : "disabled");
 
         // Use the provided setting for -timestampindex in the new database
         fTimestampIndex = gArgs.GetBoolArg("-timestampindex", DEFAULT_TIMESTAMPINDEX);
         pblocktree->WriteFlag("timestampindex", fTimestampIndex);
+        pindexdb->WriteFlag("timestampindex", fTimestampIndex);
         LogPrintf("%s: timestamp index %s\n", __func__, fTimestampIndex ? "enabled" : "disabled");
 
         // Use the provided setting for -spentindex in the new database
         fSpentIndex = gArgs.GetBoolArg("-spentindex", DEFAULT_SPENTINDEX);
         pblocktree->WriteFlag("spentindex", fSpentIndex);
+        pindexdb->WriteFlag("spentindex", fSpentIndex);
         LogPrintf("%s: spent index %s\n", __func__, fSpentIndex ? "enabled" : "disabled");
 
+        // Use the provided setting for -blockfilterindex in the new database
+        fBlockFilterIndex = gArgs.GetBoolArg("-blockfilterindex", DEFAULT_BLOCKFILTERINDEX);
+        pblocktree->WriteFlag("blockfilterindex", fBlockFilterIndex);
+        pindexdb->WriteFlag("blockfilterindex", fBlockFilterIndex);
+        LogPrintf("%s: block filter index %s\n", __func__, fBlockFilterIndex ? "enabled" : "disabled");
+
     }
     return true;
 }
@@ -5008,6 +5199,429 @@ bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskB
     return nLoaded > 0;
 }
 
+namespace {
+
+/** Blocks found in one blk?????.dat file and the undo records of its rev?????.dat file */
+struct CBlockFileScan
+{
+    struct Entry {
+        CBlockHeader header;
+        uint256 hash;
+        unsigned int nDataPos;
+        unsigned int nTx;
+    };
+
+    /** An undo record, with the parent hash and transaction count of the blocks its checksum fits */
+    struct UndoRecord {
+        uint256 hashPrevBlock;
+        unsigned int nTx;
+        unsigned int nUndoPos;
+        uint256 hashChecksum;
+
+        bool operator<(const UndoRecord& other) const {
+            return hashPrevBlock < other.hashPrevBlock || (hashPrevBlock == other.hashPrevBlock && nTx < other.nTx);
+        }
+    };
+
+    std::vector<Entry> vEntries;
+    std::vector<UndoRecord> vUndo;
+    unsigned int nSize;
+    unsigned int nUndoSize;
+
+    CBlockFileScan() : nSize(0), nUndoSize(0) {}
+};
+
+/**
+ * Position a block or undo file just after the next "message start + size" record prefix.
+ * Records are written back to back, but resynchronise on the message start bytes in case
+ * a partial write left garbage behind (or we reached the pre-allocated zero tail).
+ */
+bool ReadDiskRecordPrefix(FILE* file, const CMessageHeader::MessageStartChars& messageStart, unsigned int nMaxSize, unsigned int& nPos, unsigned int& nSize)
+{
+    unsigned char buf[CMessageHeader::MESSAGE_START_SIZE];
+    if (fread(buf, 1, sizeof(buf), file) != sizeof(buf))
+        return false;
+    while (true) {
+        while (memcmp(buf, messageStart, sizeof(buf))) {
+            int c = fgetc(file);
+            if (c == EOF)
+                return false;
+            memmove(buf, buf + 1, sizeof(buf) - 1);
+            buf[sizeof(buf) - 1] = (unsigned char)c;
+        }
+        unsigned char sizebuf[4];
+        if (fread(sizebuf, 1, sizeof(sizebuf), file) != sizeof(sizebuf))
+            return false;
+        long nFilePos = ftell(file);
+        if (nFilePos < 0)
+            return false;
+        nPos = (unsigned int)nFilePos;
+        nSize = ReadLE32(sizebuf);
+        if (nSize > 0 && nSize <= nMaxSize)
+            return true;
+        // Not a real record, continue searching one byte after the bogus message start
+        if (fseek(file, nPos - sizeof(sizebuf) - sizeof(buf) + 1, SEEK_SET) || fread(buf, 1, sizeof(buf), file) != sizeof(buf))
+            return false;
+    }
+}
+
+/** Read the block headers of blk?????.dat and the undo records of rev?????.dat, without deserializing transactions. */
+bool ScanBlockFileForIndex(const CChainParams& chainparams, int nFile, CBlockFileScan& scan)
+{
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+
+    CAutoFile blkfile(OpenBlockFile(CDiskBlockPos(nFile, 0), true), SER_DISK, CLIENT_VERSION);
+    if (blkfile.IsNull())
+        return error("%s: failed to open blk%05u.dat", __func__, nFile);
+
+    unsigned int nPos, nSize;
+    while (ReadDiskRecordPrefix(blkfile.Get(), chainparams.MessageStart(), GetMaxBlockSerializedSize(), nPos, nSize)) {
+        boost::this_thread::interruption_point();
+        CBlockFileScan::Entry entry;
+        try {
+            blkfile >> entry.header;
+            entry.nTx = ReadCompactSize(blkfile);
+        } catch (const std::exception& e) {
+            // Truncated record at the end of the file
+            break;
+        }
+        if (fseek(blkfile.Get(), nPos + nSize, SEEK_SET))
+            break;
+
+        entry.hash = entry.header.GetHash();
+        if (entry.nTx == 0 || !CheckProofOfWork(entry.hash, entry.header.nBits, consensusParams)) {
+            LogPrint(BCLog::REINDEX, "%s: skipping invalid block record at blk%05u.dat:%u\n", __func__, nFile, nPos);
+            continue;
+        }
+        entry.nDataPos = nPos;
+        scan.vEntries.push_back(entry);
+        scan.nSize = nPos + nSize;
+    }
+
+    if (!fs::exists(GetBlockPosFilename(CDiskBlockPos(nFile, 0), "rev")))
+        return true;
+
+    CAutoFile revfile(OpenUndoFile(CDiskBlockPos(nFile, 0), true), SER_DISK, CLIENT_VERSION);
+    if (revfile.IsNull())
+        return error("%s: failed to open rev%05u.dat", __func__, nFile);
+
+    // Undo records carry no block hash, only a checksum committing to the hash of the
+    // block's parent. Keep every record whose checksum fits a block of this file with the
+    // right transaction count; which block it belongs to is only decided along the chain.
+    std::map<uint64_t, std::set<uint256> > mapPrevByUndoCount;
+    for (const CBlockFileScan::Entry& entry : scan.vEntries) {
+        mapPrevByUndoCount[entry.nTx - 1].insert(entry.header.hashPrevBlock);
+    }
+
+    std::vector<char> vData;
+    while (ReadDiskRecordPrefix(revfile.Get(), chainparams.MessageStart(), MAX_SIZE, nPos, nSize)) {
+        boost::this_thread::interruption_point();
+        uint256 hashChecksum;
+        uint64_t nTxUndo;
+        try {
+            vData.resize(nSize);
+            revfile.read(vData.data(), nSize);
+            revfile >> hashChecksum;
+            CDataStream ssCount(vData.data(), vData.data() + std::min<size_t>(vData.size(), 9), SER_DISK, CLIENT_VERSION);
+            nTxUndo = ReadCompactSize(ssCount);
+        } catch (const std::exception& e) {
+            break;
+        }
+        scan.nUndoSize = nPos + nSize + sizeof(hashChecksum);
+
+        std::map<uint64_t, std::set<uint256> >::const_iterator it = mapPrevByUndoCount.find(nTxUndo);
+        if (it == mapPrevByUndoCount.end())
+            continue;
+        for (const uint256& hashPrevBlock : it->second) {
+            CHashWriter hasher(SER_GETHASH, PROTOCOL_VERSION);
+            hasher << hashPrevBlock;
+            hasher.write(vData.data(), vData.size());
+            if (hasher.GetHash() == hashChecksum) {
+                CBlockFileScan::UndoRecord record;
+                record.hashPrevBlock = hashPrevBlock;
+                record.nTx = nTxUndo + 1;
+                record.nUndoPos = nPos;
+                record.hashChecksum = hashChecksum;
+                scan.vUndo.push_back(record);
+            }
+        }
+    }
+    std::sort(scan.vUndo.begin(), scan.vUndo.end());
+
+    return true;
+}
+
+/** Run func(nFile) for every block file on a pool of worker threads. */
+void ForEachBlockFileParallel(int nFiles, const std::function<void(int)>& func)
+{
+    std::atomic<int> nNextFile(0);
+    boost::thread_group threadGroup;
+    int nThreads = std::max(1, std::min(GetNumCores(), nFiles));
+    for (int i = 0; i < nThreads; i++) {
+        threadGroup.create_thread([&nNextFile, nFiles, &func]() {
+            RenameThread("raven-reindexidx");
+            int nFile;
+            while ((nFile = nNextFile++) < nFiles && !ShutdownRequested()) {
+                func(nFile);
+            }
+        });
+    }
+    threadGroup.join_all();
+}
+
+} // namespace
+
+bool RebuildBlockIndexFromDisk(const CChainParams& chainparams, const uint256& hashBestBlock)
+{
+    int64_t nStart = GetTimeMillis();
+    const Consensus::Params& consensusParams = chainparams.GetConsensus();
+
+    int nFiles = 0;
+    while (fs::exists(GetBlockPosFilename(CDiskBlockPos(nFiles, 0), "blk")))
+        nFiles++;
+    if (nFiles == 0)
+        return error("%s: no block files found", __func__);
+
+    LogPrintf("Rebuilding block index from %d block files...\n", nFiles);
+
+    std::vector<CBlockFileInfo> vinfo(nFiles);
+    std::vector<std::vector<CBlockFileScan::UndoRecord> > vUndo(nFiles);
+    std::atomic<bool> fFailed(false);
+    std::atomic<int> nFilesDone(0);
+    ForEachBlockFileParallel(nFiles, [&](int nFile) {
+        CBlockFileScan scan;
+        try {
+            if (!ScanBlockFileForIndex(chainparams, nFile, scan)) {
+                fFailed = true;
+                return;
+            }
+        } catch (const std::exception& e) {
+            LogPrintf("%s: error scanning blk%05u.dat: %s\n", __func__, nFile, e.what());
+            fFailed = true;
+            return;
+        }
+
+        LOCK(cs_main);
+        vinfo[nFile].nSize = scan.nSize;
+        vinfo[nFile].nUndoSize = scan.nUndoSize;
+        vUndo[nFile].swap(scan.vUndo);
+        for (const CBlockFileScan::Entry& entry : scan.vEntries) {
+            BlockMap::iterator mi = mapBlockIndex.find(entry.hash);
+            if (mi != mapBlockIndex.end() && (mi->second->nStatus & BLOCK_HAVE_DATA))
+                continue; // a second copy of a block we already found
+            CBlockIndex* pindex = InsertBlockIndex(entry.hash);
+            pindex->pprev          = InsertBlockIndex(entry.header.hashPrevBlock);
+            pindex->nFile          = nFile;
+            pindex->nDataPos       = entry.nDataPos;
+            pindex->nVersion       = entry.header.nVersion;
+            pindex->hashMerkleRoot = entry.header.hashMerkleRoot;
+            pindex->nTime          = entry.header.nTime;
+            pindex->nBits          = entry.header.nBits;
+            pindex->nNonce         = entry.header.nNonce;
+            pindex->nTx            = entry.nTx;
+            pindex->nStatus        = BLOCK_HAVE_DATA;
+            pindex->RaiseValidity(BLOCK_VALID_TRANSACTIONS);
+        }
+        int nDone = ++nFilesDone;
+        LogPrint(BCLog::REINDEX, "Indexed blk%05u.dat: %u blocks (%d/%d files)\n", nFile, scan.vEntries.size(), nDone, nFiles);
+        uiInterface.ShowProgress(_("Rebuilding block index..."), nDone * 100 / nFiles, false);
+    });
+    uiInterface.ShowProgress("", 100, false);
+
+    if (fFailed || ShutdownRequested()) {
+        UnloadBlockIndex();
+        return false;
+    }
+
+    LOCK(cs_main);
+
+    // Link the tree and assign heights, dropping anything that does not descend from genesis
+    // (parents that were never found on disk, and their descendants).
+    BlockMap::iterator miGenesis = mapBlockIndex.find(consensusParams.hashGenesisBlock);
+    if (miGenesis == mapBlockIndex.end() || !(miGenesis->second->nStatus & BLOCK_HAVE_DATA)) {
+        UnloadBlockIndex();
+        return error("%s: genesis block not found in block files", __func__);
+    }
+
+    std::multimap<CBlockIndex*, CBlockIndex*> mapChildren;
+    for (const std::pair<uint256, CBlockIndex*>& item : mapBlockIndex) {
+        item.second->nHeight = -1;
+        if (item.second->pprev)
+            mapChildren.insert(std::make_pair(item.second->pprev, item.second));
+    }
+
+    std::deque<CBlockIndex*> queue;
+    miGenesis->second->nHeight = 0;
+    queue.push_back(miGenesis->second);
+    while (!queue.empty()) {
+        CBlockIndex* pindex = queue.front();
+        queue.pop_front();
+        if (pindex->pprev) {
+            pindex->nHeight = pindex->pprev->nHeight + 1;
+            pindex->BuildSkip();
+        }
+        if (IsWitnessEnabled(pindex->pprev, consensusParams))
+            pindex->nStatus |= BLOCK_OPT_WITNESS;
+        vinfo[pindex->nFile].AddBlock(pindex->nHeight, pindex->GetBlockTime());
+
+        std::pair<std::multimap<CBlockIndex*, CBlockIndex*>::iterator, std::multimap<CBlockIndex*, CBlockIndex*>::iterator> range = mapChildren.equal_range(pindex);
+        for (; range.first != range.second; range.first++)
+            queue.push_back(range.first->second);
+    }
+    mapChildren.clear();
+
+    int nDropped = 0;
+    for (BlockMap::iterator it = mapBlockIndex.begin(); it != mapBlockIndex.end();) {
+        if (it->second->nHeight < 0) {
+            if (it->second->nStatus & BLOCK_HAVE_DATA)
+                nDropped++;
+            delete it->second;
+            it = mapBlockIndex.erase(it);
+        } else {
+            it++;
+        }
+    }
+    if (nDropped)
+        LogPrintf("%s: ignoring %d blocks not connected to the genesis block\n", __func__, nDropped);
+
+    // The chain state must be reachable, with undo data for every block on the way there
+    // so that it can still be disconnected. Undo data is only written once a block passed
+    // ConnectBlock, and it is only assigned along this chain: an undo record fits every
+    // block of its file with the same parent and transaction count, so a block whose
+    // candidates differ (such as siblings that were both connected) cannot be recovered
+    // here. Blocks off the chain are left without undo data and are connected again if
+    // they are ever needed.
+    CBlockIndex* pindexTip = nullptr;
+    if (!hashBestBlock.IsNull()) {
+        BlockMap::iterator mi = mapBlockIndex.find(hashBestBlock);
+        if (mi == mapBlockIndex.end()) {
+            UnloadBlockIndex();
+            return error("%s: chain state tip %s not found in block files", __func__, hashBestBlock.ToString());
+        }
+        pindexTip = mi->second;
+        for (CBlockIndex* pindex = pindexTip; pindex->pprev; pindex = pindex->pprev) {
+            CBlockFileScan::UndoRecord key;
+            key.hashPrevBlock = pindex->pprev->GetBlockHash();
+            key.nTx = pindex->nTx;
+            const std::vector<CBlockFileScan::UndoRecord>& vFileUndo = vUndo[pindex->nFile];
+            std::pair<std::vector<CBlockFileScan::UndoRecord>::const_iterator, std::vector<CBlockFileScan::UndoRecord>::const_iterator> range =
+                std::equal_range(vFileUndo.begin(), vFileUndo.end(), key);
+            if (range.first == range.second) {
+                UnloadBlockIndex();
+                return error("%s: no undo data found for block %s at height %d of the active chain", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight);
+            }
+            // The same block connected more than once leaves identical records behind
+            for (std::vector<CBlockFileScan::UndoRecord>::const_iterator it = range.first; it != range.second; it++) {
+                if (it->hashChecksum != range.first->hashChecksum) {
+                    UnloadBlockIndex();
+                    return error("%s: undo data of block %s at height %d of the active chain is ambiguous, use -reindex instead", __func__, pindex->GetBlockHash().ToString(), pindex->nHeight);
+                }
+            }
+            pindex->nUndoPos = range.first->nUndoPos;
+            pindex->nStatus |= BLOCK_HAVE_UNDO;
+            pindex->RaiseValidity(BLOCK_VALID_SCRIPTS);
+        }
+    }
+    vUndo.clear();
+
+    // Write everything out in sync batches
+    std::vector<std::pair<int, const CBlockFileInfo*> > vFiles;
+    for (int nFile = 0; nFile < nFiles; nFile++) {
+        vFiles.push_back(std::make_pair(nFile, &vinfo[nFile]));
+    }
+    std::vector<const CBlockIndex*> vBlocks;
+    for (const std::pair<uint256, CBlockIndex*>& item : mapBlockIndex) {
+        vBlocks.push_back(item.second);
+        if (vBlocks.size() >= 50000) {
+            if (!pblocktree->WriteBatchSync(vFiles, nFiles - 1, vBlocks)) {
+                UnloadBlockIndex();
+                return error("%s: failed to write block index", __func__);
+            }
+            vFiles.clear();
+            vBlocks.clear();
+        }
+    }
+    if (!pblocktree->WriteBatchSync(vFiles, nFiles - 1, vBlocks)) {
+        UnloadBlockIndex();
+        return error("%s: failed to write block index", __func__);
+    }
+
+    // The asset index is in the assets database, which was kept, so take its flag from there.
+    // Older versions only recorded it in the block tree; then it stays unset and -assetindex
+    // asks for -reindex.
+    bool fKeepAssetIndex;
+    if (passetsdb->ReadFlag("assetindex", fKeepAssetIndex))
+        pblocktree->WriteFlag("assetindex", fKeepAssetIndex);
+
+    bool fRebuildTxIndex = gArgs.GetBoolArg("-txindex", DEFAULT_TXINDEX);
+    pblocktree->WriteFlag("txindex", fRebuildTxIndex);
+
+    // The address, spent, timestamp and block filter indexes are in their own database, which
+    // was kept, so take their flags from there. If they were written up to a block that is not
+    // in the block files any more, record them as disabled so they are built again if still wanted.
+    uint256 hashIndexBestBlock;
+    bool fKeepIndexes = !pindexdb->ReadIndexBestBlock(hashIndexBestBlock) || hashIndexBestBlock.IsNull() ||
+                        mapBlockIndex.count(hashIndexBestBlock);
+    for (const char* pszIndex : {"addressindex", "timestampindex", "spentindex", "blockfilterindex"}) {
+        bool fValue = false;
+        if (fKeepIndexes)
+            pindexdb->ReadFlag(pszIndex, fValue);
+        pblocktree->WriteFlag(pszIndex, fValue);
+    }
+
+    // The transaction index only needs block positions, so rebuild it for the active chain
+    if (fRebuildTxIndex && pindexTip) {
+        std::vector<std::vector<unsigned int> > vActivePos(nFiles);
+        for (CBlockIndex* pindex = pindexTip; pindex; pindex = pindex->pprev) {
+            vActivePos[pindex->nFile].push_back(pindex->nDataPos);
+        }
+
+        ForEachBlockFileParallel(nFiles, [&](int nFile) {
+            if (vActivePos[nFile].empty())
+                return;
+            std::sort(vActivePos[nFile].begin(), vActivePos[nFile].end());
+            CAutoFile blkfile(OpenBlockFile(CDiskBlockPos(nFile, 0), true), SER_DISK, CLIENT_VERSION);
+            if (blkfile.IsNull()) {
+                fFailed = true;
+                return;
+            }
+            std::vector<std::pair<uint256, CDiskTxPos> > vPos;
+            for (unsigned int nDataPos : vActivePos[nFile]) {
+                CBlock block;
+                try {
+                    if (fseek(blkfile.Get(), nDataPos, SEEK_SET)) {
+                        fFailed = true;
+                        return;
+                    }
+                    blkfile >> block;
+                } catch (const std::exception& e) {
+                    LogPrintf("%s: error reading block at blk%05u.dat:%u: %s\n", __func__, nFile, nDataPos, e.what());
+                    fFailed = true;
+                    return;
+                }
+                CDiskTxPos pos(CDiskBlockPos(nFile, nDataPos), GetSizeOfCompactSize(block.vtx.size()));
+                for (const CTransactionRef& tx : block.vtx) {
+                    vPos.push_back(std::make_pair(tx->GetHash(), pos));
+                    pos.nTxOffset += ::GetSerializeSize(*tx, SER_DISK, CLIENT_VERSION);
+                }
+            }
+            if (!pblocktree->WriteTxIndex(vPos))
+                fFailed = true;
+        });
+
+        if (fFailed || ShutdownRequested()) {
+            UnloadBlockIndex();
+            return error("%s: failed to rebuild the transaction index", __func__);
+        }
+    }
+
+    LogPrintf("Rebuilt block index with %u blocks in %dms\n", mapBlockIndex.size(), GetTimeMillis() - nStart);
+
+    // LoadBlockIndex reads everything back the regular way
+    UnloadBlockIndex();
+    return true;
+}
+
 void static CheckBlockIndex(const Consensus::Params& consensusParams)
 {
     if (!fCheckBlockIndex) {
@@ -5223,6 +5837,47 @@ int VersionBitsTipStateSinceHeight(const Consensus::Params& params, Consensus::D
 }
 
 static const uint64_t MEMPOOL_DUMP_VERSION = 1;
+/** Adds the tip hash and the outputs each transaction spends */
+static const uint64_t MEMPOOL_DUMP_VERSION_SNAPSHOT = 2;
+
+/** A mempool.dat transaction, with the outputs it spends when the snapshot has them */
+struct CMempoolDumpEntry
+{
+    CTransactionRef tx;
+    int64_t nTime;
+    int64_t nFeeDelta;
+    std::vector<CTxOut> vSpent;
+};
+
+/**
+ * Verify the scripts of snapshot transactions in parallel, so that the serial
+ * AcceptToMemoryPool pass afterwards finds their signatures in the signature
+ * cache. Only valid signatures are cached, so wrong spent outputs in the file
+ * cost time but can never get a transaction accepted.
+ */
+static void PrecheckMempoolScripts(const std::vector<CMempoolDumpEntry>& vEntries)
+{
+    int nThreads = std::max(1, nScriptCheckThreads);
+    std::atomic<size_t> nNext(0);
+    auto worker = [&vEntries, &nNext]() {
+        for (size_t i = nNext++; i < vEntries.size() && !ShutdownRequested(); i = nNext++) {
+            const CMempoolDumpEntry& entry = vEntries[i];
+            if (entry.vSpent.size() != entry.tx->vin.size())
+                continue;
+            PrecomputedTransactionData txdata(*entry.tx);
+            for (unsigned int n = 0; n < entry.tx->vin.size(); n++) {
+                CScriptCheck check(entry.vSpent[n], *entry.tx, n, STANDARD_SCRIPT_VERIFY_FLAGS, true, &txdata);
+                if (!check())
+                    break;
+            }
+        }
+    };
+    boost::thread_group threads;
+    for (int i = 1; i < nThreads; i++)
+        threads.create_thread(worker);
+    worker();
+    threads.join_all();
+}
 
 bool LoadMempool(void)
 {
@@ -5244,27 +5899,56 @@ bool LoadMempool(void)
     try {
         uint64_t version;
         file >> version;
-        if (version != MEMPOOL_DUMP_VERSION) {
+        if (version != MEMPOOL_DUMP_VERSION && version != MEMPOOL_DUMP_VERSION_SNAPSHOT) {
             return false;
         }
+        uint256 hashTip;
+        if (version == MEMPOOL_DUMP_VERSION_SNAPSHOT)
+            file >> hashTip;
         uint64_t num;
         file >> num;
+        std::vector<CMempoolDumpEntry> vEntries;
         while (num--) {
-            CTransactionRef tx;
-            int64_t nTime;
-            int64_t nFeeDelta;
-            file >> tx;
-            file >> nTime;
-            file >> nFeeDelta;
-
-            CAmount amountdelta = nFeeDelta;
+            CMempoolDumpEntry entry;
+            file >> entry.tx;
+            file >> entry.nTime;
+            file >> entry.nFeeDelta;
+            if (version == MEMPOOL_DUMP_VERSION_SNAPSHOT)
+                file >> entry.vSpent;
+            if (entry.nTime + nExpiryTimeout > nNow) {
+                vEntries.push_back(std::move(entry));
+            } else {
+                if (entry.nFeeDelta) {
+                    mempool.PrioritiseTransaction(entry.tx->GetHash(), entry.nFeeDelta);
+                }
+                ++expired;
+            }
+        }
+        std::map<uint256, CAmount> mapDeltas;
+        file >> mapDeltas;
+
+        // The spent outputs are those of the tip the snapshot was taken at
+        bool fSameTip;
+        {
+            LOCK(cs_main);
+            fSameTip = !hashTip.IsNull() && chainActive.Tip() && chainActive.Tip()->GetBlockHash() == hashTip;
+        }
+        if (fSameTip) {
+            int64_t nStart = GetTimeMicros();
+            PrecheckMempoolScripts(vEntries);
+            LogPrint(BCLog::MEMPOOL, "Checked scripts of %u mempool transactions from disk in %.2fms\n", vEntries.size(), (GetTimeMicros() - nStart) * 0.001);
+        }
+
+        for (const CMempoolDumpEntry& entry : vEntries) {
+            const CTransactionRef& tx = entry.tx;
+            CAmount amountdelta = entry.nFeeDelta;
             if (amountdelta) {
                 mempool.PrioritiseTransaction(tx->GetHash(), amountdelta);
             }
             CValidationState state;
-            if (nTime + nExpiryTimeout > nNow) {
+            {
                 LOCK(cs_main);
-                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, nTime,
+                AcceptToMemoryPoolWithTime(chainparams, mempool, state, tx, nullptr /* pfMissingInputs */, entry.nTime,
                                            nullptr /* plTxnReplaced */, false /* bypass_limits */, 0 /* nAbsurdFee */);
                 if (state.IsValid()) {
                     ++count;
@@ -5279,14 +5963,10 @@ bool LoadMempool(void)
                         ++failed;
                     }
                 }
-            } else {
-                ++expired;
             }
             if (ShutdownRequested())
                 return false;
         }
-        std::map<uint256, CAmount> mapDeltas;
-        file >> mapDeltas;
 
         for (const auto& i : mapDeltas) {
             mempool.PrioritiseTransaction(i.first, i.second);
@@ -5306,13 +5986,56 @@ bool DumpMempool(void)
 
     std::map<uint256, CAmount> mapDeltas;
     std::vector<TxMempoolInfo> vinfo;
+    std::vector<std::vector<CTxOut>> vSpent;
+    std::vector<std::pair<size_t, unsigned int>> vUncached;
+    uint256 hashTip;
 
     {
-        LOCK(mempool.cs);
+        LOCK2(cs_main, mempool.cs);
         for (const auto &i : mempool.mapDeltas) {
             mapDeltas[i.first] = i.second;
         }
         vinfo = mempool.infoAll();
+
+        // Record what each transaction spends, from the chain or from the mempool, so that
+        // a restart on the same tip can check the scripts before re-accepting them. Outputs
+        // that are not in the mempool or the coins cache are read from the coins database
+        // once the locks are released, so dumping does not fill the cache.
+        if (pcoinsTip && chainActive.Tip()) {
+            hashTip = chainActive.Tip()->GetBlockHash();
+            vSpent.resize(vinfo.size());
+            for (size_t i = 0; i < vinfo.size(); i++) {
+                const CTransaction& tx = *vinfo[i].tx;
+                vSpent[i].resize(tx.vin.size());
+                for (unsigned int n = 0; n < tx.vin.size(); n++) {
+                    const COutPoint& prevout = tx.vin[n].prevout;
+                    CTransactionRef ptxParent = mempool.get(prevout.hash);
+                    if (ptxParent) {
+                        if (prevout.n >= ptxParent->vout.size()) {
+                            vSpent[i].clear();
+                            break;
+                        }
+                        vSpent[i][n] = ptxParent->vout[prevout.n];
+                    } else if (pcoinsTip->HaveCoinInCache(prevout)) {
+                        vSpent[i][n] = pcoinsTip->AccessCoin(prevout).out;
+                    } else {
+                        vUncached.emplace_back(i, n);
+                    }
+                }
+            }
+        }
+    }
+
+    for (const std::pair<size_t, unsigned int>& input : vUncached) {
+        std::vector<CTxOut>& vTxSpent = vSpent[input.first];
+        if (vTxSpent.empty())
+            continue;
+        Coin coin;
+        if (!pcoinsdbview->GetCoin(vinfo[input.first].tx->vin[input.second].prevout, coin)) {
+            vTxSpent.clear();
+            continue;
+        }
+        vTxSpent[input.second] = coin.out;
     }
 
     int64_t mid = GetTimeMicros();
@@ -5325,15 +6048,17 @@ bool DumpMempool(void)
 
         CAutoFile file(filestr, SER_DISK, CLIENT_VERSION);
 
-        uint64_t version = MEMPOOL_DUMP_VERSION;
+        uint64_t version = MEMPOOL_DUMP_VERSION_SNAPSHOT;
         file << version;
+        file << hashTip;
 
         file << (uint64_t)vinfo.size();
-        for (const auto& i : vinfo) {
-            file << *(i.tx);
-            file << (int64_t)i.nTime;
-            file << (int64_t)i.nFeeDelta;
-            mapDeltas.erase(i.tx->GetHash());
+        for (size_t i = 0; i < vinfo.size(); i++) {
+            file << *(vinfo[i].tx);
+            file << (int64_t)vinfo[i].nTime;
+            file << (int64_t)vinfo[i].nFeeDelta;
+            file << (i < vSpent.size() ? vSpent[i] : std::vector<CTxOut>());
+            mapDeltas.erase(vinfo[i].tx->GetHash());
         }
 
         file << mapDeltas;
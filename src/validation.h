@@ -13,6 +13,7 @@
 
 #include "amount.h"
 #include "coins.h"
+#include "consensus/validation.h"
 #include "fs.h"
 #include "protocol.h" // For CMessageHeader::MessageStartChars
 #include "policy/feerate.h"
@@ -38,6 +39,7 @@
 
 class CBlockIndex;
 class CBlockTreeDB;
+class CIndexDB;
 class CChainParams;
 class CCoinsViewDB;
 class CInv;
@@ -47,7 +49,9 @@ class CBlockPolicyEstimator;
 class CTxMemPool;
 class CValidationState;
 class CTxUndo;
+class CBlockUndo;
 struct ChainTxData;
+struct CBlockFilterIndexValue;
 
 class CAssetsDB;
 class CAssets;
@@ -90,6 +94,16 @@ static const unsigned int UNDOFILE_CHUNK_SIZE = 0x100000; // 1 MiB
 static const int MAX_SCRIPTCHECK_THREADS = 16;
 /** -par default (number of script-checking threads, 0 = auto) */
 static const int DEFAULT_SCRIPTCHECK_THREADS = 0;
+/** Default for -parallelconnect, run input checks of independent block transactions on the -par threads */
+static const bool DEFAULT_PARALLEL_CONNECT = false;
+/** -blockprefetch default (number of threads reading block inputs from the chainstate, 0 = disabled) */
+static const int DEFAULT_BLOCK_PREFETCH_THREADS = 0;
+/** Maximum number of block input prefetch threads allowed */
+static const int MAX_BLOCK_PREFETCH_THREADS = 16;
+/** -addressquerythreads default (number of threads reading the address index for a query of several addresses) */
+static const int DEFAULT_ADDRESS_QUERY_THREADS = 4;
+/** Maximum number of address query threads allowed */
+static const int MAX_ADDRESS_QUERY_THREADS = 16;
 /** Number of blocks that can be requested at any given time from a single peer. */
 static const int MAX_BLOCKS_IN_TRANSIT_PER_PEER = 16;
 /** Timeout in seconds during which a peer must stall block download progress before being disconnected. */
@@ -146,6 +160,7 @@ static const bool DEFAULT_ASSETINDEX = false;
 static const bool DEFAULT_ADDRESSINDEX = false;
 static const bool DEFAULT_TIMESTAMPINDEX = false;
 static const bool DEFAULT_SPENTINDEX = false;
+static const bool DEFAULT_BLOCKFILTERINDEX = false;
 /** Default for -dbmaxfilesize , in MB */
 static const int64_t DEFAULT_DB_MAX_FILE_SIZE = 2;
 
@@ -187,11 +202,15 @@ extern CConditionVariable cvBlockChange;
 extern std::atomic_bool fImporting;
 extern std::atomic_bool fReindex;
 extern int nScriptCheckThreads;
+extern bool fParallelConnect;
+extern int nBlockPrefetchThreads;
+extern int nAddressQueryThreads;
 extern bool fTxIndex;
 extern bool fAssetIndex;
 extern bool fAddressIndex;
 extern bool fSpentIndex;
 extern bool fTimestampIndex;
+extern bool fBlockFilterIndex;
 extern bool fIsBareMultisigStd;
 extern bool fRequireStandard;
 extern bool fCheckBlockIndex;
@@ -281,6 +300,12 @@ FILE* OpenBlockFile(const CDiskBlockPos &pos, bool fReadOnly = false);
 fs::path GetBlockPosFilename(const CDiskBlockPos &pos, const char *prefix);
 /** Import blocks from an external file */
 bool LoadExternalBlockFile(const CChainParams& chainparams, FILE* fileIn, CDiskBlockPos *dbp = nullptr);
+/**
+ * Rebuild the block index (and the transaction index, if enabled) from the headers in the
+ * blk*.dat files and the undo records in the rev*.dat files, without revalidating blocks.
+ * Blocks with undo data are marked fully validated. Used for -reindex-index.
+ */
+bool RebuildBlockIndexFromDisk(const CChainParams& chainparams, const uint256& hashBestBlock);
 /** Ensures we have a genesis block in the block tree, possibly writing one to disk. */
 bool LoadGenesisBlock(const CChainParams& chainparams);
 /** Load the block tree and coins database from disk,
@@ -292,6 +317,10 @@ bool LoadChainTip(const CChainParams& chainparams);
 void UnloadBlockIndex();
 /** Run an instance of the script checking thread */
 void ThreadScriptCheck();
+/** Run an instance of the transaction input checking thread (-parallelconnect) */
+void ThreadInputCheck();
+/** Run an instance of the block input prefetch thread (-blockprefetch) */
+void ThreadInputPrefetch();
 /** Check whether we are doing an initial block download (synchronizing from disk or network) */
 bool IsInitialBlockDownload();
 bool IsInitialSyncSpeedUp();
@@ -414,11 +443,80 @@ public:
     ScriptError GetScriptError() const { return error; }
 };
 
+/** Outcome of a CTxInputsCheck, consumed in block order by ConnectBlock */
+struct CTxInputsCheckResult
+{
+    //! The check that failed, in the order ConnectBlock runs them
+    enum FailedCheck {
+        NONE,
+        INPUTS,
+        ASSETS,
+        SEQUENCE_LOCKS,
+    };
+
+    bool fDone;
+    FailedCheck failed;
+    CValidationState state;
+    CAmount nFee;
+    int64_t nSigOpsCost;
+    bool fAssetsChecked;
+
+    CTxInputsCheckResult() : fDone(false), failed(NONE), nFee(0), nSigOpsCost(0), fAssetsChecked(false) {}
+};
+
+/**
+ * Closure representing the input checks of one block transaction whose inputs all
+ * predate the block: Consensus::CheckTxInputs, BIP68 sequence locks, sigop cost and,
+ * when the transaction creates no transfer or reissue outputs (which consult the
+ * shared asset cache), Consensus::CheckTxAssets.
+ * The spent coins are copied in, so it can run on any thread.
+ */
+class CTxInputsCheck
+{
+private:
+    const CTransaction *ptxTo;
+    std::vector<Coin> vCoins;
+    const CBlockIndex *pindex;
+    int nLockTimeFlags;
+    unsigned int nFlags;
+    bool fCheckAssets;
+    CTxInputsCheckResult *pResult;
+
+public:
+    CTxInputsCheck(): ptxTo(nullptr), pindex(nullptr), nLockTimeFlags(0), nFlags(0), fCheckAssets(false), pResult(nullptr) {}
+    CTxInputsCheck(const CTransaction& txToIn, std::vector<Coin>&& vCoinsIn, const CBlockIndex* pindexIn, int nLockTimeFlagsIn, unsigned int nFlagsIn, bool fCheckAssetsIn, CTxInputsCheckResult* pResultIn) :
+        ptxTo(&txToIn), vCoins(std::move(vCoinsIn)), pindex(pindexIn), nLockTimeFlags(nLockTimeFlagsIn), nFlags(nFlagsIn), fCheckAssets(fCheckAssetsIn), pResult(pResultIn) { }
+
+    //! Always returns true, the outcome is recorded in the result so the earliest failure in block order can be reported
+    bool operator()();
+
+    void swap(CTxInputsCheck &check) {
+        std::swap(ptxTo, check.ptxTo);
+        vCoins.swap(check.vCoins);
+        std::swap(pindex, check.pindex);
+        std::swap(nLockTimeFlags, check.nLockTimeFlags);
+        std::swap(nFlags, check.nFlags);
+        std::swap(fCheckAssets, check.fCheckAssets);
+        std::swap(pResult, check.pResult);
+    }
+};
+
+/**
+ * Flag the transactions of a block that neither spend an output created in the block nor an
+ * outpoint already spent by an earlier transaction of the block. Their input checks only
+ * depend on the UTXO set before the block. The coinbase is never flagged.
+ */
+std::vector<bool> FindIndependentBlockTransactions(const CBlock& block);
+
 /** Initializes the script-execution cache */
 void InitScriptExecutionCache();
 
-bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes);
+bool GetTimestampIndex(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, std::vector<std::pair<uint256, unsigned int> > &hashes,
+                       size_t nOffset = 0, size_t nLimit = 0);
+bool GetTimestampIndexSummary(const unsigned int &high, const unsigned int &low, const bool fActiveOnly, unsigned int nBucketSize,
+                              std::vector<std::pair<unsigned int, unsigned int> > &buckets);
 bool GetSpentIndex(CSpentIndexKey &key, CSpentIndexValue &value);
+bool GetBlockFilter(const uint256 &hash, CBlockFilterIndexValue &value);
 bool HashOnchainActive(const uint256 &hash);
 bool GetAddressIndex(uint160 addressHash, int type, std::string assetName,
                      std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
@@ -430,10 +528,30 @@ bool GetAddressUnspent(uint160 addressHash, int type, std::string assetName,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 bool GetAddressUnspent(uint160 addressHash, int type,
                        std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/**
+ * Read the address index, or the unspent outputs (an empty asset name meaning all assets other
+ * than RVN), of several addresses on up to nAddressQueryThreads threads. The results of all
+ * addresses are merged in order of block height.
+ */
+bool GetAddressesIndex(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                       std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex,
+                       int start = 0, int end = 0);
+bool GetAddressesUnspent(const std::vector<std::pair<uint160, int> > &addresses, std::string assetName,
+                         std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
+/** The distinct transactions of address index entries, in order of block height and position in the block */
+void GetAddressIndexTxids(const std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex, std::vector<uint256> &txids);
+/** Read one page of the address index: at most nLimit entries following pkeyAfter, or from the first one if null */
+bool GetAddressIndexPage(uint160 addressHash, int type, std::string assetName, int start, int end,
+                         const CAddressIndexKey *pkeyAfter, size_t nLimit,
+                         std::vector<std::pair<CAddressIndexKey, CAmount> > &addressIndex);
+bool GetAddressUnspentPage(uint160 addressHash, int type, std::string assetName,
+                           const CAddressUnspentKey *pkeyAfter, size_t nLimit,
+                           std::vector<std::pair<CAddressUnspentKey, CAddressUnspentValue> > &unspentOutputs);
 
 /** Functions for disk access for blocks */
 bool ReadBlockFromDisk(CBlock& block, const CDiskBlockPos& pos, const Consensus::Params& consensusParams);
 bool ReadBlockFromDisk(CBlock& block, const CBlockIndex* pindex, const Consensus::Params& consensusParams);
+bool UndoReadFromDisk(CBlockUndo& blockundo, const CDiskBlockPos& pos, const uint256& hashBlock);
 
 /** Functions for validating blocks and updating the block tree */
 
@@ -490,6 +608,9 @@ extern CCoinsViewCache *pcoinsTip;
 /** Global variable that points to the active block tree (protected by cs_main) */
 extern CBlockTreeDB *pblocktree;
 
+/** Global variable that points to the address, spent and timestamp index database (LevelDB is thread-safe, no lock needed) */
+extern CIndexDB *pindexdb;
+
 /** RVN START */
 /** Global variable that point to the active assets database (protexted by cs_main) */
 extern CAssetsDB *passetsdb;
@@ -245,7 +245,7 @@ class AssetTest(RavenTestFramework):
 
         n0.reissue(asset_name="CHAIN_REISSUE", qty=1000, to_address=address0, change_address="", \
                    reissuable=True)
-        assert_raises_rpc_error(-4, "Error: The transaction was rejected! Reason given: bad-tx-reissue-chaining-not-allowed", n0.reissue, "CHAIN_REISSUE", 1000, address0, "", True)
+        assert_raises_rpc_error(-4, "Error: The transaction was rejected! Reason given: txn-mempool-conflict", n0.reissue, "CHAIN_REISSUE", 1000, address0, "", True)
 
         n0.generate(1)
         self.sync_all()
@@ -10,8 +10,14 @@ from test_framework.test_framework import RavenTestFramework
 from test_framework.util import *
 
 
+import math
 import string
 
+def truncate(number, digits = 8):
+    stepper = pow(10.0, digits)
+    return math.trunc(stepper * number) / stepper
+
+
 class AssetMempoolTest(RavenTestFramework):
     def set_test_params(self):
         self.setup_clean_chain = True
@@ -148,11 +154,53 @@ class AssetMempoolTest(RavenTestFramework):
         assert_equal(0, n1.getmempoolinfo()['size'])
         assert_equal(0, n0.getmempoolinfo()['size'])
 
+    def reissue_mempool_conflict_test(self):
+        self.log.info("Testing (reissue_mempool_conflict_test) a block with a reissue of an asset that a different transaction in the mempool reissues too")
+        n0, n1 = self.nodes[0], self.nodes[1]
+
+        asset_name = "MEMPOOL_4"
+        n0.issue(asset_name, 1000)
+        n0.generate(1)
+        self.sync_all()
+
+        # Sign two reissues of the asset that spend the same owner token
+        owner = n0.listmyassets(asset_name + '!', True)[asset_name + '!']['outpoints'][0]
+        reissues = []
+        for qty, unspent in zip([100, 200], n0.listunspent()[:2]):
+            inputs = [
+                {k: unspent[k] for k in ['txid', 'vout']},
+                {k: owner[k] for k in ['txid', 'vout']},
+            ]
+            outputs = {
+                'n1ReissueAssetXXXXXXXXXXXXXXWG9NLd': 100,
+                n0.getnewaddress(): truncate(float(unspent['amount']) - 100.0001),
+                n0.getnewaddress(): {
+                    'reissue': {
+                        'asset_name':       asset_name,
+                        'asset_quantity':   qty,
+                    }
+                }
+            }
+            reissues.append(n0.signrawtransaction(n0.createrawtransaction(inputs, outputs))['hex'])
+
+        disconnect_all_nodes(self.nodes)
+
+        # One reissue waits in the mempool of n0 while n1 mines the other one
+        n0.sendrawtransaction(reissues[0])
+        n1.sendrawtransaction(reissues[1])
+        block_hash = n1.generate(1)[0]
+
+        # Block validation still checks reissues against the mempool, so n0 rejects the block
+        assert_equal("bad-tx-reissue-chaining-not-allowed", n0.submitblock(n1.getblock(block_hash, 0)))
+        assert(n0.getbestblockhash() != block_hash)
+        assert_equal(1, n0.getmempoolinfo()['size'])
+
     def run_test(self):
         self.activate_assets()
         self.issue_mempool_test()
         self.issue_mempool_test_extended()
         self.issue_mempool_test_extended_sub()
+        self.reissue_mempool_conflict_test()
 
 if __name__ == '__main__':
     AssetMempoolTest().main()
\ No newline at end of file
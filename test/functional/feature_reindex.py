@@ -3,15 +3,25 @@
 # Copyright (c) 2017-2018 The Raven Core developers
 # Distributed under the MIT software license, see the accompanying
 # file COPYING or http://www.opensource.org/licenses/mit-license.php.
-"""Test running ravend with -reindex and -reindex-chainstate options.
+"""Test running ravend with -reindex, -reindex-chainstate and -reindex-index options.
 
 - Start a single node and generate 3 blocks.
 - Stop the node and restart it with -reindex. Verify that the node has reindexed up to block 3.
 - Stop the node and restart it with -reindex-chainstate. Verify that the node has reindexed up to block 3.
+- Stop the node, delete blocks/index and restart it with -reindex-index. Verify that the block index
+  was rebuilt with the same tip, ignoring a stale fork, and that the node keeps syncing on top of it.
+- Enable the address index, then delete blocks/index and restart with -reindex-index. Verify that
+  the address index is kept rather than built again.
+- Enable the block filter index as well. Verify that the log reports the address index is built again.
+- Verify that -prune is rejected together with the address, spent, timestamp and block filter indexes.
+- Enable the asset index, then delete blocks/index and restart with -reindex-index. Verify that the
+  asset index is kept without asking for -reindex.
 """
 
 from test_framework.test_framework import RavenTestFramework
-from test_framework.util import assert_equal
+from test_framework.util import assert_equal, wait_until
+import os
+import shutil
 import time
 
 class ReindexTest(RavenTestFramework):
@@ -31,11 +41,79 @@ class ReindexTest(RavenTestFramework):
         assert_equal(self.nodes[0].getblockcount(), blockcount)
         self.log.info("Success")
 
+    def reindex_index(self):
+        # The undo record of a stale block that was connected fits its sibling on the chain as well
+        stale = self.nodes[0].generate(1)[0]
+        self.nodes[0].invalidateblock(stale)
+        self.nodes[0].generate(3)
+        blockcount = self.nodes[0].getblockcount()
+        besthash = self.nodes[0].getbestblockhash()
+        self.stop_nodes()
+        shutil.rmtree(os.path.join(self.options.tmpdir, "node0", "regtest", "blocks", "index"))
+        self.start_nodes([["-reindex-index", "-checkblockindex=1"]])
+        assert_equal(self.nodes[0].getblockcount(), blockcount)
+        assert_equal(self.nodes[0].getbestblockhash(), besthash)
+        assert_equal(self.nodes[0].getblock(besthash)["confirmations"], 1)
+        self.nodes[0].generate(1)
+        assert_equal(self.nodes[0].getblockcount(), blockcount + 1)
+        self.log.info("Success")
+
+    def reindex_index_keeps_indexes(self):
+        self.stop_nodes()
+        self.start_nodes([["-addressindex"]])
+        wait_until(lambda: self.nodes[0].getindexinfo()["synced"], timeout=60)
+        wait_until(lambda: self.nodes[0].getindexinfo()["height"] == self.nodes[0].getblockcount(), timeout=60)
+        blockcount = self.nodes[0].getblockcount()
+        self.stop_nodes()
+        shutil.rmtree(os.path.join(self.options.tmpdir, "node0", "regtest", "blocks", "index"))
+        self.start_nodes([["-reindex-index", "-addressindex"]])
+        info = self.nodes[0].getindexinfo()
+        assert_equal(info["addressindex"], True)
+        assert_equal(self.nodes[0].getblockcount(), blockcount)
+        # The background build only ran when the index was first enabled
+        with open(os.path.join(self.options.tmpdir, "node0", "regtest", "debug.log"), encoding="utf-8") as f:
+            assert_equal(f.read().count("indexes will be built in the background"), 1)
+        self.log.info("Success")
+
+    def enable_index_rebuilds_others(self):
+        self.stop_nodes()
+        self.start_nodes([["-addressindex", "-blockfilterindex"]])
+        wait_until(lambda: self.nodes[0].getindexinfo()["synced"], timeout=60)
+        # The indexes share one best block, so the address index is built again with the block filter index
+        with open(os.path.join(self.options.tmpdir, "node0", "regtest", "debug.log"), encoding="utf-8") as f:
+            assert_equal(f.read().count("rebuilds the already built indexes from the genesis block too (address)"), 1)
+        self.log.info("Success")
+
+    def prune_with_indexes(self):
+        self.stop_nodes()
+        for index in ["-addressindex", "-spentindex", "-timestampindex", "-blockfilterindex"]:
+            self.assert_start_raises_init_error(0, ["-prune=550", index],
+                "Prune mode is incompatible with -addressindex, -spentindex, -timestampindex and -blockfilterindex.")
+        # The indexes are still enabled from the previous test
+        self.start_nodes([["-addressindex", "-blockfilterindex"]])
+        self.log.info("Success")
+
+    def reindex_index_keeps_asset_index(self):
+        blockcount = self.nodes[0].getblockcount()
+        self.stop_nodes()
+        self.start_nodes([["-reindex", "-assetindex", "-addressindex", "-blockfilterindex"]])
+        wait_until(lambda: self.nodes[0].getblockcount() == blockcount, timeout=60)
+        self.stop_nodes()
+        shutil.rmtree(os.path.join(self.options.tmpdir, "node0", "regtest", "blocks", "index"))
+        self.start_nodes([["-reindex-index", "-assetindex", "-addressindex", "-blockfilterindex"]])
+        assert_equal(self.nodes[0].getblockcount(), blockcount)
+        self.log.info("Success")
+
     def run_test(self):
         self.reindex(False)
         self.reindex(True)
         self.reindex(False)
         self.reindex(True)
+        self.reindex_index()
+        self.reindex_index_keeps_indexes()
+        self.enable_index_rebuilds_others()
+        self.prune_with_indexes()
+        self.reindex_index_keeps_asset_index()
 
 if __name__ == '__main__':
     ReindexTest().main()
@@ -84,6 +84,12 @@ class MempoolCoinbaseTest(RavenTestFramework):
         # spend_103_1 has been re-orged out of the chain and is back in the mempool
         assert_equal(set(self.nodes[0].getrawmempool()), {spend_101_id, spend_102_1_id, spend_103_1_id})
 
+        # A template built on the new tip takes in the re-orged transaction; templates
+        # are checked against the tip they build on, whichever tip their transactions
+        # were accepted on
+        tmpl = self.nodes[0].getblocktemplate({})
+        assert_equal(set(tx["txid"] for tx in tmpl["transactions"]), {spend_101_id, spend_102_1_id, spend_103_1_id})
+
         # Use invalidateblock to re-org back and make all those coinbase spends
         # immature/invalid:
         for node in self.nodes:
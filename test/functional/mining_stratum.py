@@ -0,0 +1,138 @@
+#!/usr/bin/env python3
+# Copyright (c) 2018 The Raven Core developers
+# Distributed under the MIT software license, see the accompanying
+# file COPYING or http://www.opensource.org/licenses/mit-license.php.
+"""Test the Stratum mining server.
+
+Subscribe and authorize a Stratum client, mine a block from a mining.notify job,
+check that the tip change pushes a clean job and that stale and low
+difficulty shares are rejected, and that a block the node rejects is
+reported to the miner.
+"""
+
+from test_framework.test_framework import RavenTestFramework
+from test_framework.util import *
+from test_framework.mininode import hash256, hash_x16r, uint256_from_compact
+
+import json
+import socket
+import struct
+
+class StratumClient():
+    def __init__(self, port):
+        self.sock = socket.create_connection(("127.0.0.1", port), timeout=30)
+        self.buf = b""
+        self.next_id = 1
+
+    def send(self, method, params):
+        request_id = self.next_id
+        self.next_id += 1
+        self.sock.sendall((json.dumps({"id": request_id, "method": method, "params": params}) + "\n").encode())
+        return request_id
+
+    def recv(self):
+        while b"\n" not in self.buf:
+            data = self.sock.recv(4096)
+            assert data, "stratum connection closed"
+            self.buf += data
+        line, self.buf = self.buf.split(b"\n", 1)
+        return json.loads(line.decode())
+
+    def recv_notification(self, method):
+        while True:
+            msg = self.recv()
+            if msg.get("method") == method:
+                return msg["params"]
+
+    def call(self, method, params):
+        request_id = self.send(method, params)
+        while True:
+            msg = self.recv()
+            if msg.get("id") == request_id:
+                return msg
+
+def unswap_prevhash(prevhash):
+    """Undo the Stratum word swap of the previous block hash, giving its serialized bytes"""
+    raw = bytes.fromhex(prevhash)
+    return b"".join(raw[i:i + 4][::-1] for i in range(0, 32, 4))
+
+def solve_job(job, extranonce1, extranonce2, solve=True, ntime=None):
+    """Grind a nonce for a mining.notify job that does (or with solve=False does not) meet
+    the block target, returning (ntime, nonce, block hash)"""
+    job_id, prevhash, coinb1, coinb2, branch, version, nbits, job_ntime, clean = job
+    ntime = ntime or job_ntime
+    coinbase = bytes.fromhex(coinb1 + extranonce1 + extranonce2 + coinb2)
+    merkle_root = hash256(coinbase)
+    for h in branch:
+        merkle_root = hash256(merkle_root + bytes.fromhex(h))
+    header = struct.pack("<I", int(version, 16)) + unswap_prevhash(prevhash) + merkle_root + \
+             struct.pack("<I", int(ntime, 16)) + struct.pack("<I", int(nbits, 16))
+    target = uint256_from_compact(int(nbits, 16))
+    for nonce in range(1000):
+        block_hash = hash_x16r((header + struct.pack("<I", nonce)).hex())
+        if (int(block_hash, 16) <= target) == solve:
+            return ntime, "%08x" % nonce, block_hash
+    raise AssertionError("no nonce found")
+
+class StratumTest(RavenTestFramework):
+    def set_test_params(self):
+        self.num_nodes = 1
+
+    def run_test(self):
+        node = self.nodes[0]
+        port = rpc_port(0) + PORT_RANGE
+        address = node.getnewaddress()
+        self.stop_node(0)
+        self.start_node(0, ["-stratum", "-stratumport=%d" % port, "-stratumaddress=%s" % address, "-stratumdifficulty=0.001"])
+        node = self.nodes[0]
+        # leave initial block download
+        node.generate(1)
+
+        self.log.info("Subscribe and authorize")
+        client = StratumClient(port)
+        subscribe = client.call("mining.subscribe", ["test/1.0"])
+        assert_equal(subscribe["error"], None)
+        extranonce1, extranonce2_size = subscribe["result"][1], subscribe["result"][2]
+        assert_equal(len(extranonce1), 8)
+        assert_equal(extranonce2_size, 4)
+        assert_equal(client.recv_notification("mining.set_difficulty"), [0.001])
+        job = client.recv_notification("mining.notify")
+        assert_equal(job[8], True)
+        assert_equal(unswap_prevhash(job[1])[::-1].hex(), node.getbestblockhash())
+        assert_equal(client.call("mining.authorize", ["worker", "x"])["result"], True)
+
+        self.log.info("Mine a block from the job")
+        height = node.getblockcount()
+        ntime, nonce, block_hash = solve_job(job, extranonce1, "00000001")
+        reply = client.call("mining.submit", ["worker", job[0], "00000001", ntime, nonce])
+        assert_equal(reply["result"], True)
+        wait_until(lambda: node.getblockcount() == height + 1, timeout=10)
+        assert_equal(node.getbestblockhash(), block_hash)
+
+        self.log.info("The new tip pushes a clean job")
+        new_job = client.recv_notification("mining.notify")
+        assert_equal(new_job[8], True)
+        assert_equal(unswap_prevhash(new_job[1])[::-1].hex(), block_hash)
+
+        self.log.info("Stale and low difficulty shares are rejected")
+        reply = client.call("mining.submit", ["worker", job[0], "00000001", ntime, nonce])
+        assert_equal(reply["error"][0], 21)
+        # regtest blocks are easier than any share difficulty, so a share that misses the block target is too low
+        ntime, nonce, block_hash = solve_job(new_job, extranonce1, "00000002", solve=False)
+        reply = client.call("mining.submit", ["worker", new_job[0], "00000002", ntime, nonce])
+        assert_equal(reply["error"][0], 23)
+        # only shares that pass are remembered, so the same share is not reported as a duplicate
+        reply = client.call("mining.submit", ["worker", new_job[0], "00000002", ntime, nonce])
+        assert_equal(reply["error"][0], 23)
+        assert_equal(node.getblockcount(), height + 1)
+
+        self.log.info("A block the node rejects is reported to the miner")
+        ntime, nonce, block_hash = solve_job(new_job, extranonce1, "00000003", ntime="00000001")
+        reply = client.call("mining.submit", ["worker", new_job[0], "00000003", ntime, nonce])
+        assert_equal(reply["result"], None)
+        assert_equal(reply["error"][0], 20)
+        assert_equal(reply["error"][1], "Block rejected: time-too-old")
+        assert_equal(node.getblockcount(), height + 1)
+
+if __name__ == '__main__':
+    StratumTest().main()
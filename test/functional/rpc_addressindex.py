@@ -345,6 +345,51 @@ class AddressIndexTest(RavenTestFramework):
         assert_equal(utxos_with_info["height"], 267)
         assert_equal(utxos_with_info["hash"], expected_tip_block_hash)
 
+        # Page through results with a limit and cursor
+        print("Testing pagination...")
+
+        def read_pages(method, query, key, limit):
+            results = []
+            cursor = None
+            while True:
+                page_query = dict(query, limit=limit)
+                if cursor is not None:
+                    page_query["cursor"] = cursor
+                page = method(page_query)
+                assert(len(page[key]) <= limit)
+                results += page[key]
+                if "cursor" not in page:
+                    return results
+                cursor = page["cursor"]
+
+        txids_all = self.nodes[1].getaddresstxids({"addresses": ["2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br", address2]})
+        txids_paged = read_pages(self.nodes[1].getaddresstxids, {"addresses": ["2N2JD6wb56AfK4tfmM6PwdVmoYk2dCKf4Br", address2]}, "txids", 1)
+        assert_equal(sorted(set(txids_paged)), sorted(txids_all))
+
+        deltas_all = self.nodes[1].getaddressdeltas({"addresses": [address2]})
+        assert_equal(read_pages(self.nodes[1].getaddressdeltas, {"addresses": [address2]}, "deltas", 2), deltas_all)
+        assert_equal(read_pages(self.nodes[1].getaddressdeltas, {"addresses": [address2]}, "deltas", len(deltas_all)), deltas_all)
+
+        utxos_all = self.nodes[1].getaddressutxos({"addresses": [address1, address2]})
+        utxos_paged = read_pages(self.nodes[1].getaddressutxos, {"addresses": [address1, address2]}, "utxos", 1)
+        assert_equal(sorted(utxos_paged, key=lambda utxo: (utxo["txid"], utxo["outputIndex"])),
+                     sorted(utxos_all, key=lambda utxo: (utxo["txid"], utxo["outputIndex"])))
+
+        # Pages that end with the last entry of an address continue with the next address
+        def delta_key(delta):
+            return (delta["address"], delta["txid"], delta["index"], delta["height"])
+        deltas_both = self.nodes[1].getaddressdeltas({"addresses": [address1, address2]})
+        deltas_address1 = self.nodes[1].getaddressdeltas({"addresses": [address1]})
+        for limit in [1, len(deltas_address1)]:
+            deltas_paged = read_pages(self.nodes[1].getaddressdeltas, {"addresses": [address1, address2]}, "deltas", limit)
+            assert_equal(sorted(deltas_paged, key=delta_key), sorted(deltas_both, key=delta_key))
+        txids_address1 = self.nodes[1].getaddresstxids({"addresses": [address1]})
+        txids_paged = read_pages(self.nodes[1].getaddresstxids, {"addresses": [address1, address2]}, "txids", len(txids_address1))
+        assert_equal(sorted(set(txids_paged)), sorted(self.nodes[1].getaddresstxids({"addresses": [address1, address2]})))
+
+        assert_raises_rpc_error(-8, "Invalid cursor", self.nodes[1].getaddressdeltas, {"addresses": [address2], "limit": 1, "cursor": "00"})
+        assert_raises_rpc_error(-8, "A cursor requires a limit", self.nodes[1].getaddressdeltas, {"addresses": [address2], "cursor": "00"})
+
         print("Passed\n")
 
 
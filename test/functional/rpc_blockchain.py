@@ -12,6 +12,7 @@ Test the following RPCs:
     - getblockhash
     - getblockheader
     - getchaintxstats
+    - getblockconnectstats
     - getnetworkhashps
     - verifychain
 
@@ -45,6 +46,7 @@ class BlockchainTest(RavenTestFramework):
         self._test_getblockheader()
         self._test_getdifficulty()
         self._test_getnetworkhashps()
+        self._test_getblockconnectstats()
         self._test_stopatheight()
         assert self.nodes[0].verifychain(4, 0)
 
@@ -207,6 +209,29 @@ class BlockchainTest(RavenTestFramework):
         # This should be 2 hashes every 1 minutes or 1/30
         assert abs(hashes_per_second * 30 - 1) < 0.0001
 
+    def _test_getblockconnectstats(self):
+        node = self.nodes[0]
+        stats = node.getblockconnectstats()
+        assert_equal(stats['blocks'], 0)
+        assert_equal(stats['stages']['total']['max'], 0)
+
+        # Reconnect the tip so one block gets timed without changing the height
+        tip = node.getbestblockhash()
+        node.invalidateblock(tip)
+        node.reconsiderblock(tip)
+        assert_equal(node.getbestblockhash(), tip)
+
+        stats = node.getblockconnectstats()
+        assert_equal(stats['blocks'], 1)
+        for stage in ['load_block', 'prefetch_inputs', 'connect_txs', 'asset_checks', 'verify_scripts', 'undo_write',
+                      'txindex_write', 'flush_coins', 'flush_assets', 'write_chainstate', 'total']:
+            for key in ['p50', 'p95', 'p99', 'max', 'mean']:
+                assert_greater_than_or_equal(stats['stages'][stage][key], 0)
+        total = stats['stages']['total']
+        assert_greater_than(total['max'], 0)
+        assert_equal(total['p50'], total['max'])
+        assert_greater_than_or_equal(total['max'], stats['stages']['connect_txs']['max'])
+
     def _test_stopatheight(self):
         assert_equal(self.nodes[0].getblockcount(), 200)
         self.nodes[0].generate(6)
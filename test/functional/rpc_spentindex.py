@@ -137,6 +137,23 @@ class SpentIndexTest(RavenTestFramework):
         assert_equal(block["deltas"][1]["outputs"][0]["address"], "mgY65WSfEmsyYaYPQaXhmXMeBhwp4EcsQW")
         assert_equal(block["deltas"][1]["outputs"][0]["satoshis"], amount)
 
+        # Enable the spent index on a node that ran without it, it is built in the background
+        print("Testing building the spent index on an existing node...")
+        self.stop_node(0)
+        self.start_node(0, ["-debug", "-spentindex"])
+        wait_until(lambda: self.nodes[0].getindexinfo()["synced"], timeout=60)
+        wait_until(lambda: self.nodes[0].getindexinfo()["height"] == self.nodes[0].getblockcount(), timeout=60)
+        info = self.nodes[0].getindexinfo()
+        assert_equal(info["spentindex"], True)
+        assert_equal(info["addressindex"], False)
+        assert_equal(info["progress"], 100)
+
+        info = self.nodes[0].getspentinfo({"txid": unspent[0]["txid"], "index": unspent[0]["vout"]})
+        assert_equal(info["txid"], txid)
+        assert_equal(info["index"], 0)
+        assert_equal(info["height"], 106)
+        connect_nodes_bi(self.nodes, 0, 1)
+
         print("Passed\n")
 
 
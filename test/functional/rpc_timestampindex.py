@@ -57,6 +57,18 @@ class TimestampIndexTest(RavenTestFramework):
 
         assert_equal(hashes, blockhashes)
 
+        print("Checking timestamp index pages...")
+        hashes = self.nodes[1].getblockhashes(high, low, {"noOrphans": True, "offset": 10, "limit": 5})
+        assert_equal(hashes, blockhashes[10:15])
+        assert_raises_rpc_error(-8, "Limit is expected to be greater than zero", self.nodes[1].getblockhashes, high, low, {"limit": 0})
+
+        print("Checking timestamp index summary...")
+        buckets = self.nodes[1].getblockhashes(high, low, {"summary": "hour"})
+        assert_equal(sum(bucket["blocks"] for bucket in buckets), len(blockhashes))
+        for bucket in buckets:
+            assert_equal(bucket["time"] % 3600, 0)
+        assert_raises_rpc_error(-8, "Summary is expected to be hour or day", self.nodes[1].getblockhashes, high, low, {"summary": "week"})
+
         print("Passed\n")
 
 
@@ -75,6 +75,7 @@ BASE_SCRIPTS= [
     'wallet_hd.py',
     'p2p_timeouts.py',
     'mining_getblocktemplate_longpoll.py',
+    'mining_stratum.py',
     'feature_maxuploadtarget.py',
     # vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv Tests less than 45s vvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvvv
     'rpc_fundrawtransaction.py',